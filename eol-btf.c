@@ -0,0 +1,448 @@
+/*
+ * eol-btf.c
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "eol-btf.h"
+#include "eol-trace.h"
+#include "eol-util.h"
+
+#include <stdlib.h>
+
+
+#define BTF_MAGIC 0xEB9F
+
+/*
+ * Layout of the data, see the "BTF" document in the Linux kernel sources
+ * (Documentation/bpf/btf.rst) for details.
+ */
+typedef struct {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint32_t hdr_len;
+    uint32_t type_off;
+    uint32_t type_len;
+    uint32_t str_off;
+    uint32_t str_len;
+} BtfHeader;
+
+typedef struct {
+    uint32_t name_off;
+    uint32_t info;
+    uint32_t size_type;
+} BtfType;
+
+#define BTF_INFO_KIND(info)  (((info) >> 24) & 0x1F)
+#define BTF_INFO_VLEN(info)  ((info) & 0xFFFF)
+#define BTF_INFO_KFLAG(info) ((info) >> 31)
+
+#define BTF_INT_ENCODING(v)  (((v) >> 24) & 0x0F)
+#define BTF_INT_OFFSET(v)    (((v) >> 16) & 0xFF)
+#define BTF_INT_BITS(v)      ((v) & 0xFF)
+
+typedef struct {
+    uint32_t type;
+    uint32_t index_type;
+    uint32_t nelems;
+} BtfArray;
+
+typedef struct {
+    uint32_t name_off;
+    uint32_t type;
+    uint32_t offset;
+} BtfMember;
+
+typedef struct {
+    uint32_t name_off;
+    int32_t  val;
+} BtfEnum;
+
+typedef struct {
+    uint32_t name_off;
+    uint32_t val_lo32;
+    uint32_t val_hi32;
+} BtfEnum64;
+
+typedef struct {
+    uint32_t name_off;
+    uint32_t type;
+} BtfParam;
+
+
+struct _EolBtf {
+    const uint8_t  *types;
+    const char     *strings;
+    uint32_t        strings_size;
+    uint32_t        n_types;
+    uint32_t       *offsets;  /* Indexed by type id. */
+};
+
+
+/*
+ * The section is not guaranteed to be aligned, so data is always copied
+ * out instead of accessing it through pointers to the structures above.
+ */
+static inline void
+btf_get (const EolBtf *btf,
+         uint32_t      id,
+         BtfType      *type)
+{
+    memcpy (type, btf->types + btf->offsets[id], sizeof (BtfType));
+}
+
+static inline void
+btf_get_extra (const EolBtf *btf,
+               uint32_t      id,
+               size_t        offset,
+               void         *data,
+               size_t        size)
+{
+    memcpy (data, btf->types + btf->offsets[id] + sizeof (BtfType) + offset,
+            size);
+}
+
+
+static inline const char*
+btf_string (const EolBtf *btf,
+            uint32_t      offset)
+{
+    /* Offset zero is the empty string, used for anonymous entities. */
+    return (offset && offset < btf->strings_size)
+        ? btf->strings + offset : NULL;
+}
+
+
+/*
+ * Size of the data which follows the common part of each type.
+ */
+static bool
+btf_type_extra_size (const BtfType *type,
+                     size_t        *size)
+{
+    const uint32_t vlen = BTF_INFO_VLEN (type->info);
+
+    switch (BTF_INFO_KIND (type->info)) {
+        case EOL_BTF_KIND_PTR:
+        case EOL_BTF_KIND_FWD:
+        case EOL_BTF_KIND_TYPEDEF:
+        case EOL_BTF_KIND_VOLATILE:
+        case EOL_BTF_KIND_CONST:
+        case EOL_BTF_KIND_RESTRICT:
+        case EOL_BTF_KIND_FUNC:
+        case EOL_BTF_KIND_FLOAT:
+        case EOL_BTF_KIND_TYPE_TAG:
+            *size = 0;
+            return true;
+        case EOL_BTF_KIND_INT:
+        case EOL_BTF_KIND_VAR:
+        case EOL_BTF_KIND_DECL_TAG:
+            *size = sizeof (uint32_t);
+            return true;
+        case EOL_BTF_KIND_ARRAY:
+            *size = sizeof (BtfArray);
+            return true;
+        case EOL_BTF_KIND_STRUCT:
+        case EOL_BTF_KIND_UNION:
+        case EOL_BTF_KIND_DATASEC: /* Same size as BtfMember. */
+            *size = vlen * sizeof (BtfMember);
+            return true;
+        case EOL_BTF_KIND_ENUM:
+            *size = vlen * sizeof (BtfEnum);
+            return true;
+        case EOL_BTF_KIND_FUNC_PROTO:
+            *size = vlen * sizeof (BtfParam);
+            return true;
+        case EOL_BTF_KIND_ENUM64:
+            *size = vlen * sizeof (BtfEnum64);
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+EolBtf*
+eol_btf_new (EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    uint32_t index;
+    if (!eol_elf_find_section (elf, ".BTF", &index))
+        return NULL;
+
+    size_t size;
+    const uint8_t *data = eol_elf_section_data (elf, index, &size);
+    if (!data || size < sizeof (BtfHeader))
+        return NULL;
+
+    BtfHeader header;
+    memcpy (&header, data, sizeof (BtfHeader));
+    if (header.magic != BTF_MAGIC || header.version != 1 ||
+        header.hdr_len < sizeof (BtfHeader) || header.hdr_len > size ||
+        header.type_off % sizeof (uint32_t) ||
+        (uint64_t) header.type_off + header.type_len > size - header.hdr_len ||
+        (uint64_t) header.str_off + header.str_len > size - header.hdr_len ||
+        header.str_len == 0) {
+        TRACE ("%s: invalid BTF header\n", eol_elf_path (elf));
+        return NULL;
+    }
+
+    const uint8_t *types = data + header.hdr_len + header.type_off;
+    const char *strings = (const char*) data + header.hdr_len + header.str_off;
+    if (strings[header.str_len - 1] != '\0') {
+        TRACE ("%s: invalid BTF string table\n", eol_elf_path (elf));
+        return NULL;
+    }
+
+    /* Index the types; the entry for "void" (id 0) is unused. */
+    uint32_t n_alloc = 64;
+    uint32_t *offsets = malloc (n_alloc * sizeof (uint32_t));
+    uint32_t n_types = 0;
+    offsets[0] = 0;
+
+    for (uint32_t offset = 0; offset < header.type_len;) {
+        BtfType type;
+        size_t extra = 0;
+        if (header.type_len - offset >= sizeof (BtfType))
+            memcpy (&type, types + offset, sizeof (BtfType));
+        else
+            type.info = 0; /* Unknown kind, checked below. */
+
+        if (!btf_type_extra_size (&type, &extra) ||
+            header.type_len - offset - sizeof (BtfType) < extra) {
+            TRACE ("%s: invalid BTF type at offset %" PRIu32 "\n",
+                   eol_elf_path (elf), offset);
+            free (offsets);
+            return NULL;
+        }
+
+        if (++n_types == n_alloc) {
+            n_alloc *= 2;
+            offsets = realloc (offsets, n_alloc * sizeof (uint32_t));
+        }
+        offsets[n_types] = offset;
+        offset += sizeof (BtfType) + extra;
+    }
+
+    EolBtf *btf = calloc (1, sizeof (EolBtf));
+    btf->types = types;
+    btf->strings = strings;
+    btf->strings_size = header.str_len;
+    btf->n_types = n_types;
+    btf->offsets = offsets;
+
+    TRACE_PTR (>, EolBtf, btf, " [%s] %" PRIu32 " types\n",
+               eol_elf_path (elf), n_types);
+    return btf;
+}
+
+
+void
+eol_btf_free (EolBtf *btf)
+{
+    CHECK_NOT_NULL (btf);
+    TRACE_PTR (<, EolBtf, btf, "\n");
+
+    free (btf->offsets);
+    free (btf);
+}
+
+
+uint32_t
+eol_btf_n_types (const EolBtf *btf)
+{
+    CHECK_NOT_NULL (btf);
+    return btf->n_types;
+}
+
+
+bool
+eol_btf_type (const EolBtf *btf,
+              uint32_t      id,
+              EolBtfType   *result)
+{
+    CHECK_NOT_NULL (btf);
+    CHECK_NOT_NULL (result);
+
+    if (id == 0 || id > btf->n_types)
+        return false;
+
+    BtfType type;
+    btf_get (btf, id, &type);
+    memset (result, 0x00, sizeof (EolBtfType));
+    result->name      = btf_string (btf, type.name_off);
+    result->kind      = BTF_INFO_KIND (type.info);
+    result->kind_flag = BTF_INFO_KFLAG (type.info);
+    result->vlen      = BTF_INFO_VLEN (type.info);
+
+    switch (result->kind) {
+        case EOL_BTF_KIND_INT: {
+            uint32_t value;
+            btf_get_extra (btf, id, 0, &value, sizeof (uint32_t));
+            result->size     = type.size_type;
+            result->encoding = BTF_INT_ENCODING (value);
+            result->bits     = BTF_INT_BITS (value);
+            break;
+        }
+
+        case EOL_BTF_KIND_ARRAY: {
+            BtfArray array;
+            btf_get_extra (btf, id, 0, &array, sizeof (BtfArray));
+            result->type    = array.type;
+            result->n_items = array.nelems;
+            break;
+        }
+
+        case EOL_BTF_KIND_STRUCT:
+        case EOL_BTF_KIND_UNION:
+        case EOL_BTF_KIND_ENUM:
+        case EOL_BTF_KIND_ENUM64:
+        case EOL_BTF_KIND_FLOAT:
+        case EOL_BTF_KIND_DATASEC:
+            result->size = type.size_type;
+            break;
+
+        default:
+            result->type = type.size_type;
+            break;
+    }
+
+    /* Referenced types must be valid, or "void". */
+    return result->type <= btf->n_types;
+}
+
+
+bool
+eol_btf_member (const EolBtf *btf,
+                uint32_t      id,
+                uint32_t      index,
+                EolBtfMember *member)
+{
+    CHECK_NOT_NULL (btf);
+    CHECK_NOT_NULL (member);
+
+    if (id == 0 || id > btf->n_types)
+        return false;
+
+    BtfType type;
+    btf_get (btf, id, &type);
+    if (index >= BTF_INFO_VLEN (type.info))
+        return false;
+
+    memset (member, 0x00, sizeof (EolBtfMember));
+    switch (BTF_INFO_KIND (type.info)) {
+        case EOL_BTF_KIND_STRUCT:
+        case EOL_BTF_KIND_UNION: {
+            BtfMember m;
+            btf_get_extra (btf, id, index * sizeof (m), &m, sizeof (m));
+            member->name = btf_string (btf, m.name_off);
+            member->type = m.type;
+            if (BTF_INFO_KFLAG (type.info)) {
+                member->bit_offset = m.offset & 0xFFFFFF;
+                member->bit_size   = m.offset >> 24;
+            } else {
+                member->bit_offset = m.offset;
+            }
+            break;
+        }
+
+        case EOL_BTF_KIND_ENUM: {
+            BtfEnum e;
+            btf_get_extra (btf, id, index * sizeof (e), &e, sizeof (e));
+            member->name = btf_string (btf, e.name_off);
+            /*
+             * Newer encoders unset the kind_flag for unsigned enums, but
+             * older ones always did, so values are always taken as signed.
+             */
+            member->value = e.val;
+            break;
+        }
+
+        case EOL_BTF_KIND_ENUM64: {
+            BtfEnum64 e;
+            btf_get_extra (btf, id, index * sizeof (e), &e, sizeof (e));
+            member->name  = btf_string (btf, e.name_off);
+            member->value = (int64_t) (((uint64_t) e.val_hi32 << 32) |
+                                       e.val_lo32);
+            break;
+        }
+
+        case EOL_BTF_KIND_FUNC_PROTO: {
+            BtfParam p;
+            btf_get_extra (btf, id, index * sizeof (p), &p, sizeof (p));
+            member->name = btf_string (btf, p.name_off);
+            member->type = p.type;
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    return member->type <= btf->n_types;
+}
+
+
+bool
+eol_btf_find (const EolBtf *btf,
+              const char   *name,
+              EolBtfLookup  lookup,
+              uint32_t     *id)
+{
+    CHECK_NOT_NULL (btf);
+    CHECK_NOT_NULL (name);
+    CHECK_NOT_NULL (id);
+
+    uint32_t declaration = 0;
+
+    /*
+     * TODO: This performs a linear search, like the DWARF lookups do.
+     */
+    for (uint32_t i = 1; i <= btf->n_types; i++) {
+        BtfType type;
+        btf_get (btf, i, &type);
+        const char *type_name = btf_string (btf, type.name_off);
+        if (!type_name || !string_equal (name, type_name))
+            continue;
+
+        switch (BTF_INFO_KIND (type.info)) {
+            case EOL_BTF_KIND_FUNC:
+            case EOL_BTF_KIND_VAR:
+                if (lookup == EOL_BTF_LOOKUP_SYMBOL) {
+                    *id = i;
+                    return true;
+                }
+                break;
+
+            case EOL_BTF_KIND_FWD:
+                if (lookup == EOL_BTF_LOOKUP_TYPE && !declaration)
+                    declaration = i;
+                break;
+
+            case EOL_BTF_KIND_INT:
+            case EOL_BTF_KIND_FLOAT:
+            case EOL_BTF_KIND_STRUCT:
+            case EOL_BTF_KIND_UNION:
+            case EOL_BTF_KIND_ENUM:
+            case EOL_BTF_KIND_ENUM64:
+            case EOL_BTF_KIND_TYPEDEF:
+                if (lookup == EOL_BTF_LOOKUP_TYPE) {
+                    *id = i;
+                    return true;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (declaration) {
+        *id = declaration;
+        return true;
+    }
+    return false;
+}
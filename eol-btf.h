@@ -0,0 +1,104 @@
+/*
+ * eol-btf.h
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#ifndef EOL_BTF_H
+#define EOL_BTF_H
+
+#include "eol-elf.h"
+
+
+/*
+ * Reader for the BPF Type Format (".BTF" section), which describes the C
+ * types, functions and variables of an object in a much more compact way
+ * than DWARF. Types are identified by their index in the type table (the
+ * "type id"), starting at 1. The type id 0 is always "void".
+ */
+typedef struct _EolBtf EolBtf;
+
+typedef enum {
+    EOL_BTF_KIND_UNKNOWN    = 0,
+    EOL_BTF_KIND_INT        = 1,
+    EOL_BTF_KIND_PTR        = 2,
+    EOL_BTF_KIND_ARRAY      = 3,
+    EOL_BTF_KIND_STRUCT     = 4,
+    EOL_BTF_KIND_UNION      = 5,
+    EOL_BTF_KIND_ENUM       = 6,
+    EOL_BTF_KIND_FWD        = 7,
+    EOL_BTF_KIND_TYPEDEF    = 8,
+    EOL_BTF_KIND_VOLATILE   = 9,
+    EOL_BTF_KIND_CONST      = 10,
+    EOL_BTF_KIND_RESTRICT   = 11,
+    EOL_BTF_KIND_FUNC       = 12,
+    EOL_BTF_KIND_FUNC_PROTO = 13,
+    EOL_BTF_KIND_VAR        = 14,
+    EOL_BTF_KIND_DATASEC    = 15,
+    EOL_BTF_KIND_FLOAT      = 16,
+    EOL_BTF_KIND_DECL_TAG   = 17,
+    EOL_BTF_KIND_TYPE_TAG   = 18,
+    EOL_BTF_KIND_ENUM64     = 19,
+} EolBtfKind;
+
+/* Flags in the "encoding" of EOL_BTF_KIND_INT types. */
+enum {
+    EOL_BTF_INT_SIGNED = 1 << 0,
+    EOL_BTF_INT_CHAR   = 1 << 1,
+    EOL_BTF_INT_BOOL   = 1 << 2,
+};
+
+typedef struct {
+    const char *name;      /* NULL for anonymous types.            */
+    EolBtfKind  kind;
+    bool        kind_flag;
+    uint32_t    vlen;      /* Number of members or parameters.     */
+    uint32_t    size;      /* INT, FLOAT, STRUCT, UNION, ENUM*.    */
+    uint32_t    type;      /* Referenced type (PTR, TYPEDEF, ...). */
+    uint32_t    n_items;   /* ARRAY only.                          */
+    uint8_t     encoding;  /* INT only.                            */
+    uint8_t     bits;      /* INT only.                            */
+} EolBtfType;
+
+typedef struct {
+    const char *name;      /* May be NULL for anonymous members.   */
+    uint32_t    type;      /* STRUCT, UNION, and FUNC_PROTO.       */
+    uint32_t    bit_offset;
+    uint32_t    bit_size;  /* Zero unless the member is a bitfield. */
+    int64_t     value;     /* ENUM and ENUM64.                     */
+} EolBtfMember;
+
+typedef enum {
+    EOL_BTF_LOOKUP_TYPE,   /* Named types (typedefs, structs, ...). */
+    EOL_BTF_LOOKUP_SYMBOL, /* Functions and variables.              */
+} EolBtfLookup;
+
+
+/*
+ * Returns NULL if the object does not have a ".BTF" section, or if it is
+ * not valid (or in a different byte order than the host).
+ */
+extern EolBtf* eol_btf_new  (EolElf *elf);
+extern void    eol_btf_free (EolBtf *btf);
+
+extern uint32_t eol_btf_n_types (const EolBtf *btf);
+
+extern bool eol_btf_type   (const EolBtf *btf,
+                            uint32_t      id,
+                            EolBtfType   *type);
+extern bool eol_btf_member (const EolBtf *btf,
+                            uint32_t      id,
+                            uint32_t      index,
+                            EolBtfMember *member);
+
+/*
+ * Finds a type, function or variable by name. When looking up types,
+ * complete definitions are preferred over forward declarations.
+ */
+extern bool eol_btf_find   (const EolBtf *btf,
+                            const char   *name,
+                            EolBtfLookup  lookup,
+                            uint32_t     *id);
+
+#endif /* !EOL_BTF_H */
@@ -0,0 +1,1038 @@
+/*
+ * eol-dwarf.c
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "eol-dwarf.h"
+#include "eol-trace.h"
+#include "eol-util.h"
+
+#include <stdlib.h>
+
+
+/*
+ * Only the constants needed by the reader are defined here, to avoid
+ * depending on the headers from libdwarf.
+ */
+enum {
+    DW_AT_sibling              = 0x01,
+    DW_AT_name                 = 0x03,
+    DW_AT_data_member_location = 0x38,
+    DW_AT_str_offsets_base     = 0x72,
+};
+
+enum {
+    DW_FORM_addr           = 0x01,
+    DW_FORM_block2         = 0x03,
+    DW_FORM_block4         = 0x04,
+    DW_FORM_data2          = 0x05,
+    DW_FORM_data4          = 0x06,
+    DW_FORM_data8          = 0x07,
+    DW_FORM_string         = 0x08,
+    DW_FORM_block          = 0x09,
+    DW_FORM_block1         = 0x0a,
+    DW_FORM_data1          = 0x0b,
+    DW_FORM_flag           = 0x0c,
+    DW_FORM_sdata          = 0x0d,
+    DW_FORM_strp           = 0x0e,
+    DW_FORM_udata          = 0x0f,
+    DW_FORM_ref_addr       = 0x10,
+    DW_FORM_ref1           = 0x11,
+    DW_FORM_ref2           = 0x12,
+    DW_FORM_ref4           = 0x13,
+    DW_FORM_ref8           = 0x14,
+    DW_FORM_ref_udata      = 0x15,
+    DW_FORM_indirect       = 0x16,
+    DW_FORM_sec_offset     = 0x17,
+    DW_FORM_exprloc        = 0x18,
+    DW_FORM_flag_present   = 0x19,
+    DW_FORM_strx           = 0x1a,
+    DW_FORM_addrx          = 0x1b,
+    DW_FORM_ref_sup4       = 0x1c,
+    DW_FORM_strp_sup       = 0x1d,
+    DW_FORM_data16         = 0x1e,
+    DW_FORM_line_strp      = 0x1f,
+    DW_FORM_ref_sig8       = 0x20,
+    DW_FORM_implicit_const = 0x21,
+    DW_FORM_loclistx       = 0x22,
+    DW_FORM_rnglistx       = 0x23,
+    DW_FORM_ref_sup8       = 0x24,
+    DW_FORM_strx1          = 0x25,
+    DW_FORM_strx2          = 0x26,
+    DW_FORM_strx3          = 0x27,
+    DW_FORM_strx4          = 0x28,
+    DW_FORM_addrx1         = 0x29,
+    DW_FORM_addrx2         = 0x2a,
+    DW_FORM_addrx3         = 0x2b,
+    DW_FORM_addrx4         = 0x2c,
+    DW_FORM_GNU_addr_index = 0x1f01,
+    DW_FORM_GNU_str_index  = 0x1f02,
+    DW_FORM_GNU_ref_alt    = 0x1f20,
+    DW_FORM_GNU_strp_alt   = 0x1f21,
+};
+
+enum {
+    DW_UT_compile       = 0x01,
+    DW_UT_type          = 0x02,
+    DW_UT_partial       = 0x03,
+    DW_UT_skeleton      = 0x04,
+    DW_UT_split_compile = 0x05,
+    DW_UT_split_type    = 0x06,
+};
+
+enum {
+    DW_OP_plus_uconst = 0x23,
+};
+
+/* Limit for the size of the abbreviation table lookup arrays. */
+#define MAX_ABBREV_CODE (1 << 20)
+
+
+typedef struct {
+    const uint8_t *data;
+    size_t         size;
+} Section;
+
+typedef struct {
+    const uint8_t *specs;
+    uint16_t       tag;
+    bool           has_children;
+} Abbrev;
+
+struct _EolDwarfUnit {
+    uint64_t  offset;
+    uint64_t  end;
+    uint64_t  die_offset;
+    uint64_t  abbrev_offset;
+    uint64_t  str_offsets_base;
+    uint16_t  version;
+    uint8_t   address_size;
+    uint8_t   offset_size;
+    bool      str_offsets_base_known;
+    bool      abbrevs_loaded;
+    Abbrev   *abbrevs;
+    uint32_t  n_abbrevs;
+};
+
+struct _EolDwarf {
+    Section       info;
+    Section       abbrev;
+    Section       str;
+    Section       line_str;
+    Section       str_offsets;
+    bool          is_dwo;
+    EolDwarfUnit *units;
+    uint32_t      n_units;
+};
+
+
+/*
+ * Bounds-checked reading of values.
+ */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} Cursor;
+
+static inline bool
+read_uint (Cursor *c, unsigned size, uint64_t *value)
+{
+    if ((size_t) (c->end - c->p) < size)
+        return false;
+
+    uint64_t v = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (unsigned i = size; i > 0; i--)
+        v = (v << 8) | c->p[i - 1];
+#else
+    for (unsigned i = 0; i < size; i++)
+        v = (v << 8) | c->p[i];
+#endif
+    c->p += size;
+    *value = v;
+    return true;
+}
+
+static inline bool
+read_uleb128 (Cursor *c, uint64_t *value)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; c->p < c->end; shift += 7) {
+        const uint8_t byte = *c->p++;
+        if (shift < 64)
+            v |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool
+read_sleb128 (Cursor *c, int64_t *value)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; c->p < c->end;) {
+        const uint8_t byte = *c->p++;
+        if (shift < 64)
+            v |= (uint64_t) (byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            if (shift < 64 && (byte & 0x40))
+                v |= ~UINT64_C(0) << shift;
+            *value = (int64_t) v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool
+skip_bytes (Cursor *c, uint64_t count)
+{
+    if ((uint64_t) (c->end - c->p) < count)
+        return false;
+    c->p += count;
+    return true;
+}
+
+
+static inline void
+dwarf_get_section (EolElf     *elf,
+                   const char *name,
+                   Section    *section)
+{
+    uint32_t index;
+    section->data = NULL;
+    section->size = 0;
+    if (eol_elf_find_section (elf, name, &index))
+        section->data = eol_elf_section_data (elf, index, &section->size);
+}
+
+
+static bool
+dwarf_read_units (EolDwarf *dwarf)
+{
+    uint32_t n_alloc = 0;
+    uint64_t offset = 0;
+
+    while (dwarf->info.size - offset > 4) {
+        Cursor c = {
+            dwarf->info.data + offset,
+            dwarf->info.data + dwarf->info.size,
+        };
+
+        EolDwarfUnit unit = { .offset = offset, .offset_size = 4 };
+        uint64_t length, version;
+        if (!read_uint (&c, 4, &length))
+            return false;
+        if (length == 0xFFFFFFFF) {
+            unit.offset_size = 8;
+            if (!read_uint (&c, 8, &length))
+                return false;
+        } else if (length >= 0xFFFFFFF0) {
+            return false;
+        }
+        if (length > (uint64_t) (c.end - c.p))
+            return false;
+        c.end = c.p + length;
+        unit.end = c.end - dwarf->info.data;
+
+        if (!read_uint (&c, 2, &version) || version < 2 || version > 5)
+            return false;
+        unit.version = version;
+
+        uint64_t address_size;
+        if (version >= 5) {
+            uint64_t unit_type;
+            if (!read_uint (&c, 1, &unit_type) ||
+                !read_uint (&c, 1, &address_size) ||
+                !read_uint (&c, unit.offset_size, &unit.abbrev_offset))
+                return false;
+            switch (unit_type) {
+                case DW_UT_compile:
+                case DW_UT_partial:
+                    break;
+                case DW_UT_skeleton:
+                case DW_UT_split_compile:
+                    if (!skip_bytes (&c, 8)) return false;
+                    break;
+                case DW_UT_type:
+                case DW_UT_split_type:
+                    if (!skip_bytes (&c, 8 + unit.offset_size)) return false;
+                    break;
+                default:
+                    return false;
+            }
+        } else {
+            if (!read_uint (&c, unit.offset_size, &unit.abbrev_offset) ||
+                !read_uint (&c, 1, &address_size))
+                return false;
+        }
+        unit.address_size = address_size;
+        unit.die_offset = c.p - dwarf->info.data;
+
+        if (dwarf->n_units == n_alloc) {
+            n_alloc = n_alloc ? n_alloc * 2 : 16;
+            dwarf->units = realloc (dwarf->units,
+                                    n_alloc * sizeof (EolDwarfUnit));
+        }
+        dwarf->units[dwarf->n_units++] = unit;
+        offset = unit.end;
+    }
+    return true;
+}
+
+
+EolDwarf*
+eol_dwarf_new (EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    /* Packages need the unit index, leave those to libdwarf. */
+    if (eol_elf_find_section (elf, ".debug_cu_index", NULL))
+        return NULL;
+
+    EolDwarf *dwarf = calloc (1, sizeof (EolDwarf));
+    dwarf_get_section (elf, ".debug_info", &dwarf->info);
+    if (dwarf->info.data) {
+        dwarf_get_section (elf, ".debug_abbrev", &dwarf->abbrev);
+        dwarf_get_section (elf, ".debug_str", &dwarf->str);
+        dwarf_get_section (elf, ".debug_line_str", &dwarf->line_str);
+        dwarf_get_section (elf, ".debug_str_offsets", &dwarf->str_offsets);
+    } else {
+        dwarf_get_section (elf, ".debug_info.dwo", &dwarf->info);
+        dwarf_get_section (elf, ".debug_abbrev.dwo", &dwarf->abbrev);
+        dwarf_get_section (elf, ".debug_str.dwo", &dwarf->str);
+        dwarf_get_section (elf, ".debug_str_offsets.dwo", &dwarf->str_offsets);
+        dwarf->is_dwo = true;
+    }
+
+    if (!dwarf->info.data || !dwarf->abbrev.data || !dwarf_read_units (dwarf)) {
+        TRACE ("%s: unsupported debug information\n", eol_elf_path (elf));
+        eol_dwarf_free (dwarf);
+        return NULL;
+    }
+
+    TRACE_PTR (>, EolDwarf, dwarf, " [%s] %" PRIu32 " units\n",
+               eol_elf_path (elf), dwarf->n_units);
+    return dwarf;
+}
+
+
+void
+eol_dwarf_free (EolDwarf *dwarf)
+{
+    CHECK_NOT_NULL (dwarf);
+    TRACE_PTR (<, EolDwarf, dwarf, "\n");
+
+    for (uint32_t i = 0; i < dwarf->n_units; i++)
+        free (dwarf->units[i].abbrevs);
+    free (dwarf->units);
+    free (dwarf);
+}
+
+
+static EolDwarfUnit*
+dwarf_find_unit (EolDwarf *dwarf,
+                 uint64_t  offset)
+{
+    uint32_t lo = 0, hi = dwarf->n_units;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        EolDwarfUnit *unit = &dwarf->units[mid];
+        if (offset < unit->offset) {
+            hi = mid;
+        } else if (offset >= unit->end) {
+            lo = mid + 1;
+        } else {
+            return (offset >= unit->die_offset) ? unit : NULL;
+        }
+    }
+    return NULL;
+}
+
+
+static bool
+abbrev_skip_specs (Cursor *c)
+{
+    for (;;) {
+        uint64_t attribute, form;
+        if (!read_uleb128 (c, &attribute) || !read_uleb128 (c, &form))
+            return false;
+        if (attribute == 0 && form == 0)
+            return true;
+        if (form == DW_FORM_implicit_const) {
+            int64_t value;
+            if (!read_sleb128 (c, &value))
+                return false;
+        }
+    }
+}
+
+
+static bool
+unit_load_abbrevs (EolDwarf     *dwarf,
+                   EolDwarfUnit *unit)
+{
+    if (unit->abbrevs_loaded)
+        return unit->abbrevs != NULL;
+
+    unit->abbrevs_loaded = true;
+    if (unit->abbrev_offset >= dwarf->abbrev.size)
+        return false;
+
+    const Cursor start = {
+        dwarf->abbrev.data + unit->abbrev_offset,
+        dwarf->abbrev.data + dwarf->abbrev.size,
+    };
+
+    /* First pass: validate, and find the highest code. */
+    uint64_t max_code = 0;
+    for (Cursor c = start;;) {
+        uint64_t code, tag;
+        if (!read_uleb128 (&c, &code))
+            return false;
+        if (code == 0)
+            break;
+        if (code > MAX_ABBREV_CODE ||
+            !read_uleb128 (&c, &tag) ||
+            !skip_bytes (&c, 1) ||
+            !abbrev_skip_specs (&c))
+            return false;
+        if (code > max_code)
+            max_code = code;
+    }
+
+    Abbrev *abbrevs = calloc (max_code + 1, sizeof (Abbrev));
+    for (Cursor c = start;;) {
+        /* Checks cannot fail after the first pass, but avoid warnings. */
+        uint64_t code, tag;
+        if (!read_uleb128 (&c, &code) || code == 0)
+            break;
+        if (!read_uleb128 (&c, &tag))
+            break;
+        abbrevs[code].tag = tag;
+        abbrevs[code].has_children = (*c.p++ != 0);
+        abbrevs[code].specs = c.p;
+        abbrev_skip_specs (&c);
+    }
+
+    unit->abbrevs = abbrevs;
+    unit->n_abbrevs = max_code + 1;
+    return true;
+}
+
+
+static EolDwarfStatus
+dwarf_die_at (EolDwarf     *dwarf,
+              EolDwarfUnit *unit,
+              uint64_t      offset,
+              EolDwarfDie  *die)
+{
+    if (offset >= unit->end)
+        return EOL_DWARF_NO_ENTRY;
+    if (offset < unit->die_offset || !unit_load_abbrevs (dwarf, unit))
+        return EOL_DWARF_ERROR;
+
+    Cursor c = { dwarf->info.data + offset, dwarf->info.data + unit->end };
+    uint64_t code;
+    if (!read_uleb128 (&c, &code))
+        return EOL_DWARF_ERROR;
+    if (code == 0)
+        return EOL_DWARF_NO_ENTRY;
+    if (code >= unit->n_abbrevs || !unit->abbrevs[code].specs)
+        return EOL_DWARF_ERROR;
+
+    die->unit         = unit;
+    die->specs        = unit->abbrevs[code].specs;
+    die->data         = c.p;
+    die->offset       = offset;
+    die->tag          = unit->abbrevs[code].tag;
+    die->has_children = unit->abbrevs[code].has_children;
+    return EOL_DWARF_OK;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die (EolDwarf    *dwarf,
+               uint64_t     offset,
+               EolDwarfDie *die)
+{
+    CHECK_NOT_NULL (dwarf);
+    CHECK_NOT_NULL (die);
+
+    EolDwarfUnit *unit = dwarf_find_unit (dwarf, offset);
+    if (!unit)
+        return EOL_DWARF_ERROR;
+
+    EolDwarfStatus status = dwarf_die_at (dwarf, unit, offset, die);
+    return (status == EOL_DWARF_NO_ENTRY) ? EOL_DWARF_ERROR : status;
+}
+
+
+/*
+ * Advances the cursor past a value of the given form.
+ */
+static bool
+skip_form (const EolDwarfUnit *unit,
+           Cursor             *c,
+           uint64_t            form)
+{
+    uint64_t length;
+
+    switch (form) {
+        case DW_FORM_flag_present:
+        case DW_FORM_implicit_const:
+            return true;
+
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+        case DW_FORM_strx1:
+        case DW_FORM_addrx1:
+            return skip_bytes (c, 1);
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        case DW_FORM_strx2:
+        case DW_FORM_addrx2:
+            return skip_bytes (c, 2);
+        case DW_FORM_strx3:
+        case DW_FORM_addrx3:
+            return skip_bytes (c, 3);
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+        case DW_FORM_ref_sup4:
+        case DW_FORM_strx4:
+        case DW_FORM_addrx4:
+            return skip_bytes (c, 4);
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+        case DW_FORM_ref_sup8:
+            return skip_bytes (c, 8);
+        case DW_FORM_data16:
+            return skip_bytes (c, 16);
+
+        case DW_FORM_addr:
+            return skip_bytes (c, unit->address_size);
+        case DW_FORM_ref_addr:
+            return skip_bytes (c, (unit->version <= 2) ? unit->address_size
+                                                       : unit->offset_size);
+        case DW_FORM_strp:
+        case DW_FORM_line_strp:
+        case DW_FORM_sec_offset:
+        case DW_FORM_strp_sup:
+        case DW_FORM_GNU_ref_alt:
+        case DW_FORM_GNU_strp_alt:
+            return skip_bytes (c, unit->offset_size);
+
+        case DW_FORM_sdata:
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_strx:
+        case DW_FORM_addrx:
+        case DW_FORM_loclistx:
+        case DW_FORM_rnglistx:
+        case DW_FORM_GNU_addr_index:
+        case DW_FORM_GNU_str_index:
+            return read_uleb128 (c, &length);
+
+        case DW_FORM_string: {
+            const uint8_t *nul = memchr (c->p, '\0', c->end - c->p);
+            if (!nul) return false;
+            c->p = nul + 1;
+            return true;
+        }
+
+        case DW_FORM_block1:
+            return read_uint (c, 1, &length) && skip_bytes (c, length);
+        case DW_FORM_block2:
+            return read_uint (c, 2, &length) && skip_bytes (c, length);
+        case DW_FORM_block4:
+            return read_uint (c, 4, &length) && skip_bytes (c, length);
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+            return read_uleb128 (c, &length) && skip_bytes (c, length);
+
+        case DW_FORM_indirect:
+            return read_uleb128 (c, &form) && form != DW_FORM_indirect &&
+                skip_form (unit, c, form);
+
+        default:
+            return false;
+    }
+}
+
+
+typedef struct {
+    uint64_t form;
+    int64_t  implicit_const;
+    Cursor   value;
+} Attribute;
+
+/*
+ * Walks the attributes of a DIE. If "attribute" is zero, no attribute is
+ * matched and the cursor is left at the end of the DIE.
+ */
+static EolDwarfStatus
+die_find_attribute (EolDwarf          *dwarf,
+                    const EolDwarfDie *die,
+                    uint16_t           attribute,
+                    Attribute         *result)
+{
+    const EolDwarfUnit *unit = die->unit;
+    Cursor specs = { die->specs, dwarf->abbrev.data + dwarf->abbrev.size };
+    Cursor data  = { die->data,  dwarf->info.data + unit->end };
+
+    for (;;) {
+        uint64_t name, form;
+        int64_t implicit_const = 0;
+        if (!read_uleb128 (&specs, &name) || !read_uleb128 (&specs, &form))
+            return EOL_DWARF_ERROR;
+        if (name == 0 && form == 0) {
+            result->value = data;
+            return attribute ? EOL_DWARF_NO_ENTRY : EOL_DWARF_OK;
+        }
+        if (form == DW_FORM_implicit_const &&
+            !read_sleb128 (&specs, &implicit_const))
+            return EOL_DWARF_ERROR;
+
+        if (form == DW_FORM_indirect) {
+            if (!read_uleb128 (&data, &form) || form == DW_FORM_indirect)
+                return EOL_DWARF_ERROR;
+        }
+
+        if (attribute && name == attribute) {
+            result->form = form;
+            result->implicit_const = implicit_const;
+            result->value = data;
+            return EOL_DWARF_OK;
+        }
+        if (!skip_form (unit, &data, form))
+            return EOL_DWARF_ERROR;
+    }
+}
+
+
+static EolDwarfStatus
+die_get_attribute (EolDwarf          *dwarf,
+                   const EolDwarfDie *die,
+                   uint16_t           attribute,
+                   Attribute         *result)
+{
+    CHECK_NOT_NULL (dwarf);
+    CHECK_NOT_NULL (die);
+    CHECK_NOT_NULL (result);
+    CHECK_UINT_NE (0, attribute);
+    return die_find_attribute (dwarf, die, attribute, result);
+}
+
+
+static bool
+attribute_data (const Attribute *attr,
+                bool             sign_extend,
+                uint64_t        *value)
+{
+    Cursor c = attr->value;
+    unsigned size;
+
+    switch (attr->form) {
+        case DW_FORM_data1: size = 1; break;
+        case DW_FORM_data2: size = 2; break;
+        case DW_FORM_data4: size = 4; break;
+        case DW_FORM_data8: size = 8; break;
+        case DW_FORM_udata:
+            return read_uleb128 (&c, value);
+        case DW_FORM_sdata:
+            return read_sleb128 (&c, (int64_t*) value);
+        case DW_FORM_implicit_const:
+            *value = (uint64_t) attr->implicit_const;
+            return true;
+        default:
+            return false;
+    }
+
+    if (!read_uint (&c, size, value))
+        return false;
+    if (sign_extend && size < 8 && (*value & (UINT64_C(1) << (size * 8 - 1))))
+        *value |= ~UINT64_C(0) << (size * 8);
+    return true;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_uint (EolDwarf          *dwarf,
+                    const EolDwarfDie *die,
+                    uint16_t           attribute,
+                    uint64_t          *value)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die, attribute, &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+
+    if (attr.form == DW_FORM_sec_offset) {
+        Cursor c = attr.value;
+        return read_uint (&c, die->unit->offset_size, value)
+            ? EOL_DWARF_OK : EOL_DWARF_ERROR;
+    }
+    if (!attribute_data (&attr, false, value))
+        return EOL_DWARF_ERROR;
+    if (attr.form == DW_FORM_sdata || attr.form == DW_FORM_implicit_const)
+        return ((int64_t) *value < 0) ? EOL_DWARF_ERROR : EOL_DWARF_OK;
+    return EOL_DWARF_OK;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_sint (EolDwarf          *dwarf,
+                    const EolDwarfDie *die,
+                    uint16_t           attribute,
+                    int64_t           *value)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die, attribute, &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+    return attribute_data (&attr, true, (uint64_t*) value)
+        ? EOL_DWARF_OK : EOL_DWARF_ERROR;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_flag (EolDwarf          *dwarf,
+                    const EolDwarfDie *die,
+                    uint16_t           attribute,
+                    bool              *value)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die, attribute, &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+
+    switch (attr.form) {
+        case DW_FORM_flag_present:
+            *value = true;
+            return EOL_DWARF_OK;
+        case DW_FORM_flag:
+            *value = (attr.value.p < attr.value.end) && *attr.value.p;
+            return (attr.value.p < attr.value.end)
+                ? EOL_DWARF_OK : EOL_DWARF_ERROR;
+        default:
+            return EOL_DWARF_ERROR;
+    }
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_ref (EolDwarf          *dwarf,
+                   const EolDwarfDie *die,
+                   uint16_t           attribute,
+                   uint64_t          *offset)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die, attribute, &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+
+    const EolDwarfUnit *unit = die->unit;
+    Cursor c = attr.value;
+    uint64_t value;
+    bool relative = true;
+    bool ok;
+
+    switch (attr.form) {
+        case DW_FORM_ref1: ok = read_uint (&c, 1, &value); break;
+        case DW_FORM_ref2: ok = read_uint (&c, 2, &value); break;
+        case DW_FORM_ref4: ok = read_uint (&c, 4, &value); break;
+        case DW_FORM_ref8: ok = read_uint (&c, 8, &value); break;
+        case DW_FORM_ref_udata:
+            ok = read_uleb128 (&c, &value);
+            break;
+        case DW_FORM_ref_addr:
+            ok = read_uint (&c, (unit->version <= 2) ? unit->address_size
+                                                     : unit->offset_size,
+                            &value);
+            relative = false;
+            break;
+        default:
+            /* Type signatures, supplementary files, etc. */
+            return EOL_DWARF_ERROR;
+    }
+
+    if (!ok)
+        return EOL_DWARF_ERROR;
+    if (relative)
+        value += unit->offset;
+    if (value >= dwarf->info.size)
+        return EOL_DWARF_ERROR;
+
+    *offset = value;
+    return EOL_DWARF_OK;
+}
+
+
+static const char*
+section_string (const Section *section,
+                uint64_t       offset)
+{
+    if (!section->data || offset >= section->size)
+        return NULL;
+
+    const char *s = (const char*) section->data + offset;
+    return memchr (s, '\0', section->size - offset) ? s : NULL;
+}
+
+
+static bool
+unit_str_offsets_base (EolDwarf     *dwarf,
+                       EolDwarfUnit *unit,
+                       uint64_t     *base)
+{
+    if (!unit->str_offsets_base_known) {
+        if (dwarf->is_dwo) {
+            /* Split units use the whole section, after its header. */
+            unit->str_offsets_base = (unit->version >= 5)
+                ? ((unit->offset_size == 8) ? 16 : 8) : 0;
+        } else {
+            EolDwarfDie root;
+            if (dwarf_die_at (dwarf, unit, unit->die_offset,
+                              &root) != EOL_DWARF_OK ||
+                eol_dwarf_die_uint (dwarf, &root, DW_AT_str_offsets_base,
+                                    &unit->str_offsets_base) != EOL_DWARF_OK)
+                return false;
+        }
+        unit->str_offsets_base_known = true;
+    }
+    *base = unit->str_offsets_base;
+    return true;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_string (EolDwarf          *dwarf,
+                      const EolDwarfDie *die,
+                      uint16_t           attribute,
+                      const char       **value)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die, attribute, &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+
+    EolDwarfUnit *unit = die->unit;
+    Cursor c = attr.value;
+    uint64_t offset, index;
+
+    switch (attr.form) {
+        case DW_FORM_string:
+            *value = memchr (c.p, '\0', c.end - c.p) ? (const char*) c.p : NULL;
+            break;
+
+        case DW_FORM_strp:
+            *value = read_uint (&c, unit->offset_size, &offset)
+                ? section_string (&dwarf->str, offset) : NULL;
+            break;
+
+        case DW_FORM_line_strp:
+            *value = read_uint (&c, unit->offset_size, &offset)
+                ? section_string (&dwarf->line_str, offset) : NULL;
+            break;
+
+        case DW_FORM_strx:
+        case DW_FORM_GNU_str_index:
+            if (!read_uleb128 (&c, &index))
+                return EOL_DWARF_ERROR;
+            goto indexed;
+        case DW_FORM_strx1:
+            if (!read_uint (&c, 1, &index)) return EOL_DWARF_ERROR;
+            goto indexed;
+        case DW_FORM_strx2:
+            if (!read_uint (&c, 2, &index)) return EOL_DWARF_ERROR;
+            goto indexed;
+        case DW_FORM_strx3:
+            if (!read_uint (&c, 3, &index)) return EOL_DWARF_ERROR;
+            goto indexed;
+        case DW_FORM_strx4:
+            if (!read_uint (&c, 4, &index)) return EOL_DWARF_ERROR;
+indexed: {
+            uint64_t base;
+            if (!unit_str_offsets_base (dwarf, unit, &base))
+                return EOL_DWARF_ERROR;
+
+            const uint64_t position = base + index * unit->offset_size;
+            if (!dwarf->str_offsets.data ||
+                position >= dwarf->str_offsets.size)
+                return EOL_DWARF_ERROR;
+
+            Cursor entry = {
+                dwarf->str_offsets.data + position,
+                dwarf->str_offsets.data + dwarf->str_offsets.size,
+            };
+            *value = read_uint (&entry, unit->offset_size, &offset)
+                ? section_string (&dwarf->str, offset) : NULL;
+            break;
+        }
+
+        default:
+            return EOL_DWARF_ERROR;
+    }
+
+    return *value ? EOL_DWARF_OK : EOL_DWARF_ERROR;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_name (EolDwarf          *dwarf,
+                    const EolDwarfDie *die,
+                    const char       **name)
+{
+    return eol_dwarf_die_string (dwarf, die, DW_AT_name, name);
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_member_location (EolDwarf          *dwarf,
+                               const EolDwarfDie *die,
+                               uint64_t          *offset)
+{
+    Attribute attr;
+    EolDwarfStatus status = die_get_attribute (dwarf, die,
+                                               DW_AT_data_member_location,
+                                               &attr);
+    if (status != EOL_DWARF_OK)
+        return status;
+
+    Cursor c = attr.value;
+    uint64_t length;
+
+    switch (attr.form) {
+        case DW_FORM_data4:
+        case DW_FORM_data8:
+            /* In DWARF 3 those are location list pointers. */
+            if (die->unit->version == 3)
+                return EOL_DWARF_ERROR;
+            /* fall-through */
+        case DW_FORM_data1:
+        case DW_FORM_data2:
+        case DW_FORM_udata:
+        case DW_FORM_sdata:
+        case DW_FORM_implicit_const:
+            return eol_dwarf_die_uint (dwarf, die,
+                                       DW_AT_data_member_location, offset);
+
+        case DW_FORM_block1:
+            if (!read_uint (&c, 1, &length)) return EOL_DWARF_ERROR;
+            break;
+        case DW_FORM_block2:
+            if (!read_uint (&c, 2, &length)) return EOL_DWARF_ERROR;
+            break;
+        case DW_FORM_block4:
+            if (!read_uint (&c, 4, &length)) return EOL_DWARF_ERROR;
+            break;
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+            if (!read_uleb128 (&c, &length)) return EOL_DWARF_ERROR;
+            break;
+
+        default:
+            return EOL_DWARF_ERROR;
+    }
+
+    /* Only a single DW_OP_plus_uconst operation is supported. */
+    if (length > (uint64_t) (c.end - c.p))
+        return EOL_DWARF_ERROR;
+    c.end = c.p + length;
+    if (c.p < c.end && *c.p++ == DW_OP_plus_uconst &&
+        read_uleb128 (&c, offset) && c.p == c.end)
+        return EOL_DWARF_OK;
+    return EOL_DWARF_ERROR;
+}
+
+
+/*
+ * Obtains the offset right after the attributes of a DIE.
+ */
+static bool
+die_end_offset (EolDwarf          *dwarf,
+                const EolDwarfDie *die,
+                uint64_t          *offset)
+{
+    Attribute attr;
+    if (die_find_attribute (dwarf, die, 0, &attr) != EOL_DWARF_OK)
+        return false;
+    *offset = attr.value.p - dwarf->info.data;
+    return true;
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_child (EolDwarf          *dwarf,
+                     const EolDwarfDie *die,
+                     EolDwarfDie       *child)
+{
+    CHECK_NOT_NULL (dwarf);
+    CHECK_NOT_NULL (die);
+    CHECK_NOT_NULL (child);
+
+    if (!die->has_children)
+        return EOL_DWARF_NO_ENTRY;
+
+    uint64_t offset;
+    if (!die_end_offset (dwarf, die, &offset))
+        return EOL_DWARF_ERROR;
+    return dwarf_die_at (dwarf, die->unit, offset, child);
+}
+
+
+EolDwarfStatus
+eol_dwarf_die_sibling (EolDwarf          *dwarf,
+                       const EolDwarfDie *die,
+                       EolDwarfDie       *sibling)
+{
+    CHECK_NOT_NULL (dwarf);
+    CHECK_NOT_NULL (die);
+    CHECK_NOT_NULL (sibling);
+
+    uint64_t offset;
+    if (die->has_children) {
+        /* Use DW_AT_sibling when available, to avoid walking the tree. */
+        EolDwarfStatus status = eol_dwarf_die_ref (dwarf, die,
+                                                   DW_AT_sibling, &offset);
+        if (status == EOL_DWARF_OK)
+            return dwarf_die_at (dwarf, die->unit, offset, sibling);
+        if (status == EOL_DWARF_ERROR)
+            return status;
+    }
+
+    if (!die_end_offset (dwarf, die, &offset))
+        return EOL_DWARF_ERROR;
+
+    /* Skip over the children, if any, until the end of the subtree. */
+    EolDwarfUnit *unit = die->unit;
+    for (unsigned depth = die->has_children ? 1 : 0; depth > 0;) {
+        EolDwarfDie current;
+        switch (dwarf_die_at (dwarf, unit, offset, &current)) {
+            case EOL_DWARF_NO_ENTRY:
+                if (offset >= unit->end)
+                    return EOL_DWARF_ERROR;
+                offset++; /* Null entries use a single byte. */
+                depth--;
+                break;
+            case EOL_DWARF_OK:
+                if (!die_end_offset (dwarf, &current, &offset))
+                    return EOL_DWARF_ERROR;
+                if (current.has_children)
+                    depth++;
+                break;
+            default:
+                return EOL_DWARF_ERROR;
+        }
+    }
+
+    return dwarf_die_at (dwarf, unit, offset, sibling);
+}
@@ -0,0 +1,94 @@
+/*
+ * eol-dwarf.h
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#ifndef EOL_DWARF_H
+#define EOL_DWARF_H
+
+#include "eol-elf.h"
+
+
+/*
+ * Minimal, read-only DWARF reader which works directly on the sections of
+ * an EolElf. It supports only the subset of DWARF (versions 2 to 5) needed
+ * to build type information, and does not allocate memory when reading
+ * DIEs: abbreviation tables are parsed once per unit, and strings point
+ * into the section data. Anything it does not understand is reported as
+ * EOL_DWARF_ERROR, so callers can fall back to using libdwarf.
+ *
+ * DIEs are addressed by their offset in the ".debug_info" section, which
+ * is the same as the offsets used by libdwarf.
+ */
+typedef struct _EolDwarf     EolDwarf;
+typedef struct _EolDwarfUnit EolDwarfUnit;
+
+typedef enum {
+    EOL_DWARF_OK,
+    EOL_DWARF_NO_ENTRY,
+    EOL_DWARF_ERROR,
+} EolDwarfStatus;
+
+typedef struct {
+    EolDwarfUnit  *unit;
+    const uint8_t *specs;   /* Attribute specifications (abbrev). */
+    const uint8_t *data;    /* Attribute values. */
+    uint64_t       offset;
+    uint16_t       tag;
+    bool           has_children;
+} EolDwarfDie;
+
+
+/*
+ * Returns NULL if the object has no debugging information, or if it uses
+ * features not supported by the reader (e.g. it is a DWARF package).
+ */
+extern EolDwarf* eol_dwarf_new  (EolElf   *elf);
+extern void      eol_dwarf_free (EolDwarf *dwarf);
+
+extern EolDwarfStatus eol_dwarf_die         (EolDwarf          *dwarf,
+                                             uint64_t           offset,
+                                             EolDwarfDie       *die);
+extern EolDwarfStatus eol_dwarf_die_child   (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             EolDwarfDie       *child);
+extern EolDwarfStatus eol_dwarf_die_sibling (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             EolDwarfDie       *sibling);
+
+/*
+ * Attribute accessors. Signed values of DW_FORM_data* attributes are sign
+ * extended, like libdwarf does. References are returned as offsets in the
+ * ".debug_info" section. The member location may be either a constant or
+ * a DW_OP_plus_uconst expression.
+ */
+extern EolDwarfStatus eol_dwarf_die_name    (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             const char       **name);
+extern EolDwarfStatus eol_dwarf_die_string  (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             uint16_t           attribute,
+                                             const char       **value);
+extern EolDwarfStatus eol_dwarf_die_uint    (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             uint16_t           attribute,
+                                             uint64_t          *value);
+extern EolDwarfStatus eol_dwarf_die_sint    (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             uint16_t           attribute,
+                                             int64_t           *value);
+extern EolDwarfStatus eol_dwarf_die_flag    (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             uint16_t           attribute,
+                                             bool              *value);
+extern EolDwarfStatus eol_dwarf_die_ref     (EolDwarf          *dwarf,
+                                             const EolDwarfDie *die,
+                                             uint16_t           attribute,
+                                             uint64_t          *offset);
+extern EolDwarfStatus eol_dwarf_die_member_location (EolDwarf          *dwarf,
+                                                     const EolDwarfDie *die,
+                                                     uint64_t          *offset);
+
+#endif /* !EOL_DWARF_H */
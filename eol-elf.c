@@ -0,0 +1,792 @@
+/*
+ * eol-elf.c
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "eol-elf.h"
+#include "eol-trace.h"
+#include "eol-util.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <elf.h>
+
+#if defined(EOL_HAVE_ZLIB) && EOL_HAVE_ZLIB
+# include <zlib.h>
+#endif /* EOL_HAVE_ZLIB */
+
+#if defined(EOL_HAVE_ZSTD) && EOL_HAVE_ZSTD
+# include <zstd.h>
+#endif /* EOL_HAVE_ZSTD */
+
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD 2
+#endif /* !ELFCOMPRESS_ZSTD */
+
+#if __SIZEOF_POINTER__ == 8
+# define EOL_ELF_CLASS ELFCLASS64
+# define ElfN(t) Elf64_ ## t
+#else
+# define EOL_ELF_CLASS ELFCLASS32
+# define ElfN(t) Elf32_ ## t
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define EOL_ELF_DATA ELFDATA2LSB
+#else
+# define EOL_ELF_DATA ELFDATA2MSB
+#endif
+
+#ifndef EOL_DEBUG_DIRS_DEFAULT
+#define EOL_DEBUG_DIRS_DEFAULT "/usr/lib/debug"
+#endif /* !EOL_DEBUG_DIRS_DEFAULT */
+
+
+typedef enum {
+    SECTION_PLAIN,
+    SECTION_ZLIB,       /* SHF_COMPRESSED, ELFCOMPRESS_ZLIB */
+    SECTION_ZSTD,       /* SHF_COMPRESSED, ELFCOMPRESS_ZSTD */
+    SECTION_ZDEBUG,     /* Legacy GNU ".zdebug_*" sections  */
+} ElfSectionCompression;
+
+typedef enum {
+    SECTION_UNLOADED,
+    SECTION_MAPPED,     /* Points into the mapped ELF file. */
+    SECTION_HEAP,       /* Decompressed into a malloc()d buffer. */
+    SECTION_CACHED,     /* Mapped from a file in the cache directory. */
+} ElfSectionStorage;
+
+typedef struct {
+    const char            *name;
+    char                  *name_alloc;
+    const void            *data;
+    size_t                 size;
+    ElfSectionCompression  compression;
+    ElfSectionStorage      storage;
+} ElfSection;
+
+
+struct _EolElf {
+    char              *path;
+    int                fd;
+    const uint8_t     *data;
+    size_t             size;
+    const ElfN(Ehdr)  *ehdr;
+    const ElfN(Shdr)  *shdr;
+    uint32_t           n_sections;
+    const char        *shstrtab;
+    size_t             shstrtab_size;
+    ElfSection        *sections;
+};
+
+
+static bool
+elf_validate_headers (EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    if (elf->size < sizeof (ElfN(Ehdr)))
+        return false;
+
+    const ElfN(Ehdr) *ehdr = (const ElfN(Ehdr)*) elf->data;
+    if (memcmp (ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != EOL_ELF_CLASS ||
+        ehdr->e_ident[EI_DATA] != EOL_ELF_DATA ||
+        ehdr->e_shentsize != sizeof (ElfN(Shdr)) ||
+        ehdr->e_shoff == 0 ||
+        ehdr->e_shoff > elf->size - sizeof (ElfN(Shdr)))
+        return false;
+
+    elf->ehdr = ehdr;
+    elf->shdr = (const ElfN(Shdr)*) (elf->data + ehdr->e_shoff);
+
+    /* Extended numbering: actual values are stored in the first entry. */
+    elf->n_sections = ehdr->e_shnum ? ehdr->e_shnum : elf->shdr[0].sh_size;
+    uint32_t shstrndx = (ehdr->e_shstrndx == SHN_XINDEX)
+        ? elf->shdr[0].sh_link : ehdr->e_shstrndx;
+
+    if (elf->n_sections > (elf->size - ehdr->e_shoff) / sizeof (ElfN(Shdr)) ||
+        shstrndx >= elf->n_sections)
+        return false;
+
+    const ElfN(Shdr) *strtab = &elf->shdr[shstrndx];
+    if (strtab->sh_type == SHT_NOBITS ||
+        strtab->sh_offset > elf->size ||
+        strtab->sh_size > elf->size - strtab->sh_offset)
+        return false;
+
+    elf->shstrtab = (const char*) (elf->data + strtab->sh_offset);
+    elf->shstrtab_size = strtab->sh_size;
+    return true;
+}
+
+
+static inline const uint8_t*
+elf_section_raw (const EolElf *elf,
+                 uint32_t      index,
+                 size_t       *size)
+{
+    const ElfN(Shdr) *shdr = &elf->shdr[index];
+    if (shdr->sh_type == SHT_NOBITS ||
+        shdr->sh_offset > elf->size ||
+        shdr->sh_size > elf->size - shdr->sh_offset) {
+        *size = 0;
+        return NULL;
+    }
+    *size = shdr->sh_size;
+    return elf->data + shdr->sh_offset;
+}
+
+
+static inline const char*
+elf_section_raw_name (const EolElf *elf,
+                      uint32_t      index)
+{
+    uint32_t offset = elf->shdr[index].sh_name;
+    if (offset >= elf->shstrtab_size)
+        return NULL;
+
+    /* Make sure that the name is properly terminated. */
+    const char *name = elf->shstrtab + offset;
+    if (!memchr (name, '\0', elf->shstrtab_size - offset))
+        return NULL;
+    return name;
+}
+
+
+/*
+ * Determines the compression used for each section, and the uncompressed
+ * size of its contents. Only headers are inspected: decompression is
+ * delayed until eol_elf_section_data() is used on a section.
+ */
+static void
+elf_setup_sections (EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    elf->sections = calloc (elf->n_sections, sizeof (ElfSection));
+
+    for (uint32_t i = 0; i < elf->n_sections; i++) {
+        ElfSection *section = &elf->sections[i];
+        const char *name = elf_section_raw_name (elf, i);
+        const uint8_t *raw = elf_section_raw (elf, i, &section->size);
+
+        section->name = name;
+        section->compression = SECTION_PLAIN;
+
+        if (!raw) continue;
+
+        if (elf->shdr[i].sh_flags & SHF_COMPRESSED) {
+            const ElfN(Chdr) *chdr = (const ElfN(Chdr)*) raw;
+            if (section->size < sizeof (ElfN(Chdr))) {
+                section->size = 0;
+                continue;
+            }
+            switch (chdr->ch_type) {
+                case ELFCOMPRESS_ZLIB:
+                    section->compression = SECTION_ZLIB;
+                    break;
+                case ELFCOMPRESS_ZSTD:
+                    section->compression = SECTION_ZSTD;
+                    break;
+                default:
+                    TRACE ("%s: section %s, unknown compression %#x\n",
+                           elf->path, name, (unsigned) chdr->ch_type);
+                    section->size = 0;
+                    continue;
+            }
+            section->size = chdr->ch_size;
+        } else if (name && strncmp (name, ".zdebug", 7) == 0 &&
+                   section->size >= 12 && memcmp (raw, "ZLIB", 4) == 0) {
+            /* "ZLIB", followed by the size as a 64-bit big-endian integer. */
+            uint64_t size = 0;
+            for (unsigned k = 4; k < 12; k++)
+                size = (size << 8) | raw[k];
+            section->size = size;
+            section->compression = SECTION_ZDEBUG;
+
+            /* Expose the section with its usual ".debug_*" name. */
+            section->name_alloc = malloc (strlen (name));
+            section->name_alloc[0] = '.';
+            strcpy (section->name_alloc + 1, name + 2);
+            section->name = section->name_alloc;
+        }
+    }
+}
+
+
+EolElf*
+eol_elf_open (const char *path)
+{
+    CHECK_NOT_NULL (path);
+
+    int fd = open (path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat sb;
+    if (fstat (fd, &sb) != 0) {
+        int saved_errno = errno;
+        close (fd);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    void *data = mmap (NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        int saved_errno = errno;
+        close (fd);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    EolElf *elf = calloc (1, sizeof (EolElf));
+    elf->path = strdup (path);
+    elf->fd   = fd;
+    elf->data = data;
+    elf->size = sb.st_size;
+
+    if (!elf_validate_headers (elf)) {
+        TRACE ("%s: invalid or unsupported ELF file\n", path);
+        eol_elf_close (elf);
+        errno = ENOEXEC;
+        return NULL;
+    }
+    elf_setup_sections (elf);
+
+    TRACE_PTR (>, EolElf, elf, " [%s] %" PRIu32 " sections\n",
+               path, elf->n_sections);
+    return elf;
+}
+
+
+void
+eol_elf_close (EolElf *elf)
+{
+    if (!elf) return;
+
+    TRACE_PTR (<, EolElf, elf, " [%s]\n", elf->path);
+
+    for (uint32_t i = 0; elf->sections && i < elf->n_sections; i++) {
+        ElfSection *section = &elf->sections[i];
+        switch (section->storage) {
+            case SECTION_HEAP:
+                free ((void*) section->data);
+                break;
+            case SECTION_CACHED:
+                munmap ((void*) section->data, section->size);
+                break;
+            default:
+                break;
+        }
+        free (section->name_alloc);
+    }
+    free (elf->sections);
+
+    munmap ((void*) elf->data, elf->size);
+    close (elf->fd);
+    free (elf->path);
+    free (elf);
+}
+
+
+const char*
+eol_elf_path (const EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+    return elf->path;
+}
+
+
+int
+eol_elf_fd (const EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+    return elf->fd;
+}
+
+
+uint32_t
+eol_elf_n_sections (const EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+    return elf->n_sections;
+}
+
+
+const char*
+eol_elf_section_name (const EolElf *elf,
+                      uint32_t      index)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_U32_LT (elf->n_sections, index);
+    return elf->sections[index].name;
+}
+
+
+bool
+eol_elf_find_section (const EolElf *elf,
+                      const char   *name,
+                      uint32_t     *index)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_NOT_NULL (name);
+
+    for (uint32_t i = 1; i < elf->n_sections; i++) {
+        if (string_equal (name, eol_elf_section_name (elf, i))) {
+            if (index) *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+size_t
+eol_elf_section_size (const EolElf *elf,
+                      uint32_t      index)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_U32_LT (elf->n_sections, index);
+    return elf->sections[index].size;
+}
+
+
+static bool
+elf_section_decompress (const EolElf *elf,
+                        uint32_t      index,
+                        void         *output,
+                        size_t        output_size)
+{
+    const ElfSection *section = &elf->sections[index];
+    size_t input_size;
+    const uint8_t *input = elf_section_raw (elf, index, &input_size);
+
+    switch (section->compression) {
+        case SECTION_ZDEBUG:
+            input += 12;
+            input_size -= 12;
+            /* fall-through */
+        case SECTION_ZLIB:
+            if (section->compression == SECTION_ZLIB) {
+                input += sizeof (ElfN(Chdr));
+                input_size -= sizeof (ElfN(Chdr));
+            }
+#if defined(EOL_HAVE_ZLIB) && EOL_HAVE_ZLIB
+            {
+                uLongf length = output_size;
+                return uncompress (output, &length, input, input_size) == Z_OK
+                    && length == output_size;
+            }
+#else
+            TRACE ("%s: section %s is zlib-compressed, but zlib support "
+                   "is disabled\n", elf->path, section->name);
+            return false;
+#endif /* EOL_HAVE_ZLIB */
+
+        case SECTION_ZSTD:
+            input += sizeof (ElfN(Chdr));
+            input_size -= sizeof (ElfN(Chdr));
+#if defined(EOL_HAVE_ZSTD) && EOL_HAVE_ZSTD
+            {
+                size_t length = ZSTD_decompress (output, output_size,
+                                                 input, input_size);
+                return !ZSTD_isError (length) && length == output_size;
+            }
+#else
+            TRACE ("%s: section %s is zstd-compressed, but zstd support "
+                   "is disabled\n", elf->path, section->name);
+            return false;
+#endif /* EOL_HAVE_ZSTD */
+
+        default:
+            CHECK_UNREACHABLE ();
+            return false;
+    }
+}
+
+
+/*
+ * Decompressed sections can be saved in the directory pointed to by the
+ * EOL_CACHE_DIR environment variable. Cache files are named after the
+ * build-id of the object and the section name, so objects without a
+ * build-id are never cached.
+ */
+static bool
+elf_section_cache_path (const EolElf *elf,
+                        uint32_t      index,
+                        char          path[PATH_MAX])
+{
+    const char *cache_dir = getenv ("EOL_CACHE_DIR");
+    if (!cache_dir || !*cache_dir)
+        return false;
+
+    size_t length;
+    const uint8_t *id = eol_elf_build_id (elf, &length);
+    if (!id)
+        return false;
+
+    int n = snprintf (path, PATH_MAX, "%s/", cache_dir);
+    for (size_t i = 0; i < length && n > 0 && n < PATH_MAX; i++)
+        n += snprintf (path + n, PATH_MAX - n, "%02x", id[i]);
+    return n > 0 && n < PATH_MAX &&
+        snprintf (path + n, PATH_MAX - n, "%s",
+                  elf->sections[index].name) < PATH_MAX - n;
+}
+
+
+static const void*
+elf_section_cache_load (const char *path,
+                        size_t      size)
+{
+    int fd = open (path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat sb;
+    void *data = MAP_FAILED;
+    if (fstat (fd, &sb) == 0 && sb.st_size == (off_t) size)
+        data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    return (data == MAP_FAILED) ? NULL : data;
+}
+
+
+static void
+elf_section_cache_store (const char *path,
+                         const void *data,
+                         size_t      size)
+{
+    /* Write to a temporary file, then rename to replace atomically. */
+    char tmp_path[PATH_MAX];
+    if (snprintf (tmp_path, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX)
+        return;
+
+    int fd = mkstemp (tmp_path);
+    if (fd < 0)
+        return;
+
+    const uint8_t *p = data;
+    size_t remaining = size;
+    while (remaining > 0) {
+        ssize_t written = write (fd, p, remaining);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            break;
+        p += written;
+        remaining -= written;
+    }
+
+    if (close (fd) != 0 || remaining > 0 || rename (tmp_path, path) != 0) {
+        TRACE ("could not write cache file %s\n", path);
+        unlink (tmp_path);
+    }
+}
+
+
+const void*
+eol_elf_section_data (EolElf   *elf,
+                      uint32_t  index,
+                      size_t   *size)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_U32_LT (elf->n_sections, index);
+
+    ElfSection *section = &elf->sections[index];
+    if (section->storage != SECTION_UNLOADED)
+        goto done;
+
+    if (section->compression == SECTION_PLAIN) {
+        size_t raw_size;
+        section->data = elf_section_raw (elf, index, &raw_size);
+        section->storage = SECTION_MAPPED;
+        goto done;
+    }
+
+    char cache_path[PATH_MAX];
+    bool use_cache = section->size > 0 &&
+                     elf_section_cache_path (elf, index, cache_path);
+    if (use_cache &&
+        (section->data = elf_section_cache_load (cache_path, section->size))) {
+        TRACE ("%s: section %s loaded from %s\n",
+               elf->path, section->name, cache_path);
+        section->storage = SECTION_CACHED;
+        goto done;
+    }
+
+    void *output = section->size ? malloc (section->size) : NULL;
+    if (!output || !elf_section_decompress (elf, index, output,
+                                            section->size)) {
+        TRACE ("%s: could not decompress section %s\n",
+               elf->path, section->name);
+        free (output);
+        section->data = NULL;
+        section->size = 0;
+        section->storage = SECTION_MAPPED;
+        goto done;
+    }
+
+    TRACE ("%s: section %s decompressed (%zu bytes)\n",
+           elf->path, section->name, section->size);
+    section->data = output;
+    section->storage = SECTION_HEAP;
+
+    if (use_cache)
+        elf_section_cache_store (cache_path, output, section->size);
+
+done:
+    if (size) *size = section->data ? section->size : 0;
+    return section->data;
+}
+
+
+#define NOTE_ALIGN(n) (((n) + 3) & ~((size_t) 3))
+
+const uint8_t*
+eol_elf_build_id (const EolElf *elf,
+                  size_t       *length)
+{
+    CHECK_NOT_NULL (elf);
+
+    for (uint32_t i = 1; i < elf->n_sections; i++) {
+        if (elf->shdr[i].sh_type != SHT_NOTE)
+            continue;
+
+        size_t size;
+        const uint8_t *p = elf_section_raw (elf, i, &size);
+        const uint8_t *end = p + size;
+
+        while (p && (size_t) (end - p) >= sizeof (ElfN(Nhdr))) {
+            const ElfN(Nhdr) *nhdr = (const ElfN(Nhdr)*) p;
+            const uint8_t *name = p + sizeof (ElfN(Nhdr));
+            const uint8_t *desc = name + NOTE_ALIGN (nhdr->n_namesz);
+            p = desc + NOTE_ALIGN (nhdr->n_descsz);
+            if (p > end || p < desc)
+                break;
+
+            if (nhdr->n_type == NT_GNU_BUILD_ID &&
+                nhdr->n_namesz == sizeof (ELF_NOTE_GNU) &&
+                memcmp (name, ELF_NOTE_GNU, sizeof (ELF_NOTE_GNU)) == 0 &&
+                nhdr->n_descsz > 0) {
+                if (length) *length = nhdr->n_descsz;
+                return desc;
+            }
+        }
+    }
+    return NULL;
+}
+
+#undef NOTE_ALIGN
+
+
+const char*
+eol_elf_debuglink (const EolElf *elf,
+                   uint32_t     *crc)
+{
+    CHECK_NOT_NULL (elf);
+
+    uint32_t index;
+    if (!eol_elf_find_section (elf, ".gnu_debuglink", &index))
+        return NULL;
+
+    size_t size;
+    const char *name = (const char*) elf_section_raw (elf, index, &size);
+    if (!name)
+        return NULL;
+
+    /* File name, padded to a 4-byte boundary, followed by the CRC32. */
+    const char *nul = memchr (name, '\0', size);
+    if (!nul || nul == name)
+        return NULL;
+
+    size_t crc_offset = ((nul - name) + 4) & ~((size_t) 3);
+    if (crc_offset + sizeof (uint32_t) > size)
+        return NULL;
+
+    if (crc) memcpy (crc, name + crc_offset, sizeof (uint32_t));
+    return name;
+}
+
+
+bool
+eol_elf_has_debug_info (const EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    uint32_t index;
+    return eol_elf_find_section (elf, ".debug_info", &index)
+        && eol_elf_section_size (elf, index) > 0;
+}
+
+
+/*
+ * CRC32 as used by ".gnu_debuglink" (same as the one in zlib).
+ */
+static uint32_t
+elf_crc32 (const uint8_t *data, size_t size)
+{
+    static uint32_t table[256];
+    static bool table_ready = false;
+
+    if (!table_ready) {
+        for (uint32_t i = 0; i < LENGTH_OF (table); i++) {
+            uint32_t c = i;
+            for (unsigned k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFF;
+    while (size--)
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+static EolElf*
+elf_try_debug_candidate (const EolElf *elf,
+                         const char   *path,
+                         bool          check_crc,
+                         uint32_t      crc)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_NOT_NULL (path);
+
+    char real_path[PATH_MAX];
+    if (!realpath (path, real_path) || string_equal (real_path, elf->path))
+        return NULL;
+
+    EolElf *debug = eol_elf_open (real_path);
+    if (!debug)
+        return NULL;
+
+    TRACE ("%s: trying %s\n", elf->path, real_path);
+
+    size_t id_length, debug_id_length;
+    const uint8_t *id = eol_elf_build_id (elf, &id_length);
+    const uint8_t *debug_id = eol_elf_build_id (debug, &debug_id_length);
+
+    bool valid;
+    if (id && debug_id) {
+        valid = id_length == debug_id_length &&
+                memcmp (id, debug_id, id_length) == 0;
+    } else {
+        valid = !check_crc || elf_crc32 (debug->data, debug->size) == crc;
+    }
+
+    if (!valid || !eol_elf_has_debug_info (debug)) {
+        TRACE ("%s: %s does not match\n", elf->path, real_path);
+        eol_elf_close (debug);
+        return NULL;
+    }
+    return debug;
+}
+
+
+static EolElf*
+elf_open_debug_build_id (const EolElf *elf,
+                         const char   *debug_dir)
+{
+    size_t length;
+    const uint8_t *id = eol_elf_build_id (elf, &length);
+    if (!id || length < 2)
+        return NULL;
+
+    char path[PATH_MAX];
+    int n = snprintf (path, PATH_MAX, "%s/.build-id/%02x/", debug_dir, id[0]);
+    for (size_t i = 1; i < length && n > 0 && n < PATH_MAX; i++)
+        n += snprintf (path + n, PATH_MAX - n, "%02x", id[i]);
+    if (n <= 0 || n >= PATH_MAX ||
+        snprintf (path + n, PATH_MAX - n, ".debug") >= PATH_MAX - n)
+        return NULL;
+
+    return elf_try_debug_candidate (elf, path, false, 0);
+}
+
+
+static EolElf*
+elf_open_debug_link (const EolElf *elf,
+                     const char   *debug_dir)
+{
+    uint32_t crc;
+    const char *link = eol_elf_debuglink (elf, &crc);
+    if (!link)
+        return NULL;
+
+    const char *slash = strrchr (elf->path, '/');
+    int dir_length = slash ? (int) (slash - elf->path) : 0;
+
+    char path[PATH_MAX];
+    EolElf *debug = NULL;
+
+    if (!debug_dir) {
+        /* Next to the object, and in the .debug/ subdirectory. */
+        if (snprintf (path, PATH_MAX, "%.*s/%s",
+                      dir_length, elf->path, link) < PATH_MAX)
+            debug = elf_try_debug_candidate (elf, path, true, crc);
+        if (!debug && snprintf (path, PATH_MAX, "%.*s/.debug/%s",
+                                dir_length, elf->path, link) < PATH_MAX)
+            debug = elf_try_debug_candidate (elf, path, true, crc);
+    } else if (snprintf (path, PATH_MAX, "%s%.*s/%s", debug_dir,
+                         dir_length, elf->path, link) < PATH_MAX) {
+        debug = elf_try_debug_candidate (elf, path, true, crc);
+    }
+    return debug;
+}
+
+
+EolElf*
+eol_elf_open_debug (const EolElf *elf)
+{
+    CHECK_NOT_NULL (elf);
+
+    const char *debug_dirs = getenv ("EOL_DEBUG_DIRS");
+    if (!debug_dirs || !*debug_dirs)
+        debug_dirs = EOL_DEBUG_DIRS_DEFAULT;
+
+    EolElf *debug = NULL;
+    char dir[PATH_MAX];
+
+    /* Build-id lookups are cheap and reliable, try them first. */
+    for (const char *p = debug_dirs; !debug && *p;) {
+        size_t length = strcspn (p, ":");
+        if (length > 0 && length < PATH_MAX) {
+            memcpy (dir, p, length);
+            dir[length] = '\0';
+            debug = elf_open_debug_build_id (elf, dir);
+        }
+        p += length;
+        if (*p == ':') p++;
+    }
+
+    if (!debug)
+        debug = elf_open_debug_link (elf, NULL);
+
+    for (const char *p = debug_dirs; !debug && *p;) {
+        size_t length = strcspn (p, ":");
+        if (length > 0 && length < PATH_MAX) {
+            memcpy (dir, p, length);
+            dir[length] = '\0';
+            debug = elf_open_debug_link (elf, dir);
+        }
+        p += length;
+        if (*p == ':') p++;
+    }
+
+    if (debug) {
+        TRACE ("%s: using separate debug info %s\n", elf->path, debug->path);
+    }
+    return debug;
+}
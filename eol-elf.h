@@ -0,0 +1,86 @@
+/*
+ * eol-elf.h
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#ifndef EOL_ELF_H
+#define EOL_ELF_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * Read-only, memory-mapped view of an ELF file. Only objects of the same
+ * class (32/64 bit) and byte order as the host are supported, which is
+ * fine because the goal is inspecting objects which can be dlopen()ed.
+ */
+typedef struct _EolElf EolElf;
+
+extern EolElf* eol_elf_open  (const char *path);
+extern void    eol_elf_close (EolElf *elf);
+
+extern const char* eol_elf_path (const EolElf *elf);
+extern int         eol_elf_fd   (const EolElf *elf);
+
+/*
+ * Legacy GNU compressed sections (".zdebug_*") are reported using their
+ * uncompressed ".debug_*" names. Sizes are always the uncompressed size.
+ */
+extern uint32_t    eol_elf_n_sections    (const EolElf *elf);
+extern const char* eol_elf_section_name  (const EolElf *elf,
+                                          uint32_t      index);
+extern size_t      eol_elf_section_size  (const EolElf *elf,
+                                          uint32_t      index);
+extern bool        eol_elf_find_section  (const EolElf *elf,
+                                          const char   *name,
+                                          uint32_t     *index);
+
+/*
+ * Returns a pointer to the contents of a section, or NULL if the section
+ * has no data in the file (e.g. SHT_NOBITS sections of stripped objects).
+ *
+ * Compressed sections (SHF_COMPRESSED with zlib or zstd, and ".zdebug_*")
+ * are decompressed the first time their data is requested, and kept in
+ * memory until the EolElf is closed. If the EOL_CACHE_DIR environment
+ * variable is set, decompressed contents are also saved there and reused
+ * by later calls (also from other processes) instead of decompressing.
+ */
+extern const void* eol_elf_section_data  (EolElf   *elf,
+                                          uint32_t  index,
+                                          size_t   *size);
+
+/*
+ * Contents of the NT_GNU_BUILD_ID note, and of the ".gnu_debuglink"
+ * section. Both return NULL when the information is not present.
+ */
+extern const uint8_t* eol_elf_build_id  (const EolElf *elf,
+                                         size_t       *length);
+extern const char*    eol_elf_debuglink (const EolElf *elf,
+                                         uint32_t     *crc);
+
+/*
+ * Checks whether the object contains the DWARF debugging information
+ * itself, that is, it has a non-empty ".debug_info" section.
+ */
+extern bool eol_elf_has_debug_info (const EolElf *elf);
+
+/*
+ * Locates the separate debug information file for a (stripped) object,
+ * using the same conventions as GDB:
+ *
+ *   1. <debugdir>/.build-id/xx/yyyyyyyy.debug, using the build-id note.
+ *   2. <dir>/<debuglink>, <dir>/.debug/<debuglink>, and
+ *      <debugdir>/<dir>/<debuglink>, using the ".gnu_debuglink" section.
+ *
+ * The list of debug directories is taken from the EOL_DEBUG_DIRS
+ * environment variable (colon-separated), and defaults to "/usr/lib/debug".
+ * Candidates are validated by comparing build-ids, or the CRC stored in
+ * the debuglink when the object has no build-id.
+ */
+extern EolElf* eol_elf_open_debug (const EolElf *elf);
+
+#endif /* !EOL_ELF_H */
@@ -219,7 +219,7 @@ eol_fcall_ffi_map_types (EolFunction *ef)
                                       ef->fcall_ffi_param_types);
     if (status != FFI_OK) {
         TRACE ("%s(): cannot map typeinfos to FFI types\n",
-               ef->name ? ef->name : "?");
+               SYMBOL_NAME (ef));
         /* TODO: Report instead of aborting. */
         abort ();
     }
@@ -237,7 +237,8 @@ function_call (lua_State *L)
                            lua_gettop (L) - 1,
                            ef->n_param);
     }
-    TRACE (BLUE "%s()" NORMAL ": FFI call address=%p\n", ef->name, ef->address);
+    TRACE (BLUE "%s()" NORMAL ": FFI call address=%p\n",
+           SYMBOL_NAME (ef), ef->address);
 
     if (!ef->fcall_ffi_return_type)
         eol_fcall_ffi_map_types (ef);
@@ -246,7 +247,7 @@ function_call (lua_State *L)
     void *params[ef->n_param];
 
     TRACE (FBLUE "%s()" NORMAL ": FFI scratch buffer size=%lu (requested=%lu)\n",
-           ef->name, sizeof (scratch), ef->fcall_ffi_scratch_size);
+           SYMBOL_NAME (ef), sizeof (scratch), ef->fcall_ffi_scratch_size);
 
     uintptr_t addr = (uintptr_t) scratch;
     if (ef->return_typeinfo) {
@@ -259,12 +260,12 @@ function_call (lua_State *L)
     for (uint32_t i = 0; i < ef->n_param; i++) {
         params[i] = (void*) addr;
         TRACE (FBLUE "%s()" NORMAL ": Parameter %" PRIu32 ", type %s\n",
-               ef->name, i, eol_typeinfo_name (ef->param_types[i]));
+               SYMBOL_NAME (ef), i, eol_typeinfo_name (ef->param_types[i]));
         cvalue_get (L, i + 2, ef->param_types[i], (void*) addr);
         addr += eol_typeinfo_sizeof (ef->param_types[i]);
     }
 
-    TRACE (FBLUE "%s()" NORMAL ": Invoking ... ", ef->name);
+    TRACE (FBLUE "%s()" NORMAL ": Invoking ... ", SYMBOL_NAME (ef));
     ffi_call (&ef->fcall_ffi_cif, ef->address, scratch, params);
     TRACE (">" BLUE "done\n" NORMAL);
 
@@ -0,0 +1,501 @@
+/*
+ * eol-kernels.c
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "eol-kernels.h"
+#include "eol-trace.h"
+#include "eol-util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#if defined(__x86_64__) || defined(__i386__)
+# define KERNEL_HAVE_AVX2 1
+#else
+# define KERNEL_HAVE_AVX2 0
+#endif
+
+/*
+ * The kernels are written once, using GCC vector extensions for floating
+ * point types, and plain loops (which the compiler vectorizes) for integer
+ * types. They are always inlined into the entry points for each instruction
+ * set, so they get compiled once for each of them.
+ */
+#define KERNEL_INLINE static inline __attribute__ ((always_inline))
+
+/* One AVX2 register, or two SSE registers. */
+#define VECTOR_SIZE 32
+
+typedef float   vfloat_t       __attribute__ ((vector_size (VECTOR_SIZE)));
+typedef int32_t vfloat_mask_t  __attribute__ ((vector_size (VECTOR_SIZE)));
+typedef double  vdouble_t      __attribute__ ((vector_size (VECTOR_SIZE)));
+typedef int64_t vdouble_mask_t __attribute__ ((vector_size (VECTOR_SIZE)));
+
+
+#define FLOAT_KERNELS(suffix, name, ctype)                                \
+    KERNEL_INLINE double                                                  \
+    sum_ ## name (const ctype *x, size_t n)                               \
+    {                                                                     \
+        enum { N = VECTOR_SIZE / sizeof (ctype) };                        \
+        v ## name ## _t acc = { 0 };                                      \
+        size_t i = 0;                                                     \
+        for (; i + N <= n; i += N) {                                      \
+            v ## name ## _t v;                                            \
+            memcpy (&v, &x[i], sizeof (v));                               \
+            acc += v;                                                     \
+        }                                                                 \
+        double result = 0.0;                                              \
+        for (size_t j = 0; j < N; j++)                                    \
+            result += acc[j];                                             \
+        for (; i < n; i++)                                                \
+            result += x[i];                                               \
+        return result;                                                    \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE double                                                  \
+    dot_ ## name (const ctype *x, const ctype *y, size_t n)               \
+    {                                                                     \
+        enum { N = VECTOR_SIZE / sizeof (ctype) };                        \
+        v ## name ## _t acc = { 0 };                                      \
+        size_t i = 0;                                                     \
+        for (; i + N <= n; i += N) {                                      \
+            v ## name ## _t vx, vy;                                       \
+            memcpy (&vx, &x[i], sizeof (vx));                             \
+            memcpy (&vy, &y[i], sizeof (vy));                             \
+            acc += vx * vy;                                               \
+        }                                                                 \
+        double result = 0.0;                                              \
+        for (size_t j = 0; j < N; j++)                                    \
+            result += acc[j];                                             \
+        for (; i < n; i++)                                                \
+            result += x[i] * y[i];                                        \
+        return result;                                                    \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE void                                                    \
+    axpy_ ## name (ctype a, const ctype *x, ctype *y, size_t n)           \
+    {                                                                     \
+        enum { N = VECTOR_SIZE / sizeof (ctype) };                        \
+        v ## name ## _t va;                                               \
+        for (size_t j = 0; j < N; j++)                                    \
+            va[j] = a;                                                    \
+        size_t i = 0;                                                     \
+        for (; i + N <= n; i += N) {                                      \
+            v ## name ## _t vx, vy;                                       \
+            memcpy (&vx, &x[i], sizeof (vx));                             \
+            memcpy (&vy, &y[i], sizeof (vy));                             \
+            vy += va * vx;                                                \
+            memcpy (&y[i], &vy, sizeof (vy));                             \
+        }                                                                 \
+        for (; i < n; i++)                                                \
+            y[i] += a * x[i];                                             \
+    }                                                                     \
+                                                                          \
+    FLOAT_MINMAX_KERNEL (name, ctype, min, <)                             \
+    FLOAT_MINMAX_KERNEL (name, ctype, max, >)
+
+/* Selects elements using the mask from a vector comparison. */
+#define FLOAT_MINMAX_KERNEL(name, ctype, opname, op)                      \
+    KERNEL_INLINE ctype                                                   \
+    opname ## _ ## name (const ctype *x, size_t n)                        \
+    {                                                                     \
+        enum { N = VECTOR_SIZE / sizeof (ctype) };                        \
+        ctype result = x[0];                                              \
+        size_t i = 0;                                                     \
+        if (n >= N) {                                                     \
+            v ## name ## _t m;                                            \
+            memcpy (&m, x, sizeof (m));                                   \
+            for (i = N; i + N <= n; i += N) {                             \
+                v ## name ## _t v;                                        \
+                memcpy (&v, &x[i], sizeof (v));                           \
+                v ## name ## _mask_t sel = v op m;                        \
+                m = (v ## name ## _t) (((v ## name ## _mask_t) v & sel) | \
+                                       ((v ## name ## _mask_t) m & ~sel));\
+            }                                                             \
+            result = m[0];                                                \
+            for (size_t j = 1; j < N; j++)                                \
+                if (m[j] op result) result = m[j];                        \
+        }                                                                 \
+        for (; i < n; i++)                                                \
+            if (x[i] op result) result = x[i];                            \
+        return result;                                                    \
+    }
+
+/*
+ * Sums and products wrap around using unsigned 64-bit arithmetic, which
+ * gives the same results for signed values in two's complement.
+ */
+#define INTEGER_KERNELS(suffix, name, ctype)                              \
+    KERNEL_INLINE uint64_t                                                \
+    sum_ ## name (const ctype *x, size_t n)                               \
+    {                                                                     \
+        uint64_t result = 0;                                              \
+        for (size_t i = 0; i < n; i++)                                    \
+            result += (uint64_t) x[i];                                    \
+        return result;                                                    \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE uint64_t                                                \
+    dot_ ## name (const ctype *x, const ctype *y, size_t n)               \
+    {                                                                     \
+        uint64_t result = 0;                                              \
+        for (size_t i = 0; i < n; i++)                                    \
+            result += (uint64_t) x[i] * (uint64_t) y[i];                  \
+        return result;                                                    \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE void                                                    \
+    axpy_ ## name (uint64_t a, const ctype *x, ctype *y, size_t n)        \
+    {                                                                     \
+        for (size_t i = 0; i < n; i++)                                    \
+            y[i] = (ctype) (a * (uint64_t) x[i] + (uint64_t) y[i]);       \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE ctype                                                   \
+    min_ ## name (const ctype *x, size_t n)                               \
+    {                                                                     \
+        ctype result = x[0];                                              \
+        for (size_t i = 1; i < n; i++)                                    \
+            result = (x[i] < result) ? x[i] : result;                     \
+        return result;                                                    \
+    }                                                                     \
+                                                                          \
+    KERNEL_INLINE ctype                                                   \
+    max_ ## name (const ctype *x, size_t n)                               \
+    {                                                                     \
+        ctype result = x[0];                                              \
+        for (size_t i = 1; i < n; i++)                                    \
+            result = (x[i] > result) ? x[i] : result;                     \
+        return result;                                                    \
+    }
+
+FLOAT_TYPES (FLOAT_KERNELS)
+INTEGER_TYPES (INTEGER_KERNELS)
+
+#undef INTEGER_KERNELS
+#undef FLOAT_MINMAX_KERNEL
+#undef FLOAT_KERNELS
+
+
+KERNEL_INLINE bool
+reduce_impl (EolType          type,
+             EolKernelReduce  op,
+             const void      *x,
+             size_t           n,
+             EolKernelValue  *result)
+{
+    switch (type) {
+#define REDUCE_FLOAT(suffix, name, ctype)                            \
+        case EOL_TYPE_ ## suffix:                                    \
+            result->is_float = true;                                 \
+            switch (op) {                                            \
+                case EOL_KERNEL_SUM: result->d = sum_ ## name (x, n); \
+                                     return true;                    \
+                case EOL_KERNEL_MIN: result->d = min_ ## name (x, n); \
+                                     return true;                    \
+                case EOL_KERNEL_MAX: result->d = max_ ## name (x, n); \
+                                     return true;                    \
+            }                                                        \
+            return false;
+#define REDUCE_INTEGER(suffix, name, ctype)                          \
+        case EOL_TYPE_ ## suffix:                                    \
+            result->is_float = false;                                \
+            switch (op) {                                            \
+                case EOL_KERNEL_SUM: result->i = sum_ ## name (x, n); \
+                                     return true;                    \
+                case EOL_KERNEL_MIN: result->i = min_ ## name (x, n); \
+                                     return true;                    \
+                case EOL_KERNEL_MAX: result->i = max_ ## name (x, n); \
+                                     return true;                    \
+            }                                                        \
+            return false;
+        FLOAT_TYPES (REDUCE_FLOAT)
+        INTEGER_TYPES (REDUCE_INTEGER)
+#undef REDUCE_INTEGER
+#undef REDUCE_FLOAT
+        default:
+            return false;
+    }
+}
+
+
+KERNEL_INLINE bool
+dot_impl (EolType         type,
+          const void     *x,
+          const void     *y,
+          size_t          n,
+          EolKernelValue *result)
+{
+    switch (type) {
+#define DOT_FLOAT(suffix, name, ctype)           \
+        case EOL_TYPE_ ## suffix:                \
+            result->is_float = true;             \
+            result->d = dot_ ## name (x, y, n);  \
+            return true;
+#define DOT_INTEGER(suffix, name, ctype)         \
+        case EOL_TYPE_ ## suffix:                \
+            result->is_float = false;            \
+            result->i = dot_ ## name (x, y, n);  \
+            return true;
+        FLOAT_TYPES (DOT_FLOAT)
+        INTEGER_TYPES (DOT_INTEGER)
+#undef DOT_INTEGER
+#undef DOT_FLOAT
+        default:
+            return false;
+    }
+}
+
+
+/*
+ * Casting a floating point value which is NaN, or out of the range of an
+ * integer type, is undefined behaviour. Conversions to integers saturate
+ * to the range of the type instead, and NaN is converted to zero.
+ */
+#define SATURATE_TYPES(F)                      \
+    F (S8,  int8_t,   INT8_MIN,  INT8_MAX  )   \
+    F (S16, int16_t,  INT16_MIN, INT16_MAX )   \
+    F (S32, int32_t,  INT32_MIN, INT32_MAX )   \
+    F (S64, int64_t,  INT64_MIN, INT64_MAX )   \
+    F (U8,  uint8_t,  0,         UINT8_MAX )   \
+    F (U16, uint16_t, 0,         UINT16_MAX)   \
+    F (U32, uint32_t, 0,         UINT32_MAX)   \
+    F (U64, uint64_t, 0,         UINT64_MAX)
+
+#define SATURATE(suffix, ctype, min, max)     \
+    KERNEL_INLINE ctype                       \
+    saturate_ ## suffix (double v)            \
+    {                                         \
+        if (v != v)                           \
+            return 0;                         \
+        if (v <= (double) min)                \
+            return min;                       \
+        if (v >= (double) max)                \
+            return max;                       \
+        return (ctype) v;                     \
+    }
+
+SATURATE_TYPES (SATURATE)
+
+#undef SATURATE
+#undef SATURATE_TYPES
+
+KERNEL_INLINE double saturate_DOUBLE (double v) { return v; }
+KERNEL_INLINE float  saturate_FLOAT  (double v) { return (float) v; }
+
+
+KERNEL_INLINE bool
+axpy_impl (EolType         type,
+           EolKernelValue  a,
+           const void     *x,
+           void           *y,
+           size_t          n)
+{
+    switch (type) {
+#define AXPY_FLOAT(suffix, name, ctype)                                  \
+        case EOL_TYPE_ ## suffix:                                        \
+            axpy_ ## name (a.is_float ? a.d : a.i, x, y, n);             \
+            return true;
+#define AXPY_INTEGER(suffix, name, ctype)                                \
+        case EOL_TYPE_ ## suffix:                                        \
+            axpy_ ## name (a.is_float ? (uint64_t) saturate_S64 (a.d)    \
+                                      : (uint64_t) a.i, x, y, n);        \
+            return true;
+        FLOAT_TYPES (AXPY_FLOAT)
+        INTEGER_TYPES (AXPY_INTEGER)
+#undef AXPY_INTEGER
+#undef AXPY_FLOAT
+        default:
+            return false;
+    }
+}
+
+
+/*
+ * The inner list cannot reuse INTEGER_TYPES and FLOAT_TYPES, because the
+ * preprocessor does not expand them again while expanding the outer list.
+ */
+#define CONVERT_TYPES(F)      \
+    F (S8,     int8_t  )      \
+    F (S16,    int16_t )      \
+    F (S32,    int32_t )      \
+    F (S64,    int64_t )      \
+    F (U8,     uint8_t )      \
+    F (U16,    uint16_t)      \
+    F (U32,    uint32_t)      \
+    F (U64,    uint64_t)      \
+    F (DOUBLE, double  )      \
+    F (FLOAT,  float   )
+
+KERNEL_INLINE bool
+convert_impl (EolType     dst_type,
+              void       *dst,
+              EolType     src_type,
+              const void *src,
+              size_t      n)
+{
+    switch (src_type) {
+#define CONVERT_TO(dsuffix, dctype)                           \
+                case EOL_TYPE_ ## dsuffix:                    \
+                    for (size_t i = 0; i < n; i++)            \
+                        ((dctype*) dst)[i] = (dctype) s[i];   \
+                    return true;
+#define CONVERT_SATURATE(dsuffix, dctype)                     \
+                case EOL_TYPE_ ## dsuffix:                    \
+                    for (size_t i = 0; i < n; i++)            \
+                        ((dctype*) dst)[i] =                  \
+                            saturate_ ## dsuffix (s[i]);      \
+                    return true;
+#define CONVERT_FROM(ssuffix, sctype, convert_to)             \
+        case EOL_TYPE_ ## ssuffix: {                          \
+            const sctype *s = src;                            \
+            switch (dst_type) {                               \
+                CONVERT_TYPES (convert_to)                    \
+                default:                                      \
+                    return false;                             \
+            }                                                 \
+        }
+#define CONVERT_FROM_INTEGER(ssuffix, sname, sctype)          \
+        CONVERT_FROM (ssuffix, sctype, CONVERT_TO)
+#define CONVERT_FROM_FLOAT(ssuffix, sname, sctype)            \
+        CONVERT_FROM (ssuffix, sctype, CONVERT_SATURATE)
+        INTEGER_TYPES (CONVERT_FROM_INTEGER)
+        FLOAT_TYPES (CONVERT_FROM_FLOAT)
+#undef CONVERT_FROM_FLOAT
+#undef CONVERT_FROM_INTEGER
+#undef CONVERT_FROM
+#undef CONVERT_SATURATE
+#undef CONVERT_TO
+        default:
+            return false;
+    }
+}
+
+#undef CONVERT_TYPES
+
+
+typedef struct {
+    const char *isa;
+    bool (*reduce)  (EolType, EolKernelReduce, const void*, size_t,
+                     EolKernelValue*);
+    bool (*dot)     (EolType, const void*, const void*, size_t,
+                     EolKernelValue*);
+    bool (*axpy)    (EolType, EolKernelValue, const void*, void*, size_t);
+    bool (*convert) (EolType, void*, EolType, const void*, size_t);
+} EolKernels;
+
+
+#define DEFINE_KERNELS(isa, attributes)                                    \
+    static bool attributes                                                 \
+    reduce_ ## isa (EolType type, EolKernelReduce op, const void *x,       \
+                    size_t n, EolKernelValue *result)                      \
+    { return reduce_impl (type, op, x, n, result); }                       \
+                                                                           \
+    static bool attributes                                                 \
+    dot_ ## isa (EolType type, const void *x, const void *y, size_t n,     \
+                 EolKernelValue *result)                                   \
+    { return dot_impl (type, x, y, n, result); }                           \
+                                                                           \
+    static bool attributes                                                 \
+    axpy_ ## isa (EolType type, EolKernelValue a, const void *x, void *y,  \
+                  size_t n)                                                \
+    { return axpy_impl (type, a, x, y, n); }                               \
+                                                                           \
+    static bool attributes                                                 \
+    convert_ ## isa (EolType dst_type, void *dst, EolType src_type,        \
+                     const void *src, size_t n)                            \
+    { return convert_impl (dst_type, dst, src_type, src, n); }             \
+                                                                           \
+    static const EolKernels kernels_ ## isa = {                            \
+        #isa, reduce_ ## isa, dot_ ## isa, axpy_ ## isa, convert_ ## isa,  \
+    };
+
+DEFINE_KERNELS (generic, )
+#if KERNEL_HAVE_AVX2
+DEFINE_KERNELS (avx2, __attribute__ ((target ("avx2"))))
+#endif
+
+#undef DEFINE_KERNELS
+
+
+/*
+ * The AVX2 kernels are used if the processor supports them, unless the
+ * EOL_KERNELS environment variable is set to "generic".
+ */
+static const EolKernels*
+kernels (void)
+{
+    static const EolKernels *selected = NULL;
+    if (!selected) {
+        const EolKernels *k = &kernels_generic;
+#if KERNEL_HAVE_AVX2
+        const char *env = getenv ("EOL_KERNELS");
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx2") &&
+            !(env && string_equal (env, "generic")))
+            k = &kernels_avx2;
+#endif
+        TRACE ("using %s kernels\n", k->isa);
+        selected = k;
+    }
+    return selected;
+}
+
+
+const char*
+eol_kernel_isa (void)
+{
+    return kernels ()->isa;
+}
+
+
+bool
+eol_kernel_reduce (EolType          type,
+                   EolKernelReduce  op,
+                   const void      *x,
+                   size_t           n_items,
+                   EolKernelValue  *result)
+{
+    CHECK_NOT_NULL (result);
+    if (op != EOL_KERNEL_SUM && n_items == 0)
+        return false;
+    return (*kernels ()->reduce) (type, op, x, n_items, result);
+}
+
+
+bool
+eol_kernel_dot (EolType          type,
+                const void      *x,
+                const void      *y,
+                size_t           n_items,
+                EolKernelValue  *result)
+{
+    CHECK_NOT_NULL (result);
+    return (*kernels ()->dot) (type, x, y, n_items, result);
+}
+
+
+bool
+eol_kernel_axpy (EolType          type,
+                 EolKernelValue   a,
+                 const void      *x,
+                 void            *y,
+                 size_t           n_items)
+{
+    return (*kernels ()->axpy) (type, a, x, y, n_items);
+}
+
+
+bool
+eol_kernel_convert (EolType          dst_type,
+                    void            *dst,
+                    EolType          src_type,
+                    const void      *src,
+                    size_t           n_items)
+{
+    return (*kernels ()->convert) (dst_type, dst, src_type, src, n_items);
+}
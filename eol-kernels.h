@@ -0,0 +1,72 @@
+/*
+ * eol-kernels.h
+ * Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#ifndef EOL_KERNELS_H
+#define EOL_KERNELS_H
+
+#include "eol-typing.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Numeric kernels over contiguous arrays of integer or floating point
+ * elements. Each has a generic implementation, plus one using AVX2 on x86
+ * processors that support it, which is selected at run time using CPUID.
+ * All functions return false when the element type is not supported.
+ */
+
+typedef enum {
+    EOL_KERNEL_SUM,
+    EOL_KERNEL_MIN,
+    EOL_KERNEL_MAX,
+} EolKernelReduce;
+
+typedef struct {
+    bool is_float;
+    union {
+        int64_t i;  /* Also used for unsigned values. */
+        double  d;
+    };
+} EolKernelValue;
+
+
+/* Name of the instruction set used: "avx2" or "generic". */
+extern const char* eol_kernel_isa (void);
+
+/* "n_items" must be greater than zero for EOL_KERNEL_{MIN,MAX}. */
+extern bool eol_kernel_reduce  (EolType          type,
+                                EolKernelReduce  op,
+                                const void      *x,
+                                size_t           n_items,
+                                EolKernelValue  *result);
+
+extern bool eol_kernel_dot     (EolType          type,
+                                const void      *x,
+                                const void      *y,
+                                size_t           n_items,
+                                EolKernelValue  *result);
+
+/* Computes y = a * x + y. Floating point "a" saturates for integers. */
+extern bool eol_kernel_axpy    (EolType          type,
+                                EolKernelValue   a,
+                                const void      *x,
+                                void            *y,
+                                size_t           n_items);
+
+/*
+ * Converts elements as C casts do, except that floating point values are
+ * saturated to the range of integer types, and NaN is converted to zero.
+ */
+extern bool eol_kernel_convert (EolType          dst_type,
+                                void            *dst,
+                                EolType          src_type,
+                                const void      *src,
+                                size_t           n_items);
+
+#endif /* !EOL_KERNELS_H */
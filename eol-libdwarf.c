@@ -26,6 +26,119 @@ DW_DEALLOC_TYPES (DW_DEFINE_DEALLOC_FUNC)
 #undef DW_DEFINE_DEALLOC_FUNC
 
 
+static int
+dw_elf_get_section_info (void                     *object,
+                         Dwarf_Half                index,
+                         Dwarf_Obj_Access_Section *section,
+                         int                      *error)
+{
+    EolElf *elf = object;
+    if (index >= eol_elf_n_sections (elf)) {
+        *error = DW_DLE_MDE;
+        return DW_DLV_ERROR;
+    }
+
+    /*
+     * Shared objects do not need relocations applied to their debugging
+     * information, so only the name and (uncompressed) size are needed.
+     */
+    memset (section, 0x00, sizeof (Dwarf_Obj_Access_Section));
+    section->name = eol_elf_section_name (elf, index);
+    section->size = eol_elf_section_size (elf, index);
+    if (!section->name) section->name = "";
+    return DW_DLV_OK;
+}
+
+
+static Dwarf_Endianness
+dw_elf_get_byte_order (void *object)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return DW_OBJECT_LSB;
+#else
+    return DW_OBJECT_MSB;
+#endif
+}
+
+
+static Dwarf_Small
+dw_elf_get_pointer_size (void *object)
+{
+    return sizeof (void*);
+}
+
+
+static Dwarf_Unsigned
+dw_elf_get_section_count (void *object)
+{
+    return eol_elf_n_sections (object);
+}
+
+
+static int
+dw_elf_load_section (void         *object,
+                     Dwarf_Half    index,
+                     Dwarf_Small **data,
+                     int          *error)
+{
+    EolElf *elf = object;
+    if (index >= eol_elf_n_sections (elf) ||
+        !(*data = (Dwarf_Small*) eol_elf_section_data (elf, index, NULL))) {
+        *error = DW_DLE_MDE;
+        return DW_DLV_ERROR;
+    }
+    return DW_DLV_OK;
+}
+
+
+static const Dwarf_Obj_Access_Methods dw_elf_methods = {
+    .get_section_info   = dw_elf_get_section_info,
+    .get_byte_order     = dw_elf_get_byte_order,
+    .get_length_size    = dw_elf_get_pointer_size,
+    .get_pointer_size   = dw_elf_get_pointer_size,
+    .get_section_count  = dw_elf_get_section_count,
+    .load_section       = dw_elf_load_section,
+    .relocate_a_section = NULL,
+};
+
+
+int
+dw_elf_init (EolElf                      *elf,
+             Dwarf_Obj_Access_Interface **access,
+             Dwarf_Debug                 *dbg,
+             Dwarf_Error                 *e)
+{
+    CHECK_NOT_NULL (elf);
+    CHECK_NOT_NULL (access);
+    CHECK_NOT_NULL (dbg);
+
+    Dwarf_Obj_Access_Interface *iface =
+        calloc (1, sizeof (Dwarf_Obj_Access_Interface));
+    iface->object = elf;
+    iface->methods = &dw_elf_methods;
+
+    int status = dwarf_object_init (iface, NULL, NULL, dbg, e);
+    if (status == DW_DLV_OK) {
+        *access = iface;
+    } else {
+        free (iface);
+        *access = NULL;
+    }
+    return status;
+}
+
+
+int
+dw_elf_finish (Dwarf_Debug                 dbg,
+               Dwarf_Obj_Access_Interface *access,
+               Dwarf_Error                *e)
+{
+    int status = dwarf_object_finish (dbg, e);
+    free (access);
+    return status;
+}
+
+
 char*
 dw_die_repr (Dwarf_Debug dbg, Dwarf_Die die)
 {
@@ -130,9 +243,17 @@ dw_tue_array_get_n_items (Dwarf_Debug     dbg,
         if (dwarf_tag (child.die, &tag, e) != DW_DLV_OK)
             break;
 
-        if ((result = (tag == DW_TAG_subrange_type) &&
-             dw_die_get_uint_attrb (child, DW_AT_count, out, e)))
-            break;
+        if (tag == DW_TAG_subrange_type) {
+            if ((result = dw_die_get_uint_attrb (child, DW_AT_count,
+                                                 out, e)))
+                break;
+            /* GCC uses the (inclusive) upper bound instead of the count. */
+            if ((result = dw_die_get_uint_attrb (child, DW_AT_upper_bound,
+                                                 out, e))) {
+                ++*out;
+                break;
+            }
+        }
 
         dw_ldie_t prev = child;
         if (dwarf_siblingof (dbg, prev.die, &child.die, e) != DW_DLV_OK)
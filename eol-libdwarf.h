@@ -28,6 +28,23 @@
 #endif /* EOL_LIBDWARF_BUNDLED */
 
 #include "eol-util.h"
+#include "eol-elf.h"
+
+
+/*
+ * Initializes libdwarf using the object access interface, reading sections
+ * from an EolElf instead of letting libdwarf use libelf on a file
+ * descriptor. Sections are only read (and decompressed, if needed) when
+ * libdwarf loads them. The EolElf must outlive the returned Dwarf_Debug,
+ * which must be released with dw_elf_finish().
+ */
+extern int dw_elf_init (EolElf                      *elf,
+                        Dwarf_Obj_Access_Interface **access,
+                        Dwarf_Debug                 *dbg,
+                        Dwarf_Error                 *e);
+extern int dw_elf_finish (Dwarf_Debug                 dbg,
+                          Dwarf_Obj_Access_Interface *access,
+                          Dwarf_Error                *e);
 
 
 #define DW_TYPE_TAG_NAMES(F) \
@@ -6,16 +6,22 @@
  */
 
 #include "eol-libdwarf.h"
+#include "eol-dwarf.h"
+#include "eol-btf.h"
+#include "eol-elf.h"
 #include "eol-lua.h"
 #include "eol-typing.h"
 #include "eol-typecache.h"
+#include "eol-kernels.h"
 #include "eol-trace.h"
 #include "eol-util.h"
+#include "uthash.h"
 
 #include <libelf.h>
 #include <dlfcn.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -46,20 +52,35 @@ typedef enum {
 #include "specials.inc"
 
 
-typedef struct _EolLibrary  EolLibrary;
+typedef struct _EolLibrary   EolLibrary;
+typedef struct _EolSplitUnit EolSplitUnit;
+typedef struct _EolName      EolName;
 
 /*
  * Data needed for each library loaded by "eol.load()".
+ *
+ * Libraries built with split DWARF ("-gsplit-dwarf") contain only skeleton
+ * compilation units, and the rest of the debugging information is in one
+ * ".dwo" file per unit, or in a ".dwp" package. Those are opened on demand
+ * and each one gets a child EolLibrary (with "parent" set) which is owned
+ * by the library, and chained in its "split_files" list.
+ *
+ * Libraries which have BTF type information (a ".BTF" section) use it
+ * instead of DWARF. In that case "btf" is set, libdwarf is not used at all
+ * ("d_debug" is NULL), and the type cache is keyed by BTF type id.
  */
 struct _EolLibrary {
     REF_COUNTER;
 
     char         *path;
 
-    int           fd;
+    EolElf       *elf;
+    EolDwarf     *dwarf;
+    EolBtf       *btf;
     void         *dl;
 
     Dwarf_Debug   d_debug;
+    Dwarf_Obj_Access_Interface *d_access;
     Dwarf_Global *d_globals;
     Dwarf_Signed  d_num_globals;
     Dwarf_Type   *d_types;
@@ -71,9 +92,39 @@ struct _EolLibrary {
     uint64_t      type_cache_hits;
 #endif /* EOL_TYPECACHE_STATS */
 
+    EolLibrary   *parent;
+    EolSplitUnit *split_units;
+    size_t        n_split_units;
+    bool          split_scanned;
+    EolLibrary   *split_files;
+
+    EolName      *names;
+
     EolLibrary   *next;
 };
 
+struct _EolSplitUnit {
+    Dwarf_Off   skeleton_offset; /* Offset of the skeleton unit.      */
+    uint64_t    dwo_id;
+    char       *dwo_name;
+    char       *comp_dir;
+    EolLibrary *file;            /* Split file, once opened.          */
+    Dwarf_Off   cu_offset;       /* Offset of the unit in the file.   */
+    Dwarf_Off   cu_die_offset;
+};
+
+
+/*
+ * Names of the symbols of a library, interned so that each function or
+ * variable wrapper only needs a pointer to its name, instead of a copy.
+ * The name also links back to the library it belongs to.
+ */
+struct _EolName {
+    EolLibrary    *library;
+    UT_hash_handle hh;
+    char           name[];
+};
+
 
 static EolLibrary *library_list = NULL;
 
@@ -101,16 +152,46 @@ to_eol_library (lua_State *L, int index)
 }
 
 
+/* Stores a new table with weak values in the registry, under "key". */
+static void
+registry_set_weak_table (lua_State *L, const void *key)
+{
+    lua_createtable (L, 0, 0);
+    lua_createtable (L, 0, 1);
+    lua_pushliteral (L, "v");
+    lua_setfield (L, -2, "__mode");
+    lua_setmetatable (L, -2);
+    lua_rawsetp (L, LUA_REGISTRYINDEX, key);
+}
+
+
 static const char EOL_TYPEINFO[] = "org.perezdecastro.eol.TypeInfo";
 
+/*
+ * There is at most one userdata for each EolTypeInfo, interned in a weak
+ * table of the registry. This way type objects are reused, and the same
+ * type always compares equal by identity without calling typeinfo_eq().
+ */
+static const char EOL_TYPEINFO_CACHE[] = "org.perezdecastro.eol.TypeInfoCache";
+
 static inline void
 typeinfo_push_userdata (lua_State *L, const EolTypeInfo *ti)
 {
     CHECK_NOT_NULL (ti);
 
+    lua_rawgetp (L, LUA_REGISTRYINDEX, EOL_TYPEINFO_CACHE);   /* cache */
+    if (lua_rawgetp (L, -1, ti) == LUA_TUSERDATA) {          /* cache ud */
+        lua_remove (L, -2);                                  /* ud */
+        return;
+    }
+    lua_pop (L, 1);                                          /* cache */
+
     const EolTypeInfo **tip = lua_newuserdata (L, sizeof (const EolTypeInfo*));
     *tip = ti;
-    luaL_setmetatable (L, EOL_TYPEINFO);
+    luaL_setmetatable (L, EOL_TYPEINFO);                     /* cache ud */
+    lua_pushvalue (L, -1);                                   /* cache ud ud */
+    lua_rawsetp (L, -3, ti);                                 /* cache ud */
+    lua_remove (L, -2);                                      /* ud */
 }
 
 static inline const EolTypeInfo*
@@ -258,13 +339,9 @@ typeinfo_type_string (const EolTypeInfo *typeinfo)
 static int
 typeinfo_pointerto (lua_State *L)
 {
-    /*
-     * FIXME: This leaks the newly created EolTypeInfo. It should be added to
-     *        the type cache, or (even better) look up an existing item from
-     *        it before adding it.
-     */
     const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 1);
-    typeinfo_push_userdata (L, eol_typeinfo_new_pointer (typeinfo));
+    typeinfo_push_userdata (L, eol_type_cache_derived (EOL_TYPE_POINTER,
+                                                       typeinfo, 0));
     return 1;
 }
 
@@ -272,17 +349,13 @@ typeinfo_pointerto (lua_State *L)
 static int
 typeinfo_arrayof (lua_State *L)
 {
-    /*
-     * FIXME: This leaks the newly created EolTypeInfo. It should be added to
-     *        the type cache, or (even better) look up an existing item from
-     *        it before adding it.
-     */
     const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 1);
     lua_Integer n_items = luaL_checkinteger (L, 2);
     if (n_items <= 0) {
         return luaL_error (L, "parameter #2 must be a positive integer");
     }
-    typeinfo_push_userdata (L, eol_typeinfo_new_array (typeinfo, n_items));
+    typeinfo_push_userdata (L, eol_type_cache_derived (EOL_TYPE_ARRAY,
+                                                       typeinfo, n_items));
     return 1;
 }
 
@@ -398,8 +471,9 @@ static const luaL_Reg typeinfo_methods[] = {
 
 
 static Dwarf_Off
-library_get_tue_offset (EolLibrary *library,
+library_get_tue_offset (EolLibrary  *library,
                         const char  *name,
+                        EolLibrary **owner,
                         Dwarf_Error *d_error);
 static Dwarf_Die
 library_fetch_die (EolLibrary  *library,
@@ -424,18 +498,39 @@ library_build_typeinfo (EolLibrary  *library,
 
 static Dwarf_Die lookup_die (EolLibrary  *library,
                              const char  *name,
+                             EolLibrary **owner,
                              Dwarf_Error *d_error);
 
+static Dwarf_Off library_split_lookup (EolLibrary  *library,
+                                       const char  *name,
+                                       bool         want_type,
+                                       EolLibrary **owner,
+                                       Dwarf_Error *d_error);
+
+static const EolTypeInfo*
+library_btf_lookup_type (EolLibrary *library,
+                         uint32_t    id);
+
+static bool
+library_btf_find_type (EolLibrary         *library,
+                       const char         *name,
+                       const EolTypeInfo **typeinfo);
+
 
 /*
  * FIXME: This makes EolVariable/EolFunction keep a reference to their
  *        corresponding EolLibrary, which itself might be GCd while there
  *        are still live references to it!
+ *
+ * Anonymous values (e.g. the result of dereferencing a pointer) do not
+ * have an "origin", and do not keep a reference to any library.
  */
 #define EOL_COMMON_FIELDS \
-    EolLibrary *library;  \
-    void       *address;  \
-    char       *name
+    void          *address; \
+    const EolName *origin
+
+#define SYMBOL_NAME(s)    ((s)->origin ? (s)->origin->name : NULL)
+#define SYMBOL_LIBRARY(s) ((s)->origin ? (s)->origin->library : NULL)
 
 
 /*
@@ -457,17 +552,24 @@ struct _EolFunction {
 
 typedef struct {
     EOL_COMMON_FIELDS;
-    union {
-        EolTypeInfo       *typeinfo;
-        const EolTypeInfo *typeinfo_const;
-    };
-    bool                    typeinfo_owned;
+    const EolTypeInfo *typeinfo;
 } EolVariable;
 
 
 static const char EOL_FUNCTION[] = "org.perezdecastro.eol.Function";
 static const char EOL_VARIABLE[] = "org.perezdecastro.eol.Variable";
 
+/*
+ * Variables use a different metatable depending on the kind of their type,
+ * so their __index and __newindex handlers do not need to check the type
+ * on each access. All of them contain the EOL_VARIABLE key (as a light
+ * userdata) to identify them as variable metatables.
+ */
+static const char EOL_VARIABLE_SCALAR[] = "org.perezdecastro.eol.Variable.Scalar";
+static const char EOL_VARIABLE_ARRAY[]  = "org.perezdecastro.eol.Variable.Array";
+static const char EOL_VARIABLE_STRUCT[] = "org.perezdecastro.eol.Variable.Struct";
+static const char EOL_VARIABLE_UNION[]  = "org.perezdecastro.eol.Variable.Union";
+
 
 static inline EolFunction*
 to_eol_function (lua_State *L)
@@ -475,10 +577,49 @@ to_eol_function (lua_State *L)
     return (EolFunction*) luaL_checkudata (L, 1, EOL_FUNCTION);
 }
 
+static inline EolVariable*
+test_eol_variable (lua_State *L, int index)
+{
+    void *p = lua_touserdata (L, index);
+    if (p && lua_getmetatable (L, index)) {
+        const bool is_variable =
+                lua_rawgetp (L, -1, EOL_VARIABLE) != LUA_TNIL;
+        lua_pop (L, 2);
+        if (is_variable)
+            return (EolVariable*) p;
+    }
+    return NULL;
+}
+
 static inline EolVariable*
 to_eol_variable (lua_State *L, int index)
 {
-    return (EolVariable*) luaL_checkudata (L, index, EOL_VARIABLE);
+    EolVariable *ev = test_eol_variable (L, index);
+    if (!ev) {
+        luaL_argerror (L, index,
+                       lua_pushfstring (L, "%s expected, got %s",
+                                        EOL_VARIABLE,
+                                        luaL_typename (L, index)));
+    }
+    return ev;
+}
+
+static inline void
+variable_set_metatable (lua_State *L, const EolTypeInfo *typeinfo)
+{
+    switch (eol_typeinfo_type (eol_typeinfo_get_non_synthetic (typeinfo))) {
+        case EOL_TYPE_ARRAY:
+            luaL_setmetatable (L, EOL_VARIABLE_ARRAY);
+            break;
+        case EOL_TYPE_STRUCT:
+            luaL_setmetatable (L, EOL_VARIABLE_STRUCT);
+            break;
+        case EOL_TYPE_UNION:
+            luaL_setmetatable (L, EOL_VARIABLE_UNION);
+            break;
+        default:
+            luaL_setmetatable (L, EOL_VARIABLE_SCALAR);
+    }
 }
 
 
@@ -524,19 +665,46 @@ void library_free (EolLibrary *el)
     if (el->d_types)
         dwarf_pubtypes_dealloc (el->d_debug, el->d_types, el->d_num_types);
 
-    Dwarf_Error d_error = DW_DLE_NE;
-    dwarf_finish (el->d_debug, &d_error);
+    if (el->d_debug) {
+        Dwarf_Error d_error = DW_DLE_NE;
+        dw_elf_finish (el->d_debug, el->d_access, &d_error);
+    }
 
-    free (el->path);
-    close (el->fd);
-    dlclose (el->dl);
+    while (el->split_files) {
+        EolLibrary *file = el->split_files;
+        el->split_files = file->next;
+        library_unref (file);
+    }
+    for (size_t i = 0; i < el->n_split_units; i++) {
+        free (el->split_units[i].dwo_name);
+        free (el->split_units[i].comp_dir);
+    }
+    free (el->split_units);
 
-    if (library_list == el) {
-        library_list = library_list->next;
-    } else {
-        EolLibrary *prev = library_list;
-        while (prev->next && prev->next != el) prev = prev->next;
-        prev->next = prev->next->next;
+    EolName *name, *tmp;
+    HASH_ITER (hh, el->names, name, tmp) {
+        HASH_DEL (el->names, name);
+        free (name);
+    }
+
+    free (el->path);
+    if (el->dwarf)
+        eol_dwarf_free (el->dwarf);
+    if (el->btf)
+        eol_btf_free (el->btf);
+    eol_elf_close (el->elf);
+
+    /* Split DWARF files share the handle of their parent library. */
+    if (!el->parent) {
+        dlclose (el->dl);
+
+        if (library_list == el) {
+            library_list = library_list->next;
+        } else {
+            EolLibrary *prev = library_list;
+            while (prev->next && prev->next != el) prev = prev->next;
+            prev->next = prev->next->next;
+        }
     }
 
     free (el);
@@ -558,6 +726,8 @@ library_tostring (lua_State *L)
     EolLibrary *el = to_eol_library (L, 1);
     if (el->d_debug) {
         lua_pushfstring (L, "eol.library (%p)", el->d_debug);
+    } else if (el->btf) {
+        lua_pushfstring (L, "eol.library (%p)", el->btf);
     } else {
         lua_pushliteral (L, "eol.library (closed)");
     }
@@ -565,6 +735,30 @@ library_tostring (lua_State *L)
 }
 
 
+static const EolName*
+library_intern_name (EolLibrary *library,
+                     const char *name)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (name);
+
+    EolName *item = NULL;
+    HASH_FIND_STR (library->names, name, item);
+    if (!item) {
+        const size_t length = strlen (name);
+        item = malloc (sizeof (EolName) + length + 1);
+        memcpy (item->name, name, length + 1);
+        item->library = library;
+        HASH_ADD_KEYPTR (hh, library->names, item->name, length, item);
+    }
+    return item;
+}
+
+
+/*
+ * Symbols without a name are anonymous, and do not reference the library
+ * even if one is passed.
+ */
 static inline void
 symbol_init (EolSymbol  *symbol,
              EolLibrary *library,
@@ -573,10 +767,12 @@ symbol_init (EolSymbol  *symbol,
 {
     CHECK_NOT_NULL (address);
     memset (symbol, 0x00, sizeof (EolSymbol));
-    if (library)
-        symbol->library = library_ref (library);
-    if (name)
-        symbol->name = strdup (name);
+    /* Symbols from split DWARF files belong to the parent library. */
+    if (library && name) {
+        if (library->parent)
+            library = library->parent;
+        symbol->origin = library_intern_name (library_ref (library), name);
+    }
     symbol->address = address;
 }
 
@@ -584,13 +780,27 @@ symbol_init (EolSymbol  *symbol,
 static inline void
 symbol_free (EolSymbol *symbol)
 {
-    if (symbol->library)
-        library_unref (symbol->library);
-    free (symbol->name);
+    if (symbol->origin)
+        library_unref (symbol->origin->library);
     memset (symbol, 0xCA, sizeof (EolSymbol));
 }
 
 
+/* Creates a variable with zero-filled storage for a value of a type. */
+static EolVariable*
+variable_push_new (lua_State *L, const EolTypeInfo *typeinfo)
+{
+    size_t payload = eol_typeinfo_sizeof (typeinfo);
+    EolVariable *ev = lua_newuserdata (L, sizeof (EolVariable) + payload);
+    symbol_init ((EolSymbol*) ev, NULL, &ev[1], NULL);
+    ev->typeinfo = typeinfo;
+    memset (ev->address, 0x00, payload);
+    variable_set_metatable (L, typeinfo);
+    TRACE_PTR (>, EolVariable, ev, " (<lua>)\n");
+    return ev;
+}
+
+
 static int
 typeinfo_call (lua_State *L)
 {
@@ -600,20 +810,10 @@ typeinfo_call (lua_State *L)
     if (n_items < 1)
         return luaL_error (L, "argument #2 must be > 0");
 
-    bool typeinfo_owned = false;
-    if (lua_gettop (L) > 1) {
-        typeinfo = eol_typeinfo_new_array (typeinfo, n_items);
-        typeinfo_owned = true;
-    }
+    if (lua_gettop (L) > 1)
+        typeinfo = eol_type_cache_derived (EOL_TYPE_ARRAY, typeinfo, n_items);
 
-    size_t payload = eol_typeinfo_sizeof (typeinfo);
-    EolVariable *ev = lua_newuserdata (L, sizeof (EolVariable) + payload);
-    symbol_init ((EolSymbol*) ev, NULL, &ev[1], NULL);
-    ev->typeinfo_owned = typeinfo_owned;
-    ev->typeinfo_const = typeinfo;
-    memset (ev->address, 0x00, payload);
-    luaL_setmetatable (L, EOL_VARIABLE);
-    TRACE_PTR (>, EolVariable, ev, " (<lua>)\n");
+    variable_push_new (L, typeinfo);
     return 1;
 }
 
@@ -642,6 +842,29 @@ library_get_die_ref_attribute_offset (EolLibrary *library,
 }
 
 
+/*
+ * Creates an EolFunction with space for "n_param" parameter types, which
+ * have to be filled-in by the caller.
+ */
+static EolFunction*
+function_push_userdata (lua_State         *L,
+                        EolLibrary        *library,
+                        const EolTypeInfo *return_typeinfo,
+                        void              *address,
+                        const char        *name,
+                        uint32_t           n_param)
+{
+    const size_t payload = sizeof (EolTypeInfo*) * n_param;
+    EolFunction *ef = lua_newuserdata (L, sizeof (EolFunction) + payload);
+    memset (ef, 0x00, sizeof (EolFunction) + payload);
+    symbol_init ((EolSymbol*) ef, library, address, name);
+    ef->return_typeinfo = return_typeinfo;
+    ef->n_param         = n_param;
+    luaL_setmetatable (L, EOL_FUNCTION);
+    return ef;
+}
+
+
 /*
  * A function like this:
  *
@@ -676,14 +899,8 @@ function_parameters (lua_State         *L,
 
     if (!d_param_die) {
         /* No more entries. Create a EolFunction and fill-in the paramtype. */
-        const size_t payload = sizeof (EolTypeInfo*) * index;
-        EolFunction *ef = lua_newuserdata (L, sizeof (EolFunction) + payload);
-        memset (ef, 0x00, sizeof (EolFunction) + payload);
-        symbol_init ((EolSymbol*) ef, library, func_address, func_name);
-        ef->return_typeinfo = return_typeinfo;
-        ef->n_param         = index;
-        luaL_setmetatable (L, EOL_FUNCTION);
-        return ef;
+        return function_push_userdata (L, library, return_typeinfo,
+                                       func_address, func_name, index);
     }
 
     Dwarf_Half d_tag;
@@ -835,9 +1052,8 @@ variable_push_userdata (lua_State         *L,
         ev = lua_newuserdata (L, sizeof (EolVariable));
         symbol_init ((EolSymbol*) ev, library, address, name);
     }
-    ev->typeinfo_const = typeinfo;
-    ev->typeinfo_owned = false;
-    luaL_setmetatable (L, EOL_VARIABLE);
+    ev->typeinfo = typeinfo;
+    variable_set_metatable (L, typeinfo);
 
     TRACE_PTR (+, EolVariable, ev, " type " GREEN "%p" NORMAL "(%s)\n",
                typeinfo, name ? name : "?");
@@ -872,6 +1088,87 @@ make_variable_wrapper (lua_State  *L,
 }
 
 
+/*
+ * Equivalent of make_function_wrapper() and make_variable_wrapper() for
+ * libraries which use BTF type information.
+ */
+static int
+library_btf_index (lua_State  *L,
+                   EolLibrary *library,
+                   void       *address,
+                   const char *name)
+{
+    CHECK_NOT_NULL (library->btf);
+
+    uint32_t id;
+    EolBtfType type;
+    if (!eol_btf_find (library->btf, name, EOL_BTF_LOOKUP_SYMBOL, &id) ||
+        !eol_btf_type (library->btf, id, &type)) {
+        return luaL_error (L, "could not look up BTF type information "
+                           "for symbol '%s' (library %p)", name, library);
+    }
+
+    if (type.kind == EOL_BTF_KIND_VAR) {
+        const EolTypeInfo *typeinfo = library_btf_lookup_type (library,
+                                                               type.type);
+        if (!typeinfo) {
+            return luaL_error (L, "%s: could not obtain type information",
+                               name);
+        }
+        variable_push_userdata (L, library, typeinfo,
+                                address, name,
+                                VARIABLE_PUSH_NOCOPY);
+        return 1;
+    }
+
+    /* Functions reference a prototype with the return and parameter types. */
+    EolBtfType proto;
+    if (!eol_btf_type (library->btf, type.type, &proto) ||
+        proto.kind != EOL_BTF_KIND_FUNC_PROTO) {
+        return luaL_error (L, "%s: could not obtain function prototype", name);
+    }
+
+    const EolTypeInfo *return_typeinfo = library_btf_lookup_type (library,
+                                                                  proto.type);
+    if (!return_typeinfo) {
+        return luaL_error (L, "%s: cannot get return type information", name);
+    }
+
+    /*
+     * Build the parameter types first, so errors are raised before creating
+     * the userdata. The last parameter is "void" for variadic functions,
+     * which is ignored, like DW_TAG_unspecified_parameters.
+     */
+    uint32_t n_param = proto.vlen;
+    for (uint32_t i = 0; i < proto.vlen; i++) {
+        EolBtfMember param;
+        if (!eol_btf_member (library->btf, type.type, i, &param)) {
+            return luaL_error (L, "%s: cannot get parameter %d",
+                               name, (int) i + 1);
+        }
+        if (param.type == 0 && i == proto.vlen - 1) {
+            n_param--;
+        } else if (!library_btf_lookup_type (library, param.type)) {
+            return luaL_error (L, "%s: cannot get type of parameter %d",
+                               name, (int) i + 1);
+        }
+    }
+
+    EolFunction *ef = function_push_userdata (L, library, return_typeinfo,
+                                              address, name, n_param);
+    for (uint32_t i = 0; i < n_param; i++) {
+        EolBtfMember param;
+        eol_btf_member (library->btf, type.type, i, &param);
+        ef->param_types[i] = library_btf_lookup_type (library, param.type);
+    }
+    EOL_FUNCTION_FCALL_INIT (ef);
+
+    TRACE (BGREEN "%s() " NORMAL, name);
+    TRACE_PTR (->, EolFunction, ef, "\n");
+    return 1;
+}
+
+
 static int
 library_index (lua_State *L)
 {
@@ -886,8 +1183,12 @@ library_index (lua_State *L)
         goto return_error;
     }
 
+    if (e->btf)
+        return library_btf_index (L, e, address, name);
+
     Dwarf_Error d_error = DW_DLE_NE;
-    Dwarf_Die d_die = lookup_die (e, name, &d_error);
+    EolLibrary *owner;
+    Dwarf_Die d_die = lookup_die (e, name, &owner, &d_error);
     if (!d_die) {
         return luaL_error (L, "could not look up DWARF debug information "
                            "for symbol '%s' (library %p; %s)",
@@ -916,7 +1217,7 @@ library_index (lua_State *L)
                             &d_error) == DW_DLV_OK) {
             symbol_is_private = !d_flag_external;
         }
-        dwarf_dealloc (e->d_debug, d_attr, DW_DLA_ATTR);
+        dwarf_dealloc (owner->d_debug, d_attr, DW_DLA_ATTR);
     }
     CHECK (!symbol_is_private);
 #endif /* EOL_RUNTIME_CHECKS */
@@ -926,7 +1227,7 @@ library_index (lua_State *L)
     if (dwarf_tag (d_die,
                    &d_tag,
                    &d_error) != DW_DLV_OK) {
-        dwarf_dealloc (e->d_debug, d_die, DW_DLA_DIE);
+        dwarf_dealloc (owner->d_debug, d_die, DW_DLA_DIE);
         return luaL_error (L, "could not obtain DWARF debug information tag "
                            "for symbol '%s' (library %p)", name, e);
     }
@@ -943,21 +1244,21 @@ library_index (lua_State *L)
             TRACE ("@type-cache hits=%" PRIu64 " misses=%" PRIu64 "\n",
                    e->type_cache_hits, e->type_cache_misses);
 #endif /* EOL_TYPECACHE_STATS */
-            return make_function_wrapper (L, e, address, name, d_die, d_tag);
+            return make_function_wrapper (L, owner, address, name, d_die, d_tag);
 
         case DW_TAG_variable:
 #if EOL_TYPECACHE_STATS
             TRACE ("@type-cache hits=%" PRIu64 " misses=%" PRIu64 "\n",
                    e->type_cache_hits, e->type_cache_misses);
 #endif /* EOL_TYPECACHE_STATS */
-            return make_variable_wrapper (L, e, address, name, d_die, d_tag);
+            return make_variable_wrapper (L, owner, address, name, d_die, d_tag);
 
         default:
             error = "unsupported debug info kind (not function or data)";
             /* fall-through */
     }
 
-    dwarf_dealloc (e->d_debug, d_die, DW_DLA_DIE);
+    dwarf_dealloc (owner->d_debug, d_die, DW_DLA_DIE);
 return_error:
     lua_pushnil (L);
     lua_pushstring (L, error);
@@ -992,7 +1293,7 @@ function_gc (lua_State *L)
 {
     EolFunction *ef = to_eol_function (L);
 
-    TRACE_PTR (<, EolFunction, ef, " (%s)\n", ef->name ? ef->name : "?");
+    TRACE_PTR (<, EolFunction, ef, " (%s)\n", SYMBOL_NAME (ef));
 
     EOL_FUNCTION_FCALL_FREE (ef);
     symbol_free ((EolSymbol*) ef);
@@ -1003,7 +1304,8 @@ static int
 function_tostring (lua_State *L)
 {
     EolFunction *ef = to_eol_function (L);
-    lua_pushfstring (L, "eol.function (%p:%s)", ef->library, ef->name);
+    lua_pushfstring (L, "eol.function (%p:%s)",
+                     SYMBOL_LIBRARY (ef), SYMBOL_NAME (ef));
     return 1;
 }
 
@@ -1012,12 +1314,12 @@ function_tostring (lua_State *L)
     lua_Integer vname = luaL_checkinteger (L, (i));          \
     do {                                                     \
         size_t max = (expr);                                 \
-        if (vname < 0) vname += max;                         \
+        if (vname < 0) vname += max + 1;                     \
         if (vname <= 0 || vname > max)                       \
-            return luaL_error (L, "index %d out of bounds ", \
-                               "(effective=%d, max=%d)",     \
+            return luaL_error (L, "index %I out of bounds "  \
+                               "(effective=%I, max=%d)",     \
                                luaL_checkinteger (L, (i)),   \
-                               vname, max);                  \
+                               vname, (int) max);            \
         vname--;                                             \
     } while (0)
 
@@ -1038,13 +1340,13 @@ function_index (lua_State *L)
         if (!s) goto invalid_field;
         switch (s->code) {
             case EOL_SPECIAL_NAME:
-                lua_pushstring (L, ef->name);
+                lua_pushstring (L, SYMBOL_NAME (ef));
                 break;
             case EOL_SPECIAL_TYPE:
                 typeinfo_push_userdata (L, ef->return_typeinfo);
                 break;
             case EOL_SPECIAL_LIBRARY:
-                library_push_userdata (L, ef->library);
+                library_push_userdata (L, SYMBOL_LIBRARY (ef));
                 break;
             default:
             invalid_field:
@@ -1078,6 +1380,41 @@ static const luaL_Reg function_methods[] = {
 };
 
 
+/*
+ * The uservalue of a variable, when set, is a table with the "owner" of
+ * its memory (e.g. an arena), which the variable keeps alive, and the
+ * "finalizer" attached with eol.gc().
+ */
+static int
+variable_uservalue_get (lua_State *L, int index, const char *field)
+{
+    if (lua_getuservalue (L, index) != LUA_TTABLE) {
+        lua_pop (L, 1);
+        lua_pushnil (L);
+        return LUA_TNIL;
+    }
+    const int type = lua_getfield (L, -1, field);
+    lua_remove (L, -2);
+    return type;
+}
+
+/* Pops the value for the field from the stack. */
+static void
+variable_uservalue_set (lua_State *L, int index, const char *field)
+{
+    index = lua_absindex (L, index);
+    if (lua_getuservalue (L, index) != LUA_TTABLE) {
+        lua_pop (L, 1);
+        lua_createtable (L, 0, 2);
+        lua_pushvalue (L, -1);
+        lua_setuservalue (L, index);
+    }
+    lua_insert (L, -2);
+    lua_setfield (L, -2, field);
+    lua_pop (L, 1);
+}
+
+
 /* Methods for EolVariable userdatas. */
 static int
 variable_gc (lua_State *L)
@@ -1085,12 +1422,28 @@ variable_gc (lua_State *L)
     EolVariable *ev = to_eol_variable (L, 1);
 
     TRACE_PTR (<, EolVariable, ev, " type " GREEN "%p" NORMAL " (%s)\n",
-               ev->typeinfo, ev->name ? ev->name : "?");
+               ev->typeinfo, ev->origin ? ev->origin->name : "?");
 
-    if (ev->typeinfo_owned) {
-        eol_typeinfo_free (ev->typeinfo);
+    /*
+     * Run the finalizer attached with eol.gc(), if any, passing it the
+     * address of the value as its pointer parameter.
+     */
+    EolFunction *ef;
+    if (variable_uservalue_get (L, 1, "finalizer") == LUA_TUSERDATA &&
+        (ef = luaL_testudata (L, -1, EOL_FUNCTION)) && ev->address) {
+        variable_push_userdata (L, NULL, ef->param_types[0], ev->address,
+                                NULL, VARIABLE_PUSH_NOCOPY);
+        if (lua_pcall (L, 1, 0, 0) != LUA_OK) {
+            TRACE ("finalizer error: %s\n", lua_tostring (L, -1));
+            lua_pop (L, 1);
+        }
+    } else {
+        lua_pop (L, 1);
     }
+
     symbol_free ((EolSymbol*) ev);
+    /* Finalized values may still be seen, see mapping_clear_dependents(). */
+    ev->typeinfo = NULL;
     return 0;
 }
 
@@ -1098,11 +1451,11 @@ static int
 variable_tostring (lua_State *L)
 {
     EolVariable *ev = to_eol_variable (L, 1);
-    if (ev->library && ev->name) {
+    if (ev->origin) {
         lua_pushfstring (L,
                          "eol.variable<%s>(%p:%s)",
                          eol_typeinfo_name (ev->typeinfo),
-                         ev->library, ev->name);
+                         ev->origin->library, ev->origin->name);
     } else {
         lua_pushfstring (L,
                          "eol.variable<%s>(%p)",
@@ -1124,16 +1477,184 @@ variable_len (lua_State *L)
 }
 
 
+/*
+ * Weak table, stored in the registry, which maps (address, typeinfo) pairs
+ * to the EolVariable wrappers created by cvalue_push(). Dereferencing the
+ * same pointer (or reading the same member) repeatedly returns the same
+ * userdata instead of allocating a new one, which also makes the values
+ * usable as table keys. The cache can be disabled with eol.wrapcache().
+ */
+static const char EOL_WRAPPER_CACHE[] = "org.perezdecastro.eol.WrapperCache";
+
+static void
+wrapper_cache_setup (lua_State *L, bool enable)
+{
+    if (enable) {
+        registry_set_weak_table (L, EOL_WRAPPER_CACHE);
+    } else {
+        lua_pushnil (L);
+        lua_rawsetp (L, LUA_REGISTRYINDEX, EOL_WRAPPER_CACHE);
+    }
+}
+
+static void
+variable_push_cached (lua_State         *L,
+                      const EolTypeInfo *typeinfo,
+                      void              *address)
+{
+    if (lua_rawgetp (L, LUA_REGISTRYINDEX, EOL_WRAPPER_CACHE) != LUA_TTABLE) {
+        lua_pop (L, 1);
+        variable_push_userdata (L, NULL, typeinfo, address, NULL,
+                                VARIABLE_PUSH_NOCOPY);
+        return;
+    }
+
+    /* Short strings are interned: no allocation when the key exists. */
+    const void *key[2] = { address, typeinfo };
+    lua_pushlstring (L, (const char*) key, sizeof (key)); /* cache key */
+    lua_pushvalue (L, -1);                                /* cache key key */
+    if (lua_rawget (L, -3) == LUA_TUSERDATA) {            /* cache key ev */
+        lua_replace (L, -3);                              /* ev key */
+        lua_pop (L, 1);                                   /* ev */
+        return;
+    }
+    lua_pop (L, 1);                                       /* cache key */
+
+    variable_push_userdata (L, NULL, typeinfo, address, NULL,
+                            VARIABLE_PUSH_NOCOPY);        /* cache key ev */
+    lua_pushvalue (L, -1);                                /* cache key ev ev */
+    lua_insert (L, -4);                                   /* ev cache key ev */
+    lua_rawset (L, -3);                                   /* ev cache */
+    lua_pop (L, 1);                                       /* ev */
+}
+
+
 #define ADDR_OFF(ctype, base, offset) \
     ((ctype*) (((uintptr_t) base) + offset))
 
-#define FLOAT_TO_LUA(suffix, name, ctype) \
-        case EOL_TYPE_ ## suffix:         \
-            lua_pushnumber (L, *ADDR_OFF (ctype, address, 0)); return 1;
+/*
+ * Converters between Lua and C values, one pair for each kind of type.
+ * They are chosen once for each (non-synthetic) type by cvalue_ops(),
+ * which attaches them to the type with eol_typeinfo_set_ops(). Reading or
+ * writing a value then is a direct call, instead of inspecting the type
+ * every time. The "typeinfo" passed to them is always non-synthetic.
+ */
+typedef int (*CValuePushFunc) (lua_State         *L,
+                               const EolTypeInfo *typeinfo,
+                               void              *address,
+                               VariablePushMode   push_mode);
+typedef int (*CValueGetFunc)  (lua_State         *L,
+                               int                lindex,
+                               const EolTypeInfo *typeinfo,
+                               void              *address);
+typedef struct {
+    CValuePushFunc push;
+    CValueGetFunc  get;
+} CValueOps;
+
+static const CValueOps* cvalue_ops (const EolTypeInfo *typeinfo);
+
+
+#define FLOAT_TO_LUA(suffix, name, ctype)                     \
+    static int                                                \
+    cvalue_push_ ## name (lua_State         *L,               \
+                          const EolTypeInfo *typeinfo,        \
+                          void              *address,         \
+                          VariablePushMode   push_mode)       \
+    {                                                         \
+        lua_pushnumber (L, *ADDR_OFF (ctype, address, 0));    \
+        return 1;                                             \
+    }
+
+#define INTEGER_TO_LUA(suffix, name, ctype)                   \
+    static int                                                \
+    cvalue_push_ ## name (lua_State         *L,               \
+                          const EolTypeInfo *typeinfo,        \
+                          void              *address,         \
+                          VariablePushMode   push_mode)       \
+    {                                                         \
+        lua_pushinteger (L, *ADDR_OFF (ctype, address, 0));   \
+        return 1;                                             \
+    }
+
+INTEGER_TYPES (INTEGER_TO_LUA)
+FLOAT_TYPES (FLOAT_TO_LUA)
+
+#undef INTEGER_TO_LUA
+#undef FLOAT_TO_LUA
+
+
+static int
+cvalue_push_bool (lua_State         *L,
+                  const EolTypeInfo *typeinfo,
+                  void              *address,
+                  VariablePushMode   push_mode)
+{
+    lua_pushboolean (L, *ADDR_OFF (bool, address, 0));
+    return 1;
+}
+
+static int
+cvalue_push_enum_unsupported (lua_State         *L,
+                              const EolTypeInfo *typeinfo,
+                              void              *address,
+                              VariablePushMode   push_mode)
+{
+    typeinfo_push_stringrep (L, typeinfo, false);
+    return luaL_error (L, "size %d for type '%s' unsupported",
+                       eol_typeinfo_sizeof (typeinfo),
+                       lua_tostring (L, -1));
+}
+
+static int
+cvalue_push_pointer (lua_State         *L,
+                     const EolTypeInfo *typeinfo,
+                     void              *address,
+                     VariablePushMode   push_mode)
+{
+    if (*ADDR_OFF (void*, address, 0)) {
+        variable_push_cached (L, typeinfo, *ADDR_OFF (void*, address, 0));
+    } else {
+        /* Map NULL pointers to "nil". */
+        lua_pushnil (L);
+    }
+    return 1;
+}
+
+static int
+cvalue_push_compound (lua_State         *L,
+                      const EolTypeInfo *typeinfo,
+                      void              *address,
+                      VariablePushMode   push_mode)
+{
+    if (push_mode == VARIABLE_PUSH_NOCOPY) {
+        variable_push_cached (L, typeinfo, address);
+    } else {
+        variable_push_userdata (L, NULL, typeinfo,
+                                address, NULL, push_mode);
+    }
+    return 1;
+}
+
+static int
+cvalue_push_void (lua_State         *L,
+                  const EolTypeInfo *typeinfo,
+                  void              *address,
+                  VariablePushMode   push_mode)
+{
+    return 0; /* Nothing to push. */
+}
+
+static int
+cvalue_push_unsupported (lua_State         *L,
+                         const EolTypeInfo *typeinfo,
+                         void              *address,
+                         VariablePushMode   push_mode)
+{
+    typeinfo_push_stringrep (L, typeinfo, true);
+    return luaL_error (L, "unsupported type: %s", lua_tostring (L, -1));
+}
 
-#define INTEGER_TO_LUA(suffix, name, ctype) \
-        case EOL_TYPE_ ## suffix:           \
-            lua_pushinteger (L, *ADDR_OFF (ctype, address, 0)); return 1;
 
 static inline int
 cvalue_push (lua_State         *L,
@@ -1143,66 +1664,41 @@ cvalue_push (lua_State         *L,
 {
     CHECK_NOT_ZERO (address);
     typeinfo = eol_typeinfo_get_non_synthetic (typeinfo);
-    switch (eol_typeinfo_type (typeinfo)) {
-        INTEGER_TYPES (INTEGER_TO_LUA)
-        FLOAT_TYPES (FLOAT_TO_LUA)
-
-        case EOL_TYPE_ENUM:
-            switch (eol_typeinfo_sizeof (typeinfo)) {
-                case 1:
-                    lua_pushinteger (L, *ADDR_OFF (int8_t, address, 0));
-                    break;
-                case 2:
-                    lua_pushinteger (L, *ADDR_OFF (int16_t, address, 0));
-                    break;
-                case 4:
-                    lua_pushinteger (L, *ADDR_OFF (int32_t, address, 0));
-                    break;
-                case 8:
-                    lua_pushinteger (L, *ADDR_OFF (int64_t, address, 0));
-                    break;
-                default:
-                    typeinfo_push_stringrep (L, typeinfo, false);
-                    return luaL_error (L, "size %d for type '%s' unsupported",
-                                       eol_typeinfo_sizeof (typeinfo),
-                                       lua_tostring (L, -1));
-            }
-            return 1;
+    return (*cvalue_ops (typeinfo)->push) (L, typeinfo, address, push_mode);
+}
 
-        case EOL_TYPE_BOOL:
-            lua_pushboolean (L, *ADDR_OFF (bool, address, 0));
-            return 1;
 
-        case EOL_TYPE_POINTER:
-            if (*ADDR_OFF (void*, address, 0)) {
-                variable_push_userdata (L, NULL, typeinfo,
-                                        *ADDR_OFF (void*, address, 0),
-                                        NULL, VARIABLE_PUSH_NOCOPY);
-            } else {
-                /* Map NULL pointers to "nil". */
-                lua_pushnil (L);
-            }
-            return 1;
+/* Defined along with mappings, below. */
+static void mapping_add_dependent (lua_State *L, int container, int index);
 
-        case EOL_TYPE_UNION:
-        case EOL_TYPE_ARRAY:
-        case EOL_TYPE_STRUCT:
-            variable_push_userdata (L, NULL, typeinfo,
-                                    address, NULL, push_mode);
-            return 1;
 
-        case EOL_TYPE_VOID:
-            return 0; /* Nothing to push. */
+/*
+ * Pushes an element or member of the variable (or view) at index
+ * "container". Compound values keep the read-only qualifier of their
+ * container, otherwise writes to their own members would not be checked,
+ * and are made dependents of the mapping which holds their memory, if any.
+ */
+static inline int
+cvalue_push_element (lua_State         *L,
+                     int                container,
+                     const EolTypeInfo *typeinfo,
+                     void              *address,
+                     bool               readonly)
+{
+    typeinfo = eol_typeinfo_get_non_synthetic (typeinfo);
+    if (!eol_typeinfo_is_struct (typeinfo) &&
+        !eol_typeinfo_is_union (typeinfo) &&
+        !eol_typeinfo_is_array (typeinfo))
+        return cvalue_push (L, typeinfo, address, VARIABLE_PUSH_NOCOPY);
 
-        default:
-            typeinfo_push_stringrep (L, typeinfo, true);
-            return luaL_error (L, "unsupported type: %s", lua_tostring (L, -1));
-    }
+    CHECK_NOT_ZERO (address);
+    if (readonly)
+        typeinfo = eol_type_cache_derived (EOL_TYPE_CONST, typeinfo, 0);
+    variable_push_cached (L, typeinfo, address);
+    mapping_add_dependent (L, container, -1);
+    return 1;
 }
 
-#undef INTEGER_TO_LUA
-#undef FLOAT_TO_LUA
-
 
 static inline int
 variable_index_special (lua_State        *L,
@@ -1214,16 +1710,21 @@ variable_index_special (lua_State        *L,
 
     switch (S->code) {
         case EOL_SPECIAL_NAME:
-            lua_pushstring (L, V->name);
+            lua_pushstring (L, SYMBOL_NAME (V));
             break;
         case EOL_SPECIAL_TYPE:
             typeinfo_push_userdata (L, V->typeinfo);
             break;
         case EOL_SPECIAL_VALUE:
-            return cvalue_push (L, V->typeinfo, V->address,
-                                VARIABLE_PUSH_NOCOPY);
+            if (!V->address)
+                return luaL_error (L, "value was freed or unmapped");
+            return cvalue_push_element (L, 1, V->typeinfo, V->address,
+                                        eol_typeinfo_is_readonly (V->typeinfo));
         case EOL_SPECIAL_LIBRARY:
-            library_push_userdata (L, V->library);
+            if (V->origin)
+                library_push_userdata (L, V->origin->library);
+            else
+                lua_pushnil (L);
             break;
         default:
             return luaL_error (L, "invalid field '%s'", S->name);
@@ -1232,256 +1733,2434 @@ variable_index_special (lua_State        *L,
 }
 
 
-static int
-variable_index (lua_State *L)
+/* Returns the special field named by the key at "index", if any. */
+static inline const EolSpecial*
+variable_lookup_special (lua_State *L, int index)
 {
-    EolVariable *V = to_eol_variable (L, 1);
-    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
-    if (!T) return luaL_error (L, "cannot get actual type");
+    if (lua_type (L, index) != LUA_TSTRING)
+        return NULL;
 
-    const char *named_field = NULL;
-    size_t named_field_length = 0;
-    if (lua_type (L, 2) == LUA_TSTRING) {
-        named_field = lua_tolstring (L, 2, &named_field_length);
-        const EolSpecial *s = (named_field_length > 2 &&
-                               named_field[0] == '_' &&
-                               named_field[1] == '_')
-            ? eol_special_lookup (named_field + 2, named_field_length - 2)
-            : NULL;
-        if (s) return variable_index_special (L, V, s);
-    }
+    size_t length;
+    const char *name = lua_tolstring (L, index, &length);
+    return (length > 2 && name[0] == '_' && name[1] == '_')
+        ? eol_special_lookup (name + 2, length - 2)
+        : NULL;
+}
 
-    switch (eol_typeinfo_type (T)) {
-        case EOL_TYPE_ARRAY: {
-            L_BOUNDS_CHECK (index, 2, eol_typeinfo_array_n_items (T));
-            T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
-            return cvalue_push (L, T,
-                                ADDR_OFF (void, V->address,
-                                          index * eol_typeinfo_sizeof (T)),
-                                VARIABLE_PUSH_NOCOPY);
+
+/*
+ * Address of the element of a (possibly multi-dimensional) array at the
+ * indices in the stack positions from "first" to "last", computed using
+ * the chain of array types. No wrappers are created for the intermediate
+ * sub-arrays. The type of the element is stored in "typeinfo".
+ */
+static void*
+array_element_address (lua_State          *L,
+                       EolVariable        *V,
+                       int                 first,
+                       int                 last,
+                       const EolTypeInfo **typeinfo)
+{
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+    uintptr_t address = (uintptr_t) V->address;
+
+    for (int i = first; i <= last; i++) {
+        if (!eol_typeinfo_is_array (T)) {
+            typeinfo_push_stringrep (L, V->typeinfo, false);
+            luaL_error (L, "too many indices (%d) for type '%s'",
+                        last - first + 1, lua_tostring (L, -1));
         }
-        case EOL_TYPE_UNION:
-        case EOL_TYPE_STRUCT: {
-            const EolTypeInfoMember *member = NULL;
-            if (!named_field) {
-                L_BOUNDS_CHECK (index, 2, eol_typeinfo_compound_n_members (T));
-                member = eol_typeinfo_compound_const_member (T, index);
-            } else if (!(member = eol_typeinfo_compound_const_named_member (T, named_field))) {
-                typeinfo_push_stringrep (L, T, true);
-                return luaL_error (L, "%s: no such member in type '%s'",
-                                   named_field, lua_tostring (L, -1));
-            }
 
-            CHECK_NOT_NULL (member);
-            return cvalue_push (L, member->typeinfo,
-                                eol_typeinfo_is_struct (T)
-                                    ? ADDR_OFF (void, V->address, member->offset)
-                                    : V->address,
-                                VARIABLE_PUSH_NOCOPY);
+        const lua_Integer n_items = eol_typeinfo_array_n_items (T);
+        lua_Integer index = luaL_checkinteger (L, i);
+        if (index < 0) index += n_items + 1;
+        if (index <= 0 || index > n_items) {
+            luaL_error (L, "index #%d (%d) out of bounds (length=%d)",
+                        i - first + 1, (int) luaL_checkinteger (L, i),
+                        (int) n_items);
         }
-        default:
-            return luaL_error (L, "not indexable");
+
+        T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
+        address += (index - 1) * eol_typeinfo_sizeof (T);
     }
+
+    *typeinfo = T;
+    return (void*) address;
 }
 
 
-static void
-l_typecheck (lua_State         *L,
-             int                idx,
-             const EolTypeInfo *dst,
-             const EolTypeInfo *src)
+/*
+ * Usage: value = array:get(i, j, ...)
+ */
+static int
+array_get (lua_State *L)
 {
-    CHECK_NOT_NULL (dst);
-    CHECK_NOT_NULL (src);
+    EolVariable *V = to_eol_variable (L, 1);
+    const EolTypeInfo *T;
+    void *address = array_element_address (L, V, 2, lua_gettop (L), &T);
+    return cvalue_push_element (L, 1, T, address,
+                                eol_typeinfo_is_readonly (V->typeinfo));
+}
 
-    if (!eol_typeinfo_equal (dst, src)) {
-        typeinfo_push_stringrep (L, dst, false);
-        typeinfo_push_stringrep (L, src, false);
-        luaL_error (L, "#%d: expected value of type '%s', given '%s'",
-                    (idx < 1) ? (lua_gettop (L) + idx) : idx,
-                    lua_tostring (L, -2), lua_tostring (L, -1));
+
+/*
+ * Usage: array:set(i, j, ..., value)
+ */
+static int
+array_set (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    if (eol_typeinfo_is_readonly (V->typeinfo)) {
+        return luaL_error (L, "read-only variable (%p:%s)",
+                           SYMBOL_LIBRARY (V), SYMBOL_NAME (V));
     }
+
+    const int value_index = lua_gettop (L);
+    luaL_checkany (L, 3);
+
+    const EolTypeInfo *T;
+    void *address = array_element_address (L, V, 2, value_index - 1, &T);
+    return (*cvalue_ops (T)->get) (L, value_index, T, address);
 }
 
 
-#define FLOAT_FROM_LUA(suffix, name, ctype)           \
-        case EOL_TYPE_ ## suffix:                     \
-            *ADDR_OFF (ctype, address, 0) =           \
-                (ctype) luaL_checknumber (L, lindex); \
-            break;
+/*
+ * Strided views over arrays, created with array:slice(i, j) and
+ * array:field("name"), which can be chained. Elements are at "address"
+ * plus a multiple of "stride", and are never copied. Views keep the
+ * value they were created from alive by storing it as user value.
+ */
+static const char EOL_VIEW[] = "org.perezdecastro.eol.View";
 
-#define INTEGER_FROM_LUA(suffix, name, ctype)          \
-        case EOL_TYPE_ ## suffix:                      \
-            *ADDR_OFF (ctype, address, 0) =            \
-                (ctype) luaL_checkinteger (L, lindex); \
-            break;
+typedef struct {
+    void              *address;
+    const EolTypeInfo *typeinfo;  /* Element type, non-synthetic. */
+    const CValueOps   *ops;
+    uint32_t           stride;
+    uint32_t           n_items;
+    bool               readonly;
+} EolView;
 
-static inline int
-cvalue_get (lua_State         *L,
-            int                lindex,
-            const EolTypeInfo* typeinfo,
-           void               *address)
+
+static inline EolView*
+to_eol_view (lua_State *L, int index)
 {
-    CHECK_NOT_ZERO (address);
-    typeinfo = eol_typeinfo_get_non_synthetic (typeinfo);
-    switch (eol_typeinfo_type (typeinfo)) {
-        INTEGER_TYPES (INTEGER_FROM_LUA)
-        FLOAT_TYPES (FLOAT_FROM_LUA)
+    return (EolView*) luaL_checkudata (L, index, EOL_VIEW);
+}
 
-        case EOL_TYPE_BOOL:
-            *ADDR_OFF (bool, address, 0) = lua_toboolean (L, lindex);
-            break;
 
-        case EOL_TYPE_POINTER:
-            if (eol_typeinfo_is_cstring (typeinfo) &&
-                    lua_type (L, lindex) == LUA_TSTRING) {
-                *ADDR_OFF (const char*, address, 0) = lua_tostring (L, lindex);
-            } else {
-                EolVariable *ev = to_eol_variable (L, lindex);
-                l_typecheck (L, lindex - 1, typeinfo,
-                             eol_typeinfo_get_non_synthetic (ev->typeinfo));
-                *ADDR_OFF (void*, address, 0) = ev->address;
-            }
-            break;
+/* Fills "view" from either an EolView, or an array variable. */
+static void
+view_from_value (lua_State *L, int index, EolView *view)
+{
+    EolView *ew = luaL_testudata (L, index, EOL_VIEW);
+    if (ew) {
+        *view = *ew;
+        return;
+    }
 
-        case EOL_TYPE_STRUCT: {
-            EolVariable *ev = to_eol_variable (L, lindex);
-            l_typecheck (L, lindex - 1, typeinfo,
-                         eol_typeinfo_get_non_synthetic (ev->typeinfo));
-            CHECK_SIZE_EQ (eol_typeinfo_sizeof (typeinfo),
-                           eol_typeinfo_sizeof (ev->typeinfo));
-            memcpy (ADDR_OFF (void, address, 0),
-                    ADDR_OFF (void, ev->address, 0),
-                    eol_typeinfo_sizeof (typeinfo));
-            break;
-        }
-        default:
-            typeinfo_push_stringrep (L, typeinfo, true);
-            return luaL_error (L, "unsupported type: %s", lua_tostring (L, -1));
+    EolVariable *V = to_eol_variable (L, index);
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+    if (!eol_typeinfo_is_array (T))
+        luaL_argerror (L, index, "array or view expected");
+
+    view->address  = V->address;
+    view->n_items  = eol_typeinfo_array_n_items (T);
+    view->readonly = eol_typeinfo_is_readonly (V->typeinfo);
+    view->typeinfo = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
+    view->stride   = eol_typeinfo_sizeof (view->typeinfo);
+    view->ops      = cvalue_ops (view->typeinfo);
+}
+
+
+static EolView*
+view_push_userdata (lua_State *L, int source, const EolView *view)
+{
+    EolView *ew = lua_newuserdata (L, sizeof (EolView));
+    *ew = *view;
+    luaL_setmetatable (L, EOL_VIEW);
+    lua_pushvalue (L, source);
+    lua_setuservalue (L, -2);
+    mapping_add_dependent (L, source, -1);
+    return ew;
+}
+
+
+static inline uint32_t
+view_check_index (lua_State *L, const EolView *view, int index)
+{
+    lua_Integer i = luaL_checkinteger (L, index);
+    if (i < 0) i += view->n_items + 1;
+    if (i <= 0 || i > view->n_items) {
+        luaL_error (L, "index %d out of bounds (length=%d)",
+                    (int) luaL_checkinteger (L, index), (int) view->n_items);
+    }
+    return i - 1;
+}
+
+
+/*
+ * Usage: view = array:slice(i [, j])
+ */
+static int
+view_slice (lua_State *L)
+{
+    EolView view;
+    view_from_value (L, 1, &view);
+
+    lua_Integer first = luaL_checkinteger (L, 2);
+    lua_Integer last = luaL_optinteger (L, 3, view.n_items);
+    if (first < 0) first += view.n_items + 1;
+    if (last < 0) last += view.n_items + 1;
+    if (first < 1 || last > view.n_items || last < first - 1) {
+        return luaL_error (L, "slice [%d, %d] out of bounds (length=%d)",
+                           (int) first, (int) last, (int) view.n_items);
     }
 
+    view.address = ADDR_OFF (void, view.address, (first - 1) * view.stride);
+    view.n_items = last - first + 1;
+    view_push_userdata (L, 1, &view);
     return 1;
 }
 
-#undef INTEGER_FROM_LUA
-#undef FLOAT_FROM_LUA
-#undef SLOT
-
 
-static inline int
-variable_newindex_special (lua_State        *L,
-                           int               lindex,
-                           EolVariable      *V,
-                           const EolSpecial *S)
+/*
+ * Usage: view = array:field("name")
+ */
+static int
+view_field (lua_State *L)
 {
-    CHECK_NOT_NULL (L);
-    CHECK_NOT_NULL (V);
+    EolView view;
+    view_from_value (L, 1, &view);
+    const char *name = luaL_checkstring (L, 2);
 
-    switch (S->code) {
-        case EOL_SPECIAL_VALUE:
-            return cvalue_get (L, lindex, V->typeinfo, V->address);
-        case EOL_SPECIAL_NAME:
-        case EOL_SPECIAL_TYPE:
-        case EOL_SPECIAL_LIBRARY:
-            return luaL_error (L, "field '__%s' is read-only", S->name);
-        default:
-            return luaL_error (L, "invalid field '__%s'", S->name);
+    if (!eol_typeinfo_is_struct (view.typeinfo) &&
+        !eol_typeinfo_is_union (view.typeinfo)) {
+        typeinfo_push_stringrep (L, view.typeinfo, false);
+        return luaL_error (L, "elements of type '%s' do not have fields",
+                           lua_tostring (L, -1));
+    }
+
+    const EolTypeInfoMember *member =
+            eol_typeinfo_compound_const_named_member (view.typeinfo, name);
+    if (!member) {
+        typeinfo_push_stringrep (L, view.typeinfo, true);
+        return luaL_error (L, "%s: no such member in type '%s'",
+                           name, lua_tostring (L, -1));
     }
+
+    if (eol_typeinfo_is_struct (view.typeinfo))
+        view.address = ADDR_OFF (void, view.address, member->offset);
+    view.readonly |= eol_typeinfo_is_readonly (member->typeinfo);
+    view.typeinfo = eol_typeinfo_get_non_synthetic (member->typeinfo);
+    view.ops      = cvalue_ops (view.typeinfo);
+    view_push_userdata (L, 1, &view);
+    return 1;
 }
 
 
+/*
+ * Usage: n = view:copy(destination)
+ *
+ * Copies the elements of the view into a contiguous array (or another
+ * view), which must have elements of the same type and enough room.
+ */
 static int
-variable_newindex (lua_State *L)
+view_copy (lua_State *L)
 {
-    EolVariable *V = to_eol_variable (L, 1);
+    EolView src, dst;
+    view_from_value (L, 1, &src);
+    view_from_value (L, 2, &dst);
+
+    if (dst.readonly)
+        return luaL_error (L, "destination is read-only");
+    if (src.typeinfo != dst.typeinfo &&
+        !eol_typeinfo_equal (src.typeinfo, dst.typeinfo)) {
+        typeinfo_push_stringrep (L, src.typeinfo, false);
+        typeinfo_push_stringrep (L, dst.typeinfo, false);
+        return luaL_error (L, "cannot copy elements of type '%s' to '%s'",
+                           lua_tostring (L, -2), lua_tostring (L, -1));
+    }
+    if (dst.n_items < src.n_items) {
+        return luaL_error (L, "destination too small (%d < %d)",
+                           (int) dst.n_items, (int) src.n_items);
+    }
 
-    if (eol_typeinfo_is_readonly (V->typeinfo)) {
-        return luaL_error (L, "read-only variable (%p:%s)",
-                           V->library, V->name);
+    const size_t size = eol_typeinfo_sizeof (src.typeinfo);
+    if (src.stride == size && dst.stride == size) {
+        memmove (dst.address, src.address, size * src.n_items);
+    } else {
+        for (uint32_t i = 0; i < src.n_items; i++) {
+            memmove (ADDR_OFF (void, dst.address, (size_t) i * dst.stride),
+                     ADDR_OFF (void, src.address, (size_t) i * src.stride),
+                     size);
+        }
     }
+    lua_pushinteger (L, src.n_items);
+    return 1;
+}
 
-    if (lua_type (L, 2) == LUA_TSTRING) {
-        size_t length;
-        const char *name = lua_tolstring (L, 2, &length);
-        const EolSpecial *s = (length > 2 && name[0] == '_' && name[1] == '_')
-            ? eol_special_lookup (name + 2, length - 2)
-            : NULL;
-        if (s) return variable_newindex_special (L, 3, V, s);
+
+static const luaL_Reg view_functions[] = {
+    { "slice", view_slice },
+    { "field", view_field },
+    { "copy",  view_copy  },
+    { NULL, NULL },
+};
+
+/* Methods of array variables, in addition to the view functions. */
+static const luaL_Reg array_functions[] = {
+    { "get", array_get },
+    { "set", array_set },
+    { NULL, NULL },
+};
+
+
+/* Pushes the function for key "index" from "functions", if found. */
+static bool
+push_named_function (lua_State      *L,
+                     int             index,
+                     const luaL_Reg *functions)
+{
+    const char *name = lua_tostring (L, index);
+    if (name) {
+        for (; functions->name; functions++) {
+            if (string_equal (name, functions->name)) {
+                lua_pushcfunction (L, functions->func);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+static int
+view_index (lua_State *L)
+{
+    EolView *ew = to_eol_view (L, 1);
+    if (!lua_isinteger (L, 2) && push_named_function (L, 2, view_functions))
+        return 1;
+
+    const uint32_t i = view_check_index (L, ew, 2);
+    void *address = ADDR_OFF (void, ew->address, (size_t) i * ew->stride);
+    return cvalue_push_element (L, 1, ew->typeinfo, address, ew->readonly);
+}
+
+
+static int
+view_newindex (lua_State *L)
+{
+    EolView *ew = to_eol_view (L, 1);
+    if (ew->readonly)
+        return luaL_error (L, "read-only view");
+
+    const uint32_t i = view_check_index (L, ew, 2);
+    void *address = ADDR_OFF (void, ew->address, (size_t) i * ew->stride);
+    return (*ew->ops->get) (L, 3, ew->typeinfo, address);
+}
+
+
+static int
+view_len (lua_State *L)
+{
+    lua_pushinteger (L, to_eol_view (L, 1)->n_items);
+    return 1;
+}
+
+
+static int
+view_tostring (lua_State *L)
+{
+    EolView *ew = to_eol_view (L, 1);
+    lua_pushfstring (L, "eol.view<%s>(%p, %d, stride=%d)",
+                     eol_typeinfo_name (ew->typeinfo), ew->address,
+                     (int) ew->n_items, (int) ew->stride);
+    return 1;
+}
+
+
+static const luaL_Reg view_methods[] = {
+    { "__index",    view_index    },
+    { "__newindex", view_newindex },
+    { "__len",      view_len      },
+    { "__tostring", view_tostring },
+    { NULL, NULL },
+};
+
+
+/*
+ * Atomic operations on integer (including enums and booleans) and pointer
+ * values, which can be the value of a scalar variable, a member of a struct
+ * or union, or an element of an array:
+ *
+ *   value = var:atomic_load([key])
+ *   var:atomic_store([key,] value)
+ *   old = var:fetch_add([key,] delta)
+ *   ok, current = var:compare_exchange([key,] expected, desired)
+ *
+ * The key (member name or index, or array index) is omitted for scalar
+ * variables. All operations are sequentially consistent. Values are
+ * converted with the same functions used for normal accesses, into a
+ * local buffer which is then accessed atomically.
+ */
+typedef struct {
+    void              *address;
+    const EolTypeInfo *typeinfo;
+    const CValueOps   *ops;
+    uint32_t           size;
+} EolAtomicTarget;
+
+#define ATOMIC_SIZES(F) \
+    F (1, uint8_t )     \
+    F (2, uint16_t)     \
+    F (4, uint32_t)     \
+    F (8, uint64_t)
+
+typedef union {
+#define ATOMIC_VALUE_MEMBER(nbytes, ctype) ctype u ## nbytes;
+    ATOMIC_SIZES (ATOMIC_VALUE_MEMBER)
+#undef ATOMIC_VALUE_MEMBER
+} EolAtomicValue;
+
+
+/*
+ * Enum values cannot be written by normal accesses, so the operands are
+ * converted explicitly, as signed integers of the same size.
+ */
+static void
+enum_value_get (lua_State *L, int index, uint32_t size, void *address)
+{
+    const lua_Integer value = luaL_checkinteger (L, index);
+    switch (size) {
+        case 1: *ADDR_OFF (int8_t,  address, 0) = value; break;
+        case 2: *ADDR_OFF (int16_t, address, 0) = value; break;
+        case 4: *ADDR_OFF (int32_t, address, 0) = value; break;
+        default: *ADDR_OFF (int64_t, address, 0) = value;
     }
+}
+
 
+/* Returns the stack index of the first operand. */
+static int
+atomic_target (lua_State *L, EolAtomicTarget *target, bool write)
+{
+    EolVariable *V = to_eol_variable (L, 1);
     const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
-    if (!T) return luaL_error (L, "cannot get actual type");
+    bool readonly = eol_typeinfo_is_readonly (V->typeinfo);
+    void *address = V->address;
+    int operand = 3;
 
     switch (eol_typeinfo_type (T)) {
         case EOL_TYPE_ARRAY: {
             L_BOUNDS_CHECK (index, 2, eol_typeinfo_array_n_items (T));
+            readonly |= eol_typeinfo_is_readonly (eol_typeinfo_base (T));
             T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
-            return cvalue_get (L, 3, T,
-                               ADDR_OFF (void, V->address,
-                                         index * eol_typeinfo_sizeof (T)));
+            address = ADDR_OFF (void, address,
+                                index * eol_typeinfo_sizeof (T));
+            break;
         }
-        case EOL_TYPE_STRUCT: {
+        case EOL_TYPE_STRUCT:
+        case EOL_TYPE_UNION: {
             const EolTypeInfoMember *member;
             if (lua_isinteger (L, 2)) {
                 L_BOUNDS_CHECK (index, 2, eol_typeinfo_compound_n_members (T));
                 member = eol_typeinfo_compound_const_member (T, index);
             } else {
                 const char *name = luaL_checkstring (L, 2);
-                member = eol_typeinfo_compound_const_named_member (T, name);
-                if (!member) {
-                    return luaL_error (L, "%s: no such struct member", name);
+                if (!(member = eol_typeinfo_compound_const_named_member (T, name))) {
+                    typeinfo_push_stringrep (L, T, true);
+                    return luaL_error (L, "%s: no such member in type '%s'",
+                                       name, lua_tostring (L, -1));
                 }
             }
-            return cvalue_get (L, 3, member->typeinfo,
-                               ADDR_OFF (void, V->address, member->offset));
+            if (eol_typeinfo_is_struct (T))
+                address = ADDR_OFF (void, address, member->offset);
+            readonly |= eol_typeinfo_is_readonly (member->typeinfo);
+            T = eol_typeinfo_get_non_synthetic (member->typeinfo);
+            break;
         }
         default:
-            return luaL_error (L, "not indexable");
+            operand = 2;
     }
 
-    return 0;
-}
-
+    switch (eol_typeinfo_type (T)) {
+#define ATOMIC_TYPE_CASE(suffix, name, ctype) \
+        case EOL_TYPE_ ## suffix:
+        INTEGER_TYPES (ATOMIC_TYPE_CASE)
+#undef ATOMIC_TYPE_CASE
+        case EOL_TYPE_BOOL:
+        case EOL_TYPE_ENUM:
+        case EOL_TYPE_POINTER:
+            break;
+        default:
+            typeinfo_push_stringrep (L, T, false);
+            return luaL_error (L, "atomic operations not supported for "
+                               "type '%s'", lua_tostring (L, -1));
+    }
 
-static const luaL_Reg variable_methods[] = {
-    { "__gc",       variable_gc       },
-    { "__tostring", variable_tostring },
-    { "__len",      variable_len      },
-    { "__index",    variable_index    },
-    { "__newindex", variable_newindex },
-    { NULL, NULL },
-};
+    const uint32_t size = eol_typeinfo_sizeof (T);
+    switch (size) {
+#define ATOMIC_SIZE_CASE(nbytes, ctype) case nbytes:
+        ATOMIC_SIZES (ATOMIC_SIZE_CASE)
+#undef ATOMIC_SIZE_CASE
+            break;
+        default:
+            return luaL_error (L, "atomic operations not supported for "
+                               "values of size %d", (int) size);
+    }
+    if ((uintptr_t) address % size)
+        return luaL_error (L, "misaligned address %p for atomic access",
+                           address);
+    if (write && readonly)
+        return luaL_error (L, "read-only value");
+
+    target->address  = address;
+    target->typeinfo = T;
+    target->ops      = cvalue_ops (T);
+    target->size     = size;
+    return operand;
+}
 
 
+/* Converts a Lua value to the representation of the target type. */
 static void
-create_meta (lua_State *L)
+atomic_operand (lua_State             *L,
+                int                    index,
+                const EolAtomicTarget *target,
+                EolAtomicValue        *value)
 {
-    /* EolLibrary */
-    luaL_newmetatable (L, EOL_LIBRARY);
-    luaL_setfuncs (L, library_methods, 0);
-    lua_pop (L, 1);
-
-    /* EolFunction */
-    luaL_newmetatable (L, EOL_FUNCTION);
-    luaL_setfuncs (L, function_methods, 0);
-    lua_pop (L, 1);
-
-    /* EolVariable */
-    luaL_newmetatable (L, EOL_VARIABLE);
-    luaL_setfuncs (L, variable_methods, 0);
-    lua_pop (L, 1);
-
-    /* EolypeInfo */
-    luaL_newmetatable (L, EOL_TYPEINFO);
-    luaL_setfuncs (L, typeinfo_methods, 0);
-    lua_pop (L, 1);
+    value->u8 = 0;
+    if (eol_typeinfo_is_pointer (target->typeinfo) && lua_isnil (L, index))
+        return;
+    if (eol_typeinfo_is_enum (target->typeinfo))
+        enum_value_get (L, index, target->size, value);
+    else
+        (*target->ops->get) (L, index, target->typeinfo, value);
 }
 
 
 static int
-eol_load (lua_State *L)
+atomic_load (lua_State *L)
 {
-    size_t name_length;
+    EolAtomicTarget target;
+    atomic_target (L, &target, false);
+
+    EolAtomicValue value = { .u8 = 0 };
+    switch (target.size) {
+#define ATOMIC_LOAD_CASE(nbytes, ctype)                                   \
+        case nbytes:                                                      \
+            value.u ## nbytes = __atomic_load_n ((ctype*) target.address, \
+                                                  __ATOMIC_SEQ_CST);      \
+            break;
+        ATOMIC_SIZES (ATOMIC_LOAD_CASE)
+#undef ATOMIC_LOAD_CASE
+    }
+    return (*target.ops->push) (L, target.typeinfo, &value,
+                                VARIABLE_PUSH_COPY);
+}
+
+
+static int
+atomic_store (lua_State *L)
+{
+    EolAtomicTarget target;
+    int operand = atomic_target (L, &target, true);
+
+    EolAtomicValue value;
+    atomic_operand (L, operand, &target, &value);
+    switch (target.size) {
+#define ATOMIC_STORE_CASE(nbytes, ctype)                            \
+        case nbytes:                                                \
+            __atomic_store_n ((ctype*) target.address,              \
+                              value.u ## nbytes, __ATOMIC_SEQ_CST); \
+            break;
+        ATOMIC_SIZES (ATOMIC_STORE_CASE)
+#undef ATOMIC_STORE_CASE
+    }
+    return 0;
+}
+
+
+static int
+atomic_fetch_add (lua_State *L)
+{
+    EolAtomicTarget target;
+    int operand = atomic_target (L, &target, true);
+    if (eol_typeinfo_is_pointer (target.typeinfo) ||
+        eol_typeinfo_is_bool (target.typeinfo))
+        return luaL_error (L, "fetch_add needs an integer value");
+
+    /* Two's complement addition is the same for signed and unsigned. */
+    const lua_Integer delta = luaL_checkinteger (L, operand);
+    EolAtomicValue value = { .u8 = 0 };
+    switch (target.size) {
+#define ATOMIC_FETCH_ADD_CASE(nbytes, ctype)                                 \
+        case nbytes:                                                         \
+            value.u ## nbytes = __atomic_fetch_add ((ctype*) target.address, \
+                                                     (ctype) delta,          \
+                                                     __ATOMIC_SEQ_CST);      \
+            break;
+        ATOMIC_SIZES (ATOMIC_FETCH_ADD_CASE)
+#undef ATOMIC_FETCH_ADD_CASE
+    }
+    return (*target.ops->push) (L, target.typeinfo, &value,
+                                VARIABLE_PUSH_COPY);
+}
+
+
+static int
+atomic_compare_exchange (lua_State *L)
+{
+    EolAtomicTarget target;
+    int operand = atomic_target (L, &target, true);
+
+    EolAtomicValue expected, desired;
+    atomic_operand (L, operand, &target, &expected);
+    atomic_operand (L, operand + 1, &target, &desired);
+
+    bool exchanged = false;
+    switch (target.size) {
+#define ATOMIC_CAS_CASE(nbytes, ctype)                                        \
+        case nbytes:                                                          \
+            exchanged = __atomic_compare_exchange_n ((ctype*) target.address, \
+                                                     &expected.u ## nbytes,   \
+                                                     desired.u ## nbytes,     \
+                                                     false,                   \
+                                                     __ATOMIC_SEQ_CST,        \
+                                                     __ATOMIC_SEQ_CST);       \
+            break;
+        ATOMIC_SIZES (ATOMIC_CAS_CASE)
+#undef ATOMIC_CAS_CASE
+    }
+
+    /* On failure, "expected" contains the current value. */
+    lua_pushboolean (L, exchanged);
+    (*target.ops->push) (L, target.typeinfo, &expected, VARIABLE_PUSH_COPY);
+    return 2;
+}
+
+
+static const luaL_Reg atomic_functions[] = {
+    { "atomic_load",      atomic_load             },
+    { "atomic_store",     atomic_store            },
+    { "fetch_add",        atomic_fetch_add        },
+    { "compare_exchange", atomic_compare_exchange },
+    { NULL, NULL },
+};
+
+
+static int
+variable_index_scalar (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    const EolSpecial *s = variable_lookup_special (L, 2);
+    if (s) return variable_index_special (L, V, s);
+    if (push_named_function (L, 2, atomic_functions))
+        return 1;
+    return luaL_error (L, "not indexable");
+}
+
+
+static int
+variable_index_array (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    if (!lua_isinteger (L, 2)) {
+        const EolSpecial *s = variable_lookup_special (L, 2);
+        if (s) return variable_index_special (L, V, s);
+
+        if (push_named_function (L, 2, array_functions) ||
+            push_named_function (L, 2, view_functions) ||
+            push_named_function (L, 2, atomic_functions))
+            return 1;
+    }
+
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+    L_BOUNDS_CHECK (index, 2, eol_typeinfo_array_n_items (T));
+    T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
+    return cvalue_push_element (L, 1, T,
+                                ADDR_OFF (void, V->address,
+                                          index * eol_typeinfo_sizeof (T)),
+                                eol_typeinfo_is_readonly (V->typeinfo));
+}
+
+
+static inline int
+variable_index_compound (lua_State *L, bool is_struct)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+
+    const EolTypeInfoMember *member = NULL;
+    if (lua_isinteger (L, 2)) {
+        L_BOUNDS_CHECK (index, 2, eol_typeinfo_compound_n_members (T));
+        member = eol_typeinfo_compound_const_member (T, index);
+    } else {
+        const EolSpecial *s = variable_lookup_special (L, 2);
+        if (s) return variable_index_special (L, V, s);
+
+        const char *named_field = luaL_checkstring (L, 2);
+        if (!(member = eol_typeinfo_compound_const_named_member (T, named_field))) {
+            /* Members take precedence over methods. */
+            if (push_named_function (L, 2, atomic_functions))
+                return 1;
+            typeinfo_push_stringrep (L, T, true);
+            return luaL_error (L, "%s: no such member in type '%s'",
+                               named_field, lua_tostring (L, -1));
+        }
+    }
+
+    CHECK_NOT_NULL (member);
+    return cvalue_push_element (L, 1, member->typeinfo,
+                                is_struct
+                                    ? ADDR_OFF (void, V->address, member->offset)
+                                    : V->address,
+                                eol_typeinfo_is_readonly (V->typeinfo) ||
+                                eol_typeinfo_is_readonly (member->typeinfo));
+}
+
+static int
+variable_index_struct (lua_State *L)
+{
+    return variable_index_compound (L, true);
+}
+
+static int
+variable_index_union (lua_State *L)
+{
+    return variable_index_compound (L, false);
+}
+
+
+static void
+l_typecheck (lua_State         *L,
+             int                idx,
+             const EolTypeInfo *dst,
+             const EolTypeInfo *src)
+{
+    CHECK_NOT_NULL (dst);
+    CHECK_NOT_NULL (src);
+
+    if (!eol_typeinfo_equal (dst, src)) {
+        typeinfo_push_stringrep (L, dst, false);
+        typeinfo_push_stringrep (L, src, false);
+        luaL_error (L, "#%d: expected value of type '%s', given '%s'",
+                    (idx < 1) ? (lua_gettop (L) + idx) : idx,
+                    lua_tostring (L, -2), lua_tostring (L, -1));
+    }
+}
+
+
+#define FLOAT_FROM_LUA(suffix, name, ctype)                   \
+    static int                                                \
+    cvalue_get_ ## name (lua_State         *L,                \
+                         int                lindex,           \
+                         const EolTypeInfo *typeinfo,         \
+                         void              *address)          \
+    {                                                         \
+        *ADDR_OFF (ctype, address, 0) =                       \
+            (ctype) luaL_checknumber (L, lindex);             \
+        return 1;                                             \
+    }
+
+#define INTEGER_FROM_LUA(suffix, name, ctype)                 \
+    static int                                                \
+    cvalue_get_ ## name (lua_State         *L,                \
+                         int                lindex,           \
+                         const EolTypeInfo *typeinfo,         \
+                         void              *address)          \
+    {                                                         \
+        *ADDR_OFF (ctype, address, 0) =                       \
+            (ctype) luaL_checkinteger (L, lindex);            \
+        return 1;                                             \
+    }
+
+INTEGER_TYPES (INTEGER_FROM_LUA)
+FLOAT_TYPES (FLOAT_FROM_LUA)
+
+#undef INTEGER_FROM_LUA
+#undef FLOAT_FROM_LUA
+
+
+static int
+cvalue_get_bool (lua_State         *L,
+                 int                lindex,
+                 const EolTypeInfo *typeinfo,
+                 void              *address)
+{
+    *ADDR_OFF (bool, address, 0) = lua_toboolean (L, lindex);
+    return 1;
+}
+
+static int
+cvalue_get_pointer (lua_State         *L,
+                    int                lindex,
+                    const EolTypeInfo *typeinfo,
+                    void              *address)
+{
+    EolVariable *ev = to_eol_variable (L, lindex);
+    l_typecheck (L, lindex - 1, typeinfo,
+                 eol_typeinfo_get_non_synthetic (ev->typeinfo));
+    *ADDR_OFF (void*, address, 0) = ev->address;
+    return 1;
+}
+
+static int
+cvalue_get_cstring (lua_State         *L,
+                    int                lindex,
+                    const EolTypeInfo *typeinfo,
+                    void              *address)
+{
+    if (lua_type (L, lindex) == LUA_TSTRING) {
+        *ADDR_OFF (const char*, address, 0) = lua_tostring (L, lindex);
+        return 1;
+    }
+    return cvalue_get_pointer (L, lindex, typeinfo, address);
+}
+
+static int
+cvalue_get_struct (lua_State         *L,
+                   int                lindex,
+                   const EolTypeInfo *typeinfo,
+                   void              *address)
+{
+    EolVariable *ev = to_eol_variable (L, lindex);
+    l_typecheck (L, lindex - 1, typeinfo,
+                 eol_typeinfo_get_non_synthetic (ev->typeinfo));
+    CHECK_SIZE_EQ (eol_typeinfo_sizeof (typeinfo),
+                   eol_typeinfo_sizeof (ev->typeinfo));
+    memcpy (ADDR_OFF (void, address, 0),
+            ADDR_OFF (void, ev->address, 0),
+            eol_typeinfo_sizeof (typeinfo));
+    return 1;
+}
+
+static int
+cvalue_get_unsupported (lua_State         *L,
+                        int                lindex,
+                        const EolTypeInfo *typeinfo,
+                        void              *address)
+{
+    typeinfo_push_stringrep (L, typeinfo, true);
+    return luaL_error (L, "unsupported type: %s", lua_tostring (L, -1));
+}
+
+
+static inline int
+cvalue_get (lua_State         *L,
+            int                lindex,
+            const EolTypeInfo *typeinfo,
+            void              *address)
+{
+    CHECK_NOT_ZERO (address);
+    typeinfo = eol_typeinfo_get_non_synthetic (typeinfo);
+    return (*cvalue_ops (typeinfo)->get) (L, lindex, typeinfo, address);
+}
+
+
+#define CVALUE_OPS_ITEM(suffix, name, ctype)        \
+    static const CValueOps cvalue_ops_ ## name = {  \
+        cvalue_push_ ## name, cvalue_get_ ## name,  \
+    };
+
+INTEGER_TYPES (CVALUE_OPS_ITEM)
+FLOAT_TYPES (CVALUE_OPS_ITEM)
+CVALUE_OPS_ITEM (BOOL, bool, bool)
+
+#undef CVALUE_OPS_ITEM
+
+/* Enums can be read, but not written. */
+#define CVALUE_OPS_ENUM_ITEM(suffix, name, ctype)        \
+    static const CValueOps cvalue_ops_enum_ ## name = {  \
+        cvalue_push_ ## name, cvalue_get_unsupported,    \
+    };
+
+INTEGER_S_TYPES (CVALUE_OPS_ENUM_ITEM)
+
+#undef CVALUE_OPS_ENUM_ITEM
+
+static const CValueOps cvalue_ops_enum_unsupported = {
+    cvalue_push_enum_unsupported, cvalue_get_unsupported,
+};
+static const CValueOps cvalue_ops_pointer = {
+    cvalue_push_pointer, cvalue_get_pointer,
+};
+static const CValueOps cvalue_ops_cstring = {
+    cvalue_push_pointer, cvalue_get_cstring,
+};
+static const CValueOps cvalue_ops_struct = {
+    cvalue_push_compound, cvalue_get_struct,
+};
+static const CValueOps cvalue_ops_compound = {
+    cvalue_push_compound, cvalue_get_unsupported,
+};
+static const CValueOps cvalue_ops_void = {
+    cvalue_push_void, cvalue_get_unsupported,
+};
+static const CValueOps cvalue_ops_unsupported = {
+    cvalue_push_unsupported, cvalue_get_unsupported,
+};
+
+
+static const CValueOps*
+cvalue_ops_choose (const EolTypeInfo *typeinfo)
+{
+#define CVALUE_OPS_CASE(suffix, name, ctype) \
+        case EOL_TYPE_ ## suffix: return &cvalue_ops_ ## name;
+
+    switch (eol_typeinfo_type (typeinfo)) {
+        INTEGER_TYPES (CVALUE_OPS_CASE)
+        FLOAT_TYPES (CVALUE_OPS_CASE)
+        CVALUE_OPS_CASE (BOOL, bool, bool)
+
+        case EOL_TYPE_ENUM:
+            switch (eol_typeinfo_sizeof (typeinfo)) {
+                case 1: return &cvalue_ops_enum_s8;
+                case 2: return &cvalue_ops_enum_s16;
+                case 4: return &cvalue_ops_enum_s32;
+                case 8: return &cvalue_ops_enum_s64;
+                default: return &cvalue_ops_enum_unsupported;
+            }
+
+        case EOL_TYPE_POINTER:
+            return eol_typeinfo_is_cstring (typeinfo)
+                ? &cvalue_ops_cstring : &cvalue_ops_pointer;
+
+        case EOL_TYPE_STRUCT:
+            return &cvalue_ops_struct;
+
+        case EOL_TYPE_UNION:
+        case EOL_TYPE_ARRAY:
+            return &cvalue_ops_compound;
+
+        case EOL_TYPE_VOID:
+            return &cvalue_ops_void;
+
+        default:
+            return &cvalue_ops_unsupported;
+    }
+
+#undef CVALUE_OPS_CASE
+}
+
+
+static const CValueOps*
+cvalue_ops (const EolTypeInfo *typeinfo)
+{
+    const CValueOps *ops = eol_typeinfo_get_ops (typeinfo);
+    if (!ops) {
+        ops = cvalue_ops_choose (typeinfo);
+        eol_typeinfo_set_ops (typeinfo, ops);
+    }
+    return ops;
+}
+
+
+static inline int
+variable_newindex_special (lua_State        *L,
+                           int               lindex,
+                           EolVariable      *V,
+                           const EolSpecial *S)
+{
+    CHECK_NOT_NULL (L);
+    CHECK_NOT_NULL (V);
+
+    switch (S->code) {
+        case EOL_SPECIAL_VALUE:
+            return cvalue_get (L, lindex, V->typeinfo, V->address);
+        case EOL_SPECIAL_NAME:
+        case EOL_SPECIAL_TYPE:
+        case EOL_SPECIAL_LIBRARY:
+            return luaL_error (L, "field '__%s' is read-only", S->name);
+        default:
+            return luaL_error (L, "invalid field '__%s'", S->name);
+    }
+}
+
+
+static inline void
+variable_check_writable (lua_State *L, EolVariable *V)
+{
+    if (eol_typeinfo_is_readonly (V->typeinfo)) {
+        luaL_error (L, "read-only variable (%p:%s)",
+                    SYMBOL_LIBRARY (V), SYMBOL_NAME (V));
+    }
+}
+
+
+static int
+variable_newindex_scalar (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    variable_check_writable (L, V);
+
+    const EolSpecial *s = variable_lookup_special (L, 2);
+    if (s) return variable_newindex_special (L, 3, V, s);
+    return luaL_error (L, "not indexable");
+}
+
+
+static int
+variable_newindex_array (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    variable_check_writable (L, V);
+
+    if (!lua_isinteger (L, 2)) {
+        const EolSpecial *s = variable_lookup_special (L, 2);
+        if (s) return variable_newindex_special (L, 3, V, s);
+    }
+
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+    L_BOUNDS_CHECK (index, 2, eol_typeinfo_array_n_items (T));
+    T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
+    return cvalue_get (L, 3, T,
+                       ADDR_OFF (void, V->address,
+                                 index * eol_typeinfo_sizeof (T)));
+}
+
+
+static int
+variable_newindex_struct (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    variable_check_writable (L, V);
+
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (V->typeinfo);
+    const EolTypeInfoMember *member;
+    if (lua_isinteger (L, 2)) {
+        L_BOUNDS_CHECK (index, 2, eol_typeinfo_compound_n_members (T));
+        member = eol_typeinfo_compound_const_member (T, index);
+    } else {
+        const EolSpecial *s = variable_lookup_special (L, 2);
+        if (s) return variable_newindex_special (L, 3, V, s);
+
+        const char *name = luaL_checkstring (L, 2);
+        member = eol_typeinfo_compound_const_named_member (T, name);
+        if (!member) {
+            return luaL_error (L, "%s: no such struct member", name);
+        }
+    }
+    return cvalue_get (L, 3, member->typeinfo,
+                       ADDR_OFF (void, V->address, member->offset));
+}
+
+
+static const luaL_Reg variable_methods[] = {
+    { "__gc",       variable_gc       },
+    { "__tostring", variable_tostring },
+    { "__len",      variable_len      },
+    { NULL, NULL },
+};
+
+/*
+ * Union members cannot be assigned, so unions use the same __newindex
+ * as scalar values, which only allows setting "__value".
+ */
+static const struct {
+    const char    *name;
+    lua_CFunction  index;
+    lua_CFunction  newindex;
+} variable_kinds[] = {
+    { EOL_VARIABLE_SCALAR, variable_index_scalar, variable_newindex_scalar },
+    { EOL_VARIABLE_ARRAY,  variable_index_array,  variable_newindex_array  },
+    { EOL_VARIABLE_STRUCT, variable_index_struct, variable_newindex_struct },
+    { EOL_VARIABLE_UNION,  variable_index_union,  variable_newindex_scalar },
+};
+
+
+/*
+ * Plans used by eol.pack() and eol.unpack() to convert between Lua tables
+ * and structs. They are computed once for each struct (or union) type,
+ * and stored in a registry table keyed by the EolTypeInfo pointer. The
+ * member names are kept as Lua strings in the user value of the plan, so
+ * looking up fields in tables does not need to create strings.
+ */
+static const char EOL_PACK_PLANS[] = "org.perezdecastro.eol.PackPlans";
+
+typedef struct {
+    uint32_t           offset;
+    const EolTypeInfo *typeinfo;  /* Non-synthetic. */
+    const CValueOps   *ops;
+} EolPackField;
+
+typedef struct {
+    uint32_t     n_fields;
+    EolPackField fields[];
+} EolPackPlan;
+
+
+/* Pushes the plan, and then the table with the field names. */
+static const EolPackPlan*
+pack_plan_push (lua_State *L, const EolTypeInfo *typeinfo)
+{
+    lua_rawgetp (L, LUA_REGISTRYINDEX, EOL_PACK_PLANS);
+    if (lua_rawgetp (L, -1, typeinfo) == LUA_TUSERDATA) {
+        lua_remove (L, -2);
+        lua_getuservalue (L, -1);
+        return lua_touserdata (L, -2);
+    }
+    lua_pop (L, 1);
+
+    const uint32_t n_fields = eol_typeinfo_compound_n_members (typeinfo);
+    EolPackPlan *plan = lua_newuserdata (L, sizeof (EolPackPlan) +
+                                         n_fields * sizeof (EolPackField));
+    plan->n_fields = n_fields;
+    lua_createtable (L, n_fields, 0);
+
+    const bool is_struct = eol_typeinfo_is_struct (typeinfo);
+    for (uint32_t i = 0; i < n_fields; i++) {
+        const EolTypeInfoMember *member =
+                eol_typeinfo_compound_const_member (typeinfo, i);
+        EolPackField *field = &plan->fields[i];
+        field->offset   = is_struct ? member->offset : 0;
+        field->typeinfo = eol_typeinfo_get_non_synthetic (member->typeinfo);
+        field->ops      = cvalue_ops (field->typeinfo);
+        lua_pushstring (L, member->name);
+        lua_rawseti (L, -2, i + 1);
+    }
+    lua_pushvalue (L, -1);
+    lua_setuservalue (L, -3);               /* plans plan names */
+
+    lua_pushvalue (L, -2);
+    lua_rawsetp (L, -4, typeinfo);          /* plans plan names */
+    lua_remove (L, -3);                     /* plan names */
+    return plan;
+}
+
+
+static void pack_value (lua_State         *L,
+                        int                index,
+                        const EolTypeInfo *typeinfo,
+                        void              *address);
+
+static void
+pack_record (lua_State         *L,
+             int                index,
+             const EolTypeInfo *typeinfo,
+             void              *address)
+{
+    luaL_checkstack (L, 4, NULL);
+    const EolPackPlan *plan = pack_plan_push (L, typeinfo);
+    const int names = lua_gettop (L);
+
+    for (uint32_t i = 0; i < plan->n_fields; i++) {
+        const EolPackField *field = &plan->fields[i];
+        lua_rawgeti (L, names, i + 1);
+        if (lua_gettable (L, index) != LUA_TNIL) {
+            pack_value (L, lua_gettop (L), field->typeinfo,
+                        ADDR_OFF (void, address, field->offset));
+        }
+        lua_pop (L, 1);
+    }
+    lua_pop (L, 2);
+}
+
+
+/* Missing (nil) fields and array items are left untouched. */
+static void
+pack_value (lua_State         *L,
+            int                index,
+            const EolTypeInfo *typeinfo,
+            void              *address)
+{
+    if (lua_type (L, index) == LUA_TTABLE) {
+        if (eol_typeinfo_is_struct (typeinfo) ||
+            eol_typeinfo_is_union (typeinfo)) {
+            pack_record (L, index, typeinfo, address);
+            return;
+        }
+        if (eol_typeinfo_is_array (typeinfo)) {
+            const EolTypeInfo *base =
+                    eol_typeinfo_get_non_synthetic (eol_typeinfo_base (typeinfo));
+            const uint32_t stride = eol_typeinfo_sizeof (base);
+            const uint64_t n_items = eol_typeinfo_array_n_items (typeinfo);
+            const size_t length = lua_rawlen (L, index);
+            if (length > n_items) {
+                luaL_error (L, "too many items (%d) for array of length %d",
+                            (int) length, (int) n_items);
+            }
+            luaL_checkstack (L, 1, NULL);
+            for (size_t i = 0; i < length; i++) {
+                if (lua_rawgeti (L, index, i + 1) != LUA_TNIL) {
+                    pack_value (L, lua_gettop (L), base,
+                                ADDR_OFF (void, address, i * stride));
+                }
+                lua_pop (L, 1);
+            }
+            return;
+        }
+    }
+    (*cvalue_ops (typeinfo)->get) (L, index, typeinfo, address);
+}
+
+
+/*
+ * Usage: array = eol.pack(type, { record, ... } [, destination])
+ *
+ * Converts a list of Lua values (tables for structs) into a C array of
+ * "type", which is created unless a destination array (or view) is given.
+ */
+static int
+eol_pack (lua_State *L)
+{
+    const EolTypeInfo *typeinfo =
+            eol_typeinfo_get_non_synthetic (to_eol_typeinfo (L, 1));
+    luaL_checktype (L, 2, LUA_TTABLE);
+    const size_t length = lua_rawlen (L, 2);
+
+    EolView dst;
+    if (lua_isnoneornil (L, 3)) {
+        lua_settop (L, 2);
+        variable_push_new (L, eol_type_cache_derived (EOL_TYPE_ARRAY,
+                                                      typeinfo, length));
+        view_from_value (L, 3, &dst);
+    } else {
+        lua_settop (L, 3);
+        view_from_value (L, 3, &dst);
+        if (dst.readonly)
+            return luaL_error (L, "destination is read-only");
+        if (dst.typeinfo != typeinfo &&
+            !eol_typeinfo_equal (dst.typeinfo, typeinfo)) {
+            typeinfo_push_stringrep (L, typeinfo, false);
+            typeinfo_push_stringrep (L, dst.typeinfo, false);
+            return luaL_error (L, "cannot pack '%s' into array of '%s'",
+                               lua_tostring (L, -2), lua_tostring (L, -1));
+        }
+        if (dst.n_items < length) {
+            return luaL_error (L, "destination too small (%d < %d)",
+                               (int) dst.n_items, (int) length);
+        }
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (lua_rawgeti (L, 2, i + 1) != LUA_TNIL) {
+            pack_value (L, 4, dst.typeinfo,
+                        ADDR_OFF (void, dst.address, i * dst.stride));
+        }
+        lua_pop (L, 1);
+    }
+
+    lua_settop (L, 3);
+    return 1;
+}
+
+
+static void
+unpack_value (lua_State         *L,
+              const EolTypeInfo *typeinfo,
+              void              *address)
+{
+    luaL_checkstack (L, 4, NULL);
+
+    if (eol_typeinfo_is_struct (typeinfo) || eol_typeinfo_is_union (typeinfo)) {
+        const EolPackPlan *plan = pack_plan_push (L, typeinfo);
+        lua_createtable (L, 0, plan->n_fields);    /* plan names record */
+        for (uint32_t i = 0; i < plan->n_fields; i++) {
+            const EolPackField *field = &plan->fields[i];
+            if (lua_rawgeti (L, -2, i + 1) == LUA_TNIL) {
+                lua_pop (L, 1);  /* Anonymous member. */
+                continue;
+            }
+            unpack_value (L, field->typeinfo,
+                          ADDR_OFF (void, address, field->offset));
+            lua_rawset (L, -3);
+        }
+        lua_replace (L, -3);
+        lua_pop (L, 1);
+    } else if (eol_typeinfo_is_array (typeinfo)) {
+        const EolTypeInfo *base =
+                eol_typeinfo_get_non_synthetic (eol_typeinfo_base (typeinfo));
+        const uint32_t stride = eol_typeinfo_sizeof (base);
+        const uint64_t n_items = eol_typeinfo_array_n_items (typeinfo);
+        lua_createtable (L, n_items, 0);
+        for (uint64_t i = 0; i < n_items; i++) {
+            unpack_value (L, base, ADDR_OFF (void, address, i * stride));
+            lua_rawseti (L, -2, i + 1);
+        }
+    } else if (!(*cvalue_ops (typeinfo)->push) (L, typeinfo, address,
+                                                 VARIABLE_PUSH_NOCOPY)) {
+        lua_pushnil (L);
+    }
+}
+
+
+/*
+ * Usage: list = eol.unpack(array_or_view)
+ *        record = eol.unpack(struct_variable)
+ *
+ * Inverse of eol.pack(): converts C arrays and structs into Lua tables,
+ * recursively. Other values (e.g. pointers) are converted as usual.
+ */
+static int
+eol_unpack (lua_State *L)
+{
+    EolView view;
+    EolVariable *ev = test_eol_variable (L, 1);
+    if (ev && !eol_typeinfo_is_array (ev->typeinfo)) {
+        unpack_value (L, eol_typeinfo_get_non_synthetic (ev->typeinfo),
+                      ev->address);
+        return 1;
+    }
+
+    view_from_value (L, 1, &view);
+    lua_createtable (L, view.n_items, 0);
+    for (uint32_t i = 0; i < view.n_items; i++) {
+        unpack_value (L, view.typeinfo,
+                      ADDR_OFF (void, view.address, (size_t) i * view.stride));
+        lua_rawseti (L, -2, i + 1);
+    }
+    return 1;
+}
+
+
+/*
+ * Memory mappings created by eol.mmap() and eol.shm(), and memory allocated
+ * outside of the Lua heap by eol.alloc(). The mapping is stored right after
+ * the EolVariable in the same userdata. These variables have their own
+ * metatables, which add methods to those of the kind of their type, and
+ * release the memory when the variable is collected: mapped variables have
+ * :sync(), :advise() and :close(), allocated variables have :free().
+ */
+static const char EOL_VARIABLE_MAPPED[]    = "org.perezdecastro.eol.Variable.Mapped";
+static const char EOL_VARIABLE_ALLOCATED[] = "org.perezdecastro.eol.Variable.Allocated";
+
+typedef struct {
+    void  *base;
+    size_t length;
+    bool   shared;  /* Changes are written back to the file. */
+    bool   heap;    /* Allocated with posix_memalign(), not mmap(). */
+} EolMapping;
+
+/* Size of huge pages used by eol.alloc(), the default on most systems. */
+#define EOL_HUGEPAGE_SIZE ((size_t) 2 * 1024 * 1024)
+
+/*
+ * Sizes of types are 32-bit, so arrays whose size does not fit cannot be
+ * represented: their size would wrap around, and so would bulk operations
+ * and bounds checks done with it.
+ */
+static inline bool
+array_size_fits (size_t size, uint64_t n_items)
+{
+    return size && n_items <= UINT32_MAX / size;
+}
+
+static const char *const mapping_advice_names[] = {
+    "normal", "sequential", "random", "willneed", "dontneed", NULL,
+};
+static const int mapping_advice[] = {
+    MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED,
+};
+
+
+static inline EolMapping*
+to_eol_mapping (lua_State *L, int index)
+{
+    EolVariable *ev = luaL_testudata (L, index, EOL_VARIABLE_MAPPED);
+    if (!ev)
+        ev = luaL_checkudata (L, index, EOL_VARIABLE_ALLOCATED);
+    return (EolMapping*) &ev[1];
+}
+
+
+/*
+ * Creates the userdata for a mapping before the memory is mapped, so the
+ * mapping is not leaked if allocating the userdata raises an error.
+ */
+static EolVariable*
+mapping_push_userdata (lua_State *L, const char *meta, bool shared)
+{
+    EolVariable *ev = lua_newuserdata (L, sizeof (EolVariable) +
+                                          sizeof (EolMapping));
+    EolMapping *em = (EolMapping*) &ev[1];
+    /* Not mapped yet: symbol_init() does not allow a NULL address. */
+    memset (ev, 0x00, sizeof (EolVariable));
+    em->base   = NULL;
+    em->length = 0;
+    em->shared = shared;
+    em->heap   = false;
+    luaL_setmetatable (L, meta);
+    return ev;
+}
+
+
+/*
+ * Maps "n_items" elements (a single value when zero) of "fd", and closes
+ * it. The type of read-only mappings is made const, which is propagated
+ * to their elements and members, so writes fail before faulting.
+ */
+static void
+mapping_map (lua_State         *L,
+             EolVariable       *ev,
+             int                fd,
+             const char        *path,
+             const EolTypeInfo *typeinfo,
+             uint64_t           n_items,
+             bool               readonly)
+{
+    EolMapping *em = (EolMapping*) &ev[1];
+    em->length = (n_items ? n_items : 1) * eol_typeinfo_sizeof (typeinfo);
+    /*
+     * Read-only mappings are shared, so they see changes made by others,
+     * and stray writes fault instead of going to private copies.
+     */
+    em->base = readonly
+        ? mmap (NULL, em->length, PROT_READ, MAP_SHARED, fd, 0)
+        : mmap (NULL, em->length, PROT_READ | PROT_WRITE,
+                em->shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    int saved_errno = errno;
+    close (fd);
+    if (em->base == MAP_FAILED) {
+        em->base = NULL;
+        luaL_error (L, "could not map '%s' (%s)", path, strerror (saved_errno));
+    }
+
+    if (readonly)
+        typeinfo = eol_type_cache_derived (EOL_TYPE_CONST, typeinfo, 0);
+    if (n_items > 0)
+        typeinfo = eol_type_cache_derived (EOL_TYPE_ARRAY, typeinfo, n_items);
+    ev->address  = em->base;
+    ev->typeinfo = typeinfo;
+    TRACE_PTR (>, EolVariable, ev, " [%s]\n", path);
+}
+
+
+static inline void
+mapping_release (EolMapping *em)
+{
+    if (em->heap)
+        free (em->base);
+    else if (em->base)
+        munmap (em->base, em->length);
+    em->base = NULL;
+}
+
+
+/*
+ * Turns a variable into an empty array, so further accesses fail the
+ * bounds checks.
+ */
+static void
+variable_clear (EolVariable *ev)
+{
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (ev->typeinfo);
+    if (eol_typeinfo_is_array (T))
+        T = eol_typeinfo_base (T);
+    ev->address  = NULL;
+    ev->typeinfo = eol_type_cache_derived (EOL_TYPE_ARRAY, T, 0);
+}
+
+
+/*
+ * Variables and views which point into the memory of a mapping are its
+ * "dependents". They keep the mapping alive (as the "owner" in the user
+ * value of variables, views already keep their source), and are recorded
+ * as keys of a table with weak keys, in the "dependents" field of the user
+ * value of the mapping. When the mapping is closed they are emptied, so
+ * using them fails instead of accessing memory which is gone.
+ */
+static int
+mapping_push_owner (lua_State *L, int index)
+{
+    index = lua_absindex (L, index);
+    if (luaL_testudata (L, index, EOL_VIEW)) {
+        lua_getuservalue (L, index);
+        const int type = mapping_push_owner (L, -1);
+        lua_remove (L, -2);
+        return type;
+    }
+    if (luaL_testudata (L, index, EOL_VARIABLE_MAPPED) ||
+        luaL_testudata (L, index, EOL_VARIABLE_ALLOCATED)) {
+        lua_pushvalue (L, index);
+        return LUA_TUSERDATA;
+    }
+    if (!test_eol_variable (L, index)) {
+        lua_pushnil (L);
+        return LUA_TNIL;
+    }
+    /* The owner may also be an arena, which cannot be closed. */
+    if (variable_uservalue_get (L, index, "owner") == LUA_TUSERDATA &&
+        (luaL_testudata (L, -1, EOL_VARIABLE_MAPPED) ||
+         luaL_testudata (L, -1, EOL_VARIABLE_ALLOCATED)))
+        return LUA_TUSERDATA;
+    lua_pop (L, 1);
+    lua_pushnil (L);
+    return LUA_TNIL;
+}
+
+
+/*
+ * Makes the variable or view at "index" a dependent of the mapping which
+ * holds the memory of the value at "container", if any.
+ */
+static void
+mapping_add_dependent (lua_State *L, int container, int index)
+{
+    index = lua_absindex (L, index);
+    if (mapping_push_owner (L, container) != LUA_TUSERDATA) {
+        lua_pop (L, 1);
+        return;
+    }                                                 /* owner */
+
+    if (variable_uservalue_get (L, -1, "dependents") != LUA_TTABLE) {
+        lua_pop (L, 1);
+        lua_createtable (L, 0, 1);
+        lua_createtable (L, 0, 1);
+        lua_pushliteral (L, "k");
+        lua_setfield (L, -2, "__mode");
+        lua_setmetatable (L, -2);
+        lua_pushvalue (L, -1);
+        variable_uservalue_set (L, -3, "dependents");
+    }                                                 /* owner dependents */
+    lua_pushvalue (L, index);
+    lua_pushboolean (L, true);
+    lua_rawset (L, -3);
+    lua_pop (L, 1);                                   /* owner */
+
+    if (test_eol_variable (L, index))
+        variable_uservalue_set (L, index, "owner");
+    else
+        lua_pop (L, 1);
+}
+
+
+/* Empties the dependents of the mapping at "index". */
+static void
+mapping_clear_dependents (lua_State *L, int index)
+{
+    if (variable_uservalue_get (L, index, "dependents") != LUA_TTABLE) {
+        lua_pop (L, 1);
+        return;
+    }
+    const bool cached = lua_rawgetp (L, LUA_REGISTRYINDEX,
+                                     EOL_WRAPPER_CACHE) == LUA_TTABLE;
+
+    lua_pushnil (L);                                  /* deps cache nil */
+    while (lua_next (L, -3)) {                        /* deps cache dep true */
+        lua_pop (L, 1);                               /* deps cache dep */
+
+        EolView *ew = luaL_testudata (L, -1, EOL_VIEW);
+        if (ew) {
+            ew->address = NULL;
+            ew->n_items = 0;
+            continue;
+        }
+
+        /*
+         * Keys of weak tables are removed only after their finalizer runs,
+         * and setting the metatable of a finalized variable below would
+         * make its finalizer run again.
+         */
+        EolVariable *ev = test_eol_variable (L, -1);
+        if (!ev || !ev->typeinfo || !ev->address)
+            continue;
+
+        /* Wrappers must not be reused for new values at the same address. */
+        if (cached) {
+            const void *key[2] = { ev->address, ev->typeinfo };
+            lua_pushlstring (L, (const char*) key, sizeof (key));
+            lua_pushvalue (L, -1);                    /* deps cache dep key key */
+            if (lua_rawget (L, -4) == LUA_TUSERDATA &&
+                lua_rawequal (L, -1, -3)) {
+                lua_pop (L, 1);                       /* deps cache dep key */
+                lua_pushnil (L);
+                lua_rawset (L, -4);                   /* deps cache dep */
+            } else {
+                lua_pop (L, 2);                       /* deps cache dep */
+            }
+        }
+
+        variable_clear (ev);
+        variable_set_metatable (L, ev->typeinfo);
+    }
+    lua_pop (L, 2);
+}
+
+
+static void
+mapping_unmap (EolVariable *ev, EolMapping *em)
+{
+    if (em->base) {
+        mapping_release (em);
+        variable_clear (ev);
+    }
+}
+
+
+static inline EolMapping*
+mapping_check_open (lua_State *L, int index)
+{
+    EolMapping *em = to_eol_mapping (L, index);
+    if (!em->base)
+        luaL_error (L, "mapping is closed");
+    return em;
+}
+
+
+/*
+ * Usage: mapped:sync([async])
+ */
+static int
+mapping_sync (lua_State *L)
+{
+    EolMapping *em = mapping_check_open (L, 1);
+    if (em->shared &&
+        msync (em->base, em->length,
+               lua_toboolean (L, 2) ? MS_ASYNC : MS_SYNC) != 0) {
+        return luaL_error (L, "cannot sync mapping (%s)", strerror (errno));
+    }
+    return 0;
+}
+
+
+/*
+ * Usage: mapped:advise("normal" | "sequential" | "random" |
+ *                      "willneed" | "dontneed")
+ */
+static int
+mapping_advise (lua_State *L)
+{
+    EolMapping *em = mapping_check_open (L, 1);
+    int advice = mapping_advice[luaL_checkoption (L, 2, NULL,
+                                                  mapping_advice_names)];
+    if (madvise (em->base, em->length, advice) != 0)
+        return luaL_error (L, "cannot advise mapping (%s)", strerror (errno));
+    return 0;
+}
+
+
+/*
+ * Usage: mapped:close()
+ *
+ * Unmaps the memory (or frees it, when used as :free() for allocated
+ * variables). Elements, members, and views obtained from the variable
+ * become empty, and accessing them fails afterwards.
+ */
+static int
+mapping_close (lua_State *L)
+{
+    EolMapping *em = to_eol_mapping (L, 1);
+    if (em->base)
+        mapping_clear_dependents (L, 1);
+    mapping_unmap (lua_touserdata (L, 1), em);
+    return 0;
+}
+
+
+static const luaL_Reg mapping_functions[] = {
+    { "sync",   mapping_sync   },
+    { "advise", mapping_advise },
+    { "close",  mapping_close  },
+    { NULL, NULL },
+};
+
+
+static const luaL_Reg allocation_functions[] = {
+    { "free", mapping_close },
+    { NULL, NULL },
+};
+
+
+/* Dispatches to the __index handler for the kind of the variable type. */
+static int
+mapping_index_kind (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    switch (eol_typeinfo_type (eol_typeinfo_get_non_synthetic (V->typeinfo))) {
+        case EOL_TYPE_ARRAY:  return variable_index_array (L);
+        case EOL_TYPE_STRUCT: return variable_index_struct (L);
+        case EOL_TYPE_UNION:  return variable_index_union (L);
+        default:              return variable_index_scalar (L);
+    }
+}
+
+
+static int
+mapping_index (lua_State *L)
+{
+    if (!lua_isinteger (L, 2) && push_named_function (L, 2, mapping_functions))
+        return 1;
+    return mapping_index_kind (L);
+}
+
+
+static int
+allocation_index (lua_State *L)
+{
+    if (!lua_isinteger (L, 2) && push_named_function (L, 2, allocation_functions))
+        return 1;
+    return mapping_index_kind (L);
+}
+
+
+static int
+mapping_newindex (lua_State *L)
+{
+    EolVariable *V = to_eol_variable (L, 1);
+    switch (eol_typeinfo_type (eol_typeinfo_get_non_synthetic (V->typeinfo))) {
+        case EOL_TYPE_ARRAY:  return variable_newindex_array (L);
+        case EOL_TYPE_STRUCT: return variable_newindex_struct (L);
+        default:              return variable_newindex_scalar (L);
+    }
+}
+
+
+static int
+mapping_gc (lua_State *L)
+{
+    EolMapping *em = to_eol_mapping (L, 1);
+    /* Finalizers attached with eol.gc() still need the memory. */
+    variable_gc (L);
+    mapping_release (em);
+    return 0;
+}
+
+
+static const luaL_Reg mapping_methods[] = {
+    { "__index",    mapping_index    },
+    { "__newindex", mapping_newindex },
+    { "__gc",       mapping_gc       },
+    { NULL, NULL },
+};
+
+static const luaL_Reg allocation_methods[] = {
+    { "__index",    allocation_index },
+    { "__newindex", mapping_newindex },
+    { "__gc",       mapping_gc       },
+    { NULL, NULL },
+};
+
+
+/*
+ * Usage: array = eol.mmap(path, type [, mode [, advice]])
+ *
+ * Maps a file in memory as an array of elements of the given type, with as
+ * many elements as whole ones fit in the file. The mode can be "r" (the
+ * default) for a read-only mapping, "w" to write changes back to the file,
+ * or "c" for a private, writable copy-on-write mapping.
+ */
+static int
+eol_mmap (lua_State *L)
+{
+    static const char *const modes[] = { "r", "w", "c", NULL };
+
+    const char *path = luaL_checkstring (L, 1);
+    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 2);
+    const int mode = luaL_checkoption (L, 3, "r", modes);
+    const int advice = mapping_advice[luaL_checkoption (L, 4, "normal",
+                                                        mapping_advice_names)];
+
+    const size_t size = eol_typeinfo_sizeof (typeinfo);
+    if (size == 0) {
+        typeinfo_push_stringrep (L, typeinfo, false);
+        return luaL_error (L, "type '%s' has no size", lua_tostring (L, -1));
+    }
+
+    EolVariable *ev = mapping_push_userdata (L, EOL_VARIABLE_MAPPED, mode == 1);
+
+    int fd = open (path, (mode == 1 ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        return luaL_error (L, "could not open '%s' (%s)",
+                           path, strerror (errno));
+    }
+
+    struct stat sb;
+    if (fstat (fd, &sb) != 0) {
+        int saved_errno = errno;
+        close (fd);
+        return luaL_error (L, "could not stat '%s' (%s)",
+                           path, strerror (saved_errno));
+    }
+
+    const uint64_t n_items = (uint64_t) sb.st_size / size;
+    if (n_items == 0) {
+        close (fd);
+        typeinfo_push_stringrep (L, typeinfo, false);
+        return luaL_error (L, "'%s' does not fit a whole number of '%s' "
+                           "elements (size=%d)", path, lua_tostring (L, -1),
+                           (int) size);
+    }
+    if (!array_size_fits (size, n_items)) {
+        close (fd);
+        return luaL_error (L, "'%s' is too big to be mapped (size=%I)",
+                           path, (lua_Integer) sb.st_size);
+    }
+
+    mapping_map (L, ev, fd, path, typeinfo, n_items, mode == 0);
+    if (advice != MADV_NORMAL)
+        (void) madvise (ev->address, n_items * size, advice);
+    return 1;
+}
+
+
+/*
+ * Usage: var = eol.shm(name, type [, options])
+ *
+ * Maps a POSIX shared memory object as a value of the given type. Options:
+ *
+ *   create     Create the object if it does not exist (default: false).
+ *   exclusive  Fail if the object exists when creating (default: false).
+ *   readonly   Map the object without write access (default: false).
+ *   n          Map an array of "n" elements, instead of a single value.
+ *   perm       Permissions of created objects (default: 0600).
+ */
+static int
+eol_shm (lua_State *L)
+{
+    const char *name = luaL_checkstring (L, 1);
+    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 2);
+
+    bool create = false, exclusive = false, readonly = false;
+    lua_Integer n_items = 0, perm = 0600;
+    if (!lua_isnoneornil (L, 3)) {
+        luaL_checktype (L, 3, LUA_TTABLE);
+        lua_getfield (L, 3, "create");
+        lua_getfield (L, 3, "exclusive");
+        lua_getfield (L, 3, "readonly");
+        lua_getfield (L, 3, "n");
+        lua_getfield (L, 3, "perm");
+        create    = lua_toboolean (L, -5);
+        exclusive = lua_toboolean (L, -4);
+        readonly  = lua_toboolean (L, -3);
+        n_items   = luaL_optinteger (L, -2, 0);
+        perm      = luaL_optinteger (L, -1, 0600);
+        lua_pop (L, 5);
+    }
+
+    if (create && readonly)
+        return luaL_error (L, "cannot create a read-only shared object");
+
+    const size_t item_size = eol_typeinfo_sizeof (typeinfo);
+    if (item_size == 0) {
+        typeinfo_push_stringrep (L, typeinfo, false);
+        return luaL_error (L, "type '%s' has no size", lua_tostring (L, -1));
+    }
+    if (n_items < 0 || !array_size_fits (item_size, n_items))
+        return luaL_error (L, "option 'n' out of range");
+    const size_t size = item_size * (n_items ? n_items : 1);
+
+    EolVariable *ev = mapping_push_userdata (L, EOL_VARIABLE_MAPPED, !readonly);
+
+    int flags = readonly ? O_RDONLY : O_RDWR;
+    if (create) flags |= O_CREAT;
+    if (exclusive) flags |= O_EXCL;
+    int fd = shm_open (name, flags | O_CLOEXEC, (mode_t) perm);
+    if (fd < 0) {
+        return luaL_error (L, "could not open shared object '%s' (%s)",
+                           name, strerror (errno));
+    }
+
+    struct stat sb;
+    if (fstat (fd, &sb) != 0 ||
+        (create && (size_t) sb.st_size < size && ftruncate (fd, size) != 0)) {
+        int saved_errno = errno;
+        close (fd);
+        return luaL_error (L, "could not size shared object '%s' (%s)",
+                           name, strerror (saved_errno));
+    }
+    if (!create && (size_t) sb.st_size < size) {
+        close (fd);
+        return luaL_error (L, "shared object '%s' too small (%d < %d)",
+                           name, (int) sb.st_size, (int) size);
+    }
+
+    mapping_map (L, ev, fd, name, typeinfo, n_items, readonly);
+    return 1;
+}
+
+
+/*
+ * Usage: eol.shmunlink(name)
+ */
+static int
+eol_shmunlink (lua_State *L)
+{
+    const char *name = luaL_checkstring (L, 1);
+    if (shm_unlink (name) != 0) {
+        return luaL_error (L, "could not unlink shared object '%s' (%s)",
+                           name, strerror (errno));
+    }
+    return 0;
+}
+
+
+/*
+ * Usage: var = eol.alloc(type [, n [, options]])
+ *
+ * Allocates zero-filled memory for a value of a type (or an array of "n"
+ * elements, as in type(n)) outside of the Lua heap, so large buffers do not
+ * count towards the garbage collector debt. The memory is released when the
+ * variable is collected, or explicitly with var:free(). Options:
+ *
+ *   align      Alignment, a power of two (default: 2 * sizeof(void*)).
+ *   hugepages  Allocate huge pages with mmap() (default: false).
+ */
+static int
+eol_alloc (lua_State *L)
+{
+    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 1);
+    const bool is_array = !lua_isnoneornil (L, 2);
+    lua_Integer n_items = luaL_optinteger (L, 2, 1);
+
+    lua_Integer align = 2 * sizeof (void*);
+    bool hugepages = false;
+    if (!lua_isnoneornil (L, 3)) {
+        luaL_checktype (L, 3, LUA_TTABLE);
+        lua_getfield (L, 3, "align");
+        lua_getfield (L, 3, "hugepages");
+        align     = luaL_optinteger (L, -2, align);
+        hugepages = lua_toboolean (L, -1);
+        lua_pop (L, 2);
+    }
+    if (align < (lua_Integer) sizeof (void*) || (align & (align - 1)))
+        return luaL_error (L, "alignment must be a power of two >= %d",
+                           (int) sizeof (void*));
+
+    const size_t item_size = eol_typeinfo_sizeof (typeinfo);
+    if (item_size == 0) {
+        typeinfo_push_stringrep (L, typeinfo, false);
+        return luaL_error (L, "type '%s' has no size", lua_tostring (L, -1));
+    }
+    if (n_items < 1 || !array_size_fits (item_size, n_items))
+        return luaL_error (L, "argument #2 out of range");
+    const size_t size = item_size * n_items;
+
+    EolVariable *ev = mapping_push_userdata (L, EOL_VARIABLE_ALLOCATED, false);
+    EolMapping *em = (EolMapping*) &ev[1];
+
+    if (hugepages) {
+        if (align > EOL_HUGEPAGE_SIZE)
+            return luaL_error (L, "alignment too big for huge pages");
+        /*
+         * Try to get huge pages from the reserved pool first, and fall
+         * back to asking for transparent huge pages.
+         */
+        em->length = (size + EOL_HUGEPAGE_SIZE - 1) & ~(EOL_HUGEPAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        em->base = mmap (NULL, em->length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#else
+        em->base = MAP_FAILED;
+#endif
+        if (em->base == MAP_FAILED) {
+            void *base = mmap (NULL, em->length + EOL_HUGEPAGE_SIZE,
+                               PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                em->base = NULL;
+                return luaL_error (L, "cannot allocate %d bytes (%s)",
+                                   (int) em->length, strerror (errno));
+            }
+            /* Trim to a huge page boundary, so huge pages can be used. */
+            uintptr_t start = ((uintptr_t) base + EOL_HUGEPAGE_SIZE - 1) &
+                              ~((uintptr_t) EOL_HUGEPAGE_SIZE - 1);
+            size_t head = start - (uintptr_t) base;
+            if (head)
+                munmap (base, head);
+            munmap ((void*) (start + em->length), EOL_HUGEPAGE_SIZE - head);
+            em->base = (void*) start;
+#ifdef MADV_HUGEPAGE
+            (void) madvise (em->base, em->length, MADV_HUGEPAGE);
+#endif
+        }
+    } else {
+        int error = posix_memalign (&em->base, align, size);
+        if (error) {
+            em->base = NULL;
+            return luaL_error (L, "cannot allocate %d bytes (%s)",
+                               (int) size, strerror (error));
+        }
+        em->length = size;
+        em->heap   = true;
+        memset (em->base, 0x00, size);
+    }
+
+    if (is_array)
+        typeinfo = eol_type_cache_derived (EOL_TYPE_ARRAY, typeinfo, n_items);
+    ev->address  = em->base;
+    ev->typeinfo = typeinfo;
+    TRACE_PTR (>, EolVariable, ev, " (%d bytes)\n", (int) em->length);
+    return 1;
+}
+
+
+static const struct {
+    const char     *name;
+    const luaL_Reg *methods;
+} mapping_kinds[] = {
+    { EOL_VARIABLE_MAPPED,    mapping_methods    },
+    { EOL_VARIABLE_ALLOCATED, allocation_methods },
+};
+
+
+/*
+ * Arenas, created by eol.arena(), are bump allocators for temporary values.
+ * Memory is obtained from the C heap in chunks, and values are carved out
+ * of them until arena:reset() rewinds the arena, reusing the chunks. The
+ * chunks are freed when the arena is collected. Values created by an arena
+ * keep it alive, but they must not be used after resetting it.
+ */
+static const char EOL_ARENA[] = "org.perezdecastro.eol.Arena";
+
+/* Allocations are aligned like those made by malloc(). */
+#define EOL_ARENA_ALIGN      (2 * sizeof (void*))
+#define EOL_ARENA_CHUNK_SIZE ((size_t) 64 * 1024)
+
+typedef struct _EolArenaChunk EolArenaChunk;
+struct _EolArenaChunk {
+    EolArenaChunk *next;
+    size_t         size;
+    size_t         used;
+    uint8_t        data[] __attribute__ ((aligned (EOL_ARENA_ALIGN)));
+};
+
+typedef struct {
+    EolArenaChunk *first;
+    EolArenaChunk *current;
+    size_t         chunk_size;
+} EolArena;
+
+
+static inline EolArena*
+to_eol_arena (lua_State *L, int index)
+{
+    return (EolArena*) luaL_checkudata (L, index, EOL_ARENA);
+}
+
+
+static void*
+arena_alloc (EolArena *arena, size_t size)
+{
+    /* Chunks after the current one are left over from before a reset. */
+    for (EolArenaChunk *c = arena->current; c; c = c->next) {
+        size_t offset = (c->used + EOL_ARENA_ALIGN - 1) & ~(EOL_ARENA_ALIGN - 1);
+        if (offset + size <= c->size) {
+            c->used = offset + size;
+            arena->current = c;
+            return &c->data[offset];
+        }
+    }
+
+    size_t chunk_size = (size > arena->chunk_size) ? size : arena->chunk_size;
+    EolArenaChunk *c = malloc (sizeof (EolArenaChunk) + chunk_size);
+    if (!c)
+        return NULL;
+    c->size = chunk_size;
+    c->used = size;
+
+    /* Insert after the current chunk, to keep reusing the following ones. */
+    if (arena->current) {
+        c->next = arena->current->next;
+        arena->current->next = c;
+    } else {
+        c->next = NULL;
+        arena->first = c;
+    }
+    arena->current = c;
+    return c->data;
+}
+
+
+/*
+ * Usage: var = arena:new(type [, n])
+ */
+static int
+arena_new (lua_State *L)
+{
+    EolArena *arena = to_eol_arena (L, 1);
+    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 2);
+    lua_Integer n_items = luaL_optinteger (L, 3, 1);
+
+    /* The total size of an array type must fit in 32 bits. */
+    const size_t item_size = eol_typeinfo_sizeof (typeinfo);
+    if (n_items < 1 || (item_size && !array_size_fits (item_size, n_items)))
+        return luaL_error (L, "argument #3 out of range");
+
+    if (!lua_isnoneornil (L, 3))
+        typeinfo = eol_type_cache_derived (EOL_TYPE_ARRAY, typeinfo, n_items);
+
+    const size_t size = item_size * (size_t) n_items;
+    void *address = arena_alloc (arena, size ? size : 1);
+    if (!address)
+        return luaL_error (L, "cannot allocate %I bytes", (lua_Integer) size);
+    memset (address, 0x00, size);
+
+    /*
+     * Wrappers are taken from the cache: after a reset, the same values
+     * are usually created at the same addresses, without allocations.
+     */
+    variable_push_cached (L, typeinfo, address);
+    lua_pushvalue (L, 1);
+    variable_uservalue_set (L, -2, "owner");
+    return 1;
+}
+
+
+/*
+ * Usage: arena:reset()
+ */
+static int
+arena_reset (lua_State *L)
+{
+    EolArena *arena = to_eol_arena (L, 1);
+    for (EolArenaChunk *c = arena->first; c; c = c->next)
+        c->used = 0;
+    arena->current = arena->first;
+    return 0;
+}
+
+
+static const luaL_Reg arena_functions[] = {
+    { "new",   arena_new   },
+    { "reset", arena_reset },
+    { NULL, NULL },
+};
+
+
+static int
+arena_index (lua_State *L)
+{
+    to_eol_arena (L, 1);
+    if (!push_named_function (L, 2, arena_functions))
+        lua_pushnil (L);
+    return 1;
+}
+
+
+static int
+arena_gc (lua_State *L)
+{
+    EolArena *arena = to_eol_arena (L, 1);
+    while (arena->first) {
+        EolArenaChunk *next = arena->first->next;
+        free (arena->first);
+        arena->first = next;
+    }
+    arena->current = NULL;
+    return 0;
+}
+
+
+static int
+arena_tostring (lua_State *L)
+{
+    EolArena *arena = to_eol_arena (L, 1);
+    size_t used = 0, size = 0;
+    for (EolArenaChunk *c = arena->first; c; c = c->next) {
+        used += c->used;
+        size += c->size;
+    }
+    lua_pushfstring (L, "eol.arena<%p>(%d/%d)", arena, (int) used, (int) size);
+    return 1;
+}
+
+
+static const luaL_Reg arena_methods[] = {
+    { "__index",    arena_index    },
+    { "__gc",       arena_gc       },
+    { "__tostring", arena_tostring },
+    { NULL, NULL },
+};
+
+
+/*
+ * Usage: arena = eol.arena([chunk_size])
+ */
+static int
+eol_arena (lua_State *L)
+{
+    lua_Integer chunk_size = luaL_optinteger (L, 1, EOL_ARENA_CHUNK_SIZE);
+    if (chunk_size < 1)
+        return luaL_error (L, "argument #1 must be > 0");
+
+    EolArena *arena = lua_newuserdata (L, sizeof (EolArena));
+    arena->first      = NULL;
+    arena->current    = NULL;
+    arena->chunk_size = chunk_size;
+    luaL_setmetatable (L, EOL_ARENA);
+    return 1;
+}
+
+
+/*
+ * Compiled field paths, created by eol.path(type, "a.b[2].c"). The members
+ * and constant array indices are resolved once, and folded into a single
+ * offset from the start of the root value. Array indices written as "[?]"
+ * are given when calling the path, and each one adds "(i - 1) * stride" to
+ * the offset. Array indices start at 1, like when indexing variables.
+ *
+ * Paths cannot traverse pointers, as the offset would then depend on the
+ * value of the pointer.
+ */
+static const char EOL_PATH[] = "org.perezdecastro.eol.Path";
+
+typedef struct {
+    uint32_t stride;
+    uint32_t n_items;
+} EolPathIndex;
+
+typedef struct {
+    const EolTypeInfo *root;     /* Non-synthetic. */
+    const EolTypeInfo *leaf;     /* Non-synthetic. */
+    const CValueOps   *ops;
+    uintptr_t          offset;
+    bool               readonly;
+    uint32_t           n_indices;
+    EolPathIndex       indices[];
+} EolPath;
+
+
+static inline EolPath*
+to_eol_path (lua_State *L, int index)
+{
+    return (EolPath*) luaL_checkudata (L, index, EOL_PATH);
+}
+
+
+/* Root type for a typeinfo or a variable, skipping one pointer level. */
+static const EolTypeInfo*
+path_root_type (const EolTypeInfo *typeinfo)
+{
+    typeinfo = eol_typeinfo_get_non_synthetic (typeinfo);
+    if (eol_typeinfo_is_pointer (typeinfo))
+        typeinfo = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (typeinfo));
+    return typeinfo;
+}
+
+
+/*
+ * Usage: path = eol.path(type_or_variable, "member[1].other[?]")
+ */
+static int
+eol_path (lua_State *L)
+{
+    const EolTypeInfo *T;
+    EolVariable *ev;
+    if ((ev = test_eol_variable (L, 1))) {
+        T = ev->typeinfo;
+    } else {
+        T = to_eol_typeinfo (L, 1);
+    }
+    const char *path = luaL_checkstring (L, 2);
+
+    uint32_t n_indices = 0;
+    for (const char *p = path; *p; p++)
+        if (*p == '?') n_indices++;
+
+    EolPath *ep = lua_newuserdata (L, sizeof (EolPath) +
+                                   n_indices * sizeof (EolPathIndex));
+    memset (ep, 0x00, sizeof (EolPath));
+    T = path_root_type (T);
+    ep->root = T;
+
+    const char *p = path;
+    while (*p) {
+        if (*p == '[') {
+            if (!eol_typeinfo_is_array (T)) {
+                return luaL_error (L, "%s: '%s' is not an array",
+                                   path, eol_typeinfo_name (T));
+            }
+            const uint64_t n_items = eol_typeinfo_array_n_items (T);
+            const EolTypeInfo *base = eol_typeinfo_base (T);
+            ep->readonly |= eol_typeinfo_is_readonly (base);
+            T = eol_typeinfo_get_non_synthetic (base);
+
+            if (p[1] == '?' && p[2] == ']') {
+                EolPathIndex *index = &ep->indices[ep->n_indices++];
+                index->stride  = eol_typeinfo_sizeof (T);
+                index->n_items = n_items;
+                p += 3;
+            } else {
+                char *end;
+                unsigned long long i = strtoull (p + 1, &end, 10);
+                if (end == p + 1 || *end != ']') {
+                    return luaL_error (L, "%s: invalid array index at '%s'",
+                                       path, p);
+                }
+                if (i < 1 || i > n_items) {
+                    return luaL_error (L, "%s: index %d out of bounds "
+                                       "(length=%d)", path, (int) i,
+                                       (int) n_items);
+                }
+                ep->offset += (i - 1) * eol_typeinfo_sizeof (T);
+                p = end + 1;
+            }
+        } else {
+            if (*p == '.' && p != path) p++;
+
+            const char *name = p;
+            while (*p && *p != '.' && *p != '[') p++;
+            if (p == name) {
+                return luaL_error (L, "%s: empty member name", path);
+            }
+            if (!eol_typeinfo_is_compound (T) || eol_typeinfo_is_array (T)) {
+                return luaL_error (L, "%s: '%s' is not a struct or union",
+                                   path, eol_typeinfo_name (T));
+            }
+
+            lua_pushlstring (L, name, p - name);
+            const EolTypeInfoMember *member =
+                    eol_typeinfo_compound_const_named_member (T,
+                                                              lua_tostring (L, -1));
+            if (!member) {
+                return luaL_error (L, "%s: no member '%s' in '%s'", path,
+                                   lua_tostring (L, -1),
+                                   eol_typeinfo_name (T));
+            }
+            lua_pop (L, 1);
+
+            if (eol_typeinfo_is_struct (T))
+                ep->offset += member->offset;
+            ep->readonly |= eol_typeinfo_is_readonly (member->typeinfo);
+            T = eol_typeinfo_get_non_synthetic (member->typeinfo);
+        }
+
+        if (*p && eol_typeinfo_is_pointer (T)) {
+            return luaL_error (L, "%s: cannot traverse pointers", path);
+        }
+    }
+
+    CHECK_UINT_EQ (n_indices, ep->n_indices);
+    ep->leaf = T;
+    ep->ops  = cvalue_ops (T);
+    luaL_setmetatable (L, EOL_PATH);
+    return 1;
+}
+
+
+/*
+ * Usage: value = path(variable [, i...])
+ *        path(variable [, i...], value)
+ */
+static int
+path_call (lua_State *L)
+{
+    EolPath *ep = to_eol_path (L, 1);
+    EolVariable *ev = to_eol_variable (L, 2);
+
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (ev->typeinfo);
+    if (T != ep->root && (T = path_root_type (T)) != ep->root &&
+        !eol_typeinfo_equal (T, ep->root)) {
+        typeinfo_push_stringrep (L, ep->root, false);
+        typeinfo_push_stringrep (L, ev->typeinfo, false);
+        return luaL_error (L, "path for type '%s' used on value of type '%s'",
+                           lua_tostring (L, -2), lua_tostring (L, -1));
+    }
+
+    uintptr_t address = (uintptr_t) ev->address + ep->offset;
+    for (uint32_t i = 0; i < ep->n_indices; i++) {
+        lua_Integer index = luaL_checkinteger (L, i + 3);
+        if (index < 1 || index > ep->indices[i].n_items) {
+            return luaL_error (L, "index %d out of bounds (length=%d)",
+                               (int) index, (int) ep->indices[i].n_items);
+        }
+        address += (index - 1) * ep->indices[i].stride;
+    }
+
+    const bool readonly = ep->readonly ||
+                          eol_typeinfo_is_readonly (ev->typeinfo);
+    const int value_index = ep->n_indices + 3;
+    if (lua_gettop (L) < value_index)
+        return cvalue_push_element (L, 2, ep->leaf, (void*) address, readonly);
+
+    if (readonly) {
+        return luaL_error (L, "path leads to a read-only value");
+    }
+    (*ep->ops->get) (L, value_index, ep->leaf, (void*) address);
+    return 0;
+}
+
+
+static int
+path_tostring (lua_State *L)
+{
+    EolPath *ep = to_eol_path (L, 1);
+    lua_pushfstring (L, "eol.path<%s>(%p)",
+                     eol_typeinfo_name (ep->root), ep);
+    return 1;
+}
+
+
+static const luaL_Reg path_methods[] = {
+    { "__call",     path_call     },
+    { "__tostring", path_tostring },
+    { NULL, NULL },
+};
+
+
+static void
+create_meta (lua_State *L)
+{
+    /* EolLibrary */
+    luaL_newmetatable (L, EOL_LIBRARY);
+    luaL_setfuncs (L, library_methods, 0);
+    lua_pop (L, 1);
+
+    /* EolFunction */
+    luaL_newmetatable (L, EOL_FUNCTION);
+    luaL_setfuncs (L, function_methods, 0);
+    lua_pop (L, 1);
+
+    /* EolVariable */
+    for (size_t i = 0; i < LENGTH_OF (variable_kinds); i++) {
+        luaL_newmetatable (L, variable_kinds[i].name);
+        luaL_setfuncs (L, variable_methods, 0);
+        lua_pushcfunction (L, variable_kinds[i].index);
+        lua_setfield (L, -2, "__index");
+        lua_pushcfunction (L, variable_kinds[i].newindex);
+        lua_setfield (L, -2, "__newindex");
+        lua_pushboolean (L, true);
+        lua_rawsetp (L, -2, EOL_VARIABLE);
+        /* Same __name for all kinds, as seen from Lua. */
+        lua_pushstring (L, EOL_VARIABLE);
+        lua_setfield (L, -2, "__name");
+        lua_pop (L, 1);
+    }
+
+    /* EolVariable backed by a memory mapping, or an allocation. */
+    for (size_t i = 0; i < LENGTH_OF (mapping_kinds); i++) {
+        luaL_newmetatable (L, mapping_kinds[i].name);
+        luaL_setfuncs (L, variable_methods, 0);
+        luaL_setfuncs (L, mapping_kinds[i].methods, 0);
+        lua_pushboolean (L, true);
+        lua_rawsetp (L, -2, EOL_VARIABLE);
+        lua_pushstring (L, EOL_VARIABLE);
+        lua_setfield (L, -2, "__name");
+        lua_pop (L, 1);
+    }
+
+    /* EolArena */
+    luaL_newmetatable (L, EOL_ARENA);
+    luaL_setfuncs (L, arena_methods, 0);
+    lua_pop (L, 1);
+
+    /* EolView */
+    luaL_newmetatable (L, EOL_VIEW);
+    luaL_setfuncs (L, view_methods, 0);
+    lua_pop (L, 1);
+
+    /* EolPath */
+    luaL_newmetatable (L, EOL_PATH);
+    luaL_setfuncs (L, path_methods, 0);
+    lua_pop (L, 1);
+
+    /* EolypeInfo */
+    luaL_newmetatable (L, EOL_TYPEINFO);
+    luaL_setfuncs (L, typeinfo_methods, 0);
+    lua_pop (L, 1);
+    registry_set_weak_table (L, EOL_TYPEINFO_CACHE);
+
+    lua_newtable (L);
+    lua_rawsetp (L, LUA_REGISTRYINDEX, EOL_PACK_PLANS);
+}
+
+
+static int
+eol_load (lua_State *L)
+{
+    size_t name_length;
     const char *name = luaL_checklstring (L, 1, &name_length);
 
     unsigned dlopen_flags = RTLD_NOW;
@@ -1494,211 +4173,954 @@ eol_load (lua_State *L)
         }
     }
 
-    char path[PATH_MAX];
-    errno = 0;
-    if (!find_library (name, path)) {
-        return luaL_error (L, "could not find library '%s' (%s)", name,
-                           (errno == 0) ? "path too long" : strerror (errno));
+    char path[PATH_MAX];
+    errno = 0;
+    if (!find_library (name, path)) {
+        return luaL_error (L, "could not find library '%s' (%s)", name,
+                           (errno == 0) ? "path too long" : strerror (errno));
+    }
+    TRACE ("found %s -> %s\n", name, path);
+
+    /*
+     * If the library at the resolved path has been already loaded, return
+     * a reference to the existing one instead of opening it multiple times.
+     */
+    EolLibrary *library = NULL;
+    for (library = library_list; library; library = library->next) {
+        if (string_equal (path, library->path)) {
+            TRACE_PTR (+, EolLibrary, library, " [%s]\n", library->path);
+            library_push_userdata (L, library);
+            return 1;
+        }
+    }
+
+    void *dl = dlopen (path, dlopen_flags);
+    if (!dl) {
+        return luaL_error (L, "could not link library '%s' (%s)",
+                           path, dlerror ());
+    }
+
+    EolElf *elf = eol_elf_open (path);
+    if (!elf) {
+        dlclose (dl);
+        return luaL_error (L, "could not open '%s' for reading (%s)",
+                           path, strerror (errno));
+    }
+
+    Dwarf_Debug d_debug = NULL;
+    Dwarf_Obj_Access_Interface *d_access = NULL;
+    Dwarf_Signed d_num_globals = 0;
+    Dwarf_Global *d_globals = NULL;
+    Dwarf_Signed d_num_types = 0;
+    Dwarf_Type *d_types = NULL;
+
+    /*
+     * BTF type information is much faster to load than DWARF, so it is
+     * used instead when available. Note that stripping debugging information
+     * keeps the ".BTF" section, so there is no need to look elsewhere.
+     */
+    EolBtf *btf = eol_btf_new (elf);
+    if (btf) {
+        TRACE ("using BTF type information\n");
+        goto create_library;
+    }
+
+    /*
+     * Stripped libraries may have their debugging information installed
+     * separately, try to locate it using the build-id or the debuglink.
+     */
+    if (!eol_elf_has_debug_info (elf)) {
+        EolElf *debug_elf = eol_elf_open_debug (elf);
+        if (debug_elf) {
+            eol_elf_close (elf);
+            elf = debug_elf;
+        }
+    }
+
+    Dwarf_Error d_error = DW_DLE_NE;
+    if (dw_elf_init (elf, &d_access, &d_debug, &d_error) != DW_DLV_OK) {
+        eol_elf_close (elf);
+        dlclose (dl);
+        return luaL_error (L, "error reading debug information from '%s' (%s)",
+                           path, dwarf_errmsg (d_error));
+    }
+
+    if (dwarf_get_globals (d_debug,
+                           &d_globals,
+                           &d_num_globals,
+                           &d_error) == DW_DLV_ERROR) {
+        Dwarf_Error d_finish_error = DW_DLE_NE;
+        dw_elf_finish (d_debug, d_access, &d_finish_error);
+        eol_elf_close (elf);
+        dlclose (dl);
+        return luaL_error (L, "cannot read globals (%s)", dw_errmsg (d_error));
+    }
+    TRACE ("found %ld globals\n", (long) d_num_globals);
+
+#if EOL_TRACE > 1
+    for (Dwarf_Signed i = 0; i < d_num_globals; i++) {
+        char *name = NULL;
+        Dwarf_Error d_name_error = DW_DLE_NE;
+        if (dwarf_globname (d_globals[i], &name, &d_name_error) == DW_DLV_OK) {
+            TRACE (">  [%li] %s\n", (long) i, name);
+            dwarf_dealloc (d_debug, name, DW_DLA_STRING);
+        } else {
+            TRACE (">  [%li] ERROR: %s\n", (long) i, dw_errmsg (d_name_error));
+        }
+    }
+#endif /* EOL_TRACE */
+
+    if (dwarf_get_pubtypes (d_debug,
+                            &d_types,
+                            &d_num_types,
+                            &d_error) == DW_DLV_ERROR) {
+        Dwarf_Error d_finish_error = DW_DLE_NE;
+        dwarf_globals_dealloc (d_debug, d_globals, d_num_globals);
+        dw_elf_finish (d_debug, d_access, &d_finish_error);
+        eol_elf_close (elf);
+        dlclose (dl);
+        return luaL_error (L, "cannot read types (%s)", dw_errmsg (d_error));
+    }
+    TRACE ("found %ld types\n", (long) d_num_types);
+
+#if EOL_TRACE > 1
+    for (Dwarf_Signed i = 0; i < d_num_types; i++) {
+        char *name = NULL;
+        Dwarf_Error d_name_error = DW_DLE_NE;
+        if (dwarf_pubtypename (d_types[i], &name, &d_name_error) == DW_DLV_OK) {
+            TRACE (">  [%li] %s\n", (long) i, name);
+            dwarf_dealloc (d_debug, name, DW_DLA_STRING);
+        } else {
+            TRACE (">  [%li] ERROR: %s\n", (long) i, dw_errmsg (d_name_error));
+        }
+    }
+#endif /* EOL_TRACE */
+
+create_library:;
+    EolLibrary *el = calloc (1, sizeof (EolLibrary));
+    el->elf = elf;
+    el->dwarf = btf ? NULL : eol_dwarf_new (elf);
+    el->btf = btf;
+    el->dl = dl;
+    el->path = strdup (path);
+    el->d_debug = d_debug;
+    el->d_access = d_access;
+    el->d_globals = d_globals;
+    el->d_num_globals = d_num_globals;
+    el->d_types = d_types;
+    el->d_num_types = d_num_types;
+    el->next = library_list;
+    library_list = el;
+    eol_type_cache_init (&el->type_cache);
+    library_push_userdata (L, el);
+
+    TRACE_PTR (>, EolLibrary, el, " [%s]\n", el->path);
+
+    return 1;
+}
+
+
+static int
+eol_type (lua_State *L)
+{
+    EolLibrary *el = to_eol_library (L, 1);
+
+    luaL_checktype (L, 2, LUA_TSTRING);
+    const char *name = lua_tostring (L, 2);
+
+    if (el->btf) {
+        const EolTypeInfo *typeinfo;
+        if (!library_btf_find_type (el, name, &typeinfo)) {
+            lua_pushnil (L);
+            return 1;
+        }
+        if (!typeinfo) {
+            return luaL_error (L, "%s: no type info (library: %p; BTF)",
+                               name, el);
+        }
+        typeinfo_push_userdata (L, typeinfo);
+        return 1;
+    }
+
+    Dwarf_Error d_error = DW_DLE_NE;
+    Dwarf_Off d_offset = library_get_tue_offset (el, name, &el, &d_error);
+    if (d_offset == DW_DLV_BADOFFSET) {
+        if (d_error == DW_DLE_NE) {
+            /* No libdwarf error: the type was not found */
+            lua_pushnil (L);
+            return 1;
+        }
+        return luaL_error (L, "%s: could not look up DWARF TUE offset "
+                           "(library: %p; %s)", name, el, dw_errmsg (d_error));
+    }
+
+    const EolTypeInfo *typeinfo = library_lookup_type (el, d_offset, &d_error);
+    if (!typeinfo) {
+        return luaL_error (L, "%s: no type info (%s)",
+                           name, dw_errmsg (d_error));
+    }
+
+#if EOL_TYPECACHE_STATS
+    TRACE ("@type-cache hits=%" PRIu64 " misses=%" PRIu64 "\n",
+           el->type_cache_hits, el->type_cache_misses);
+#endif /* EOL_TYPECACHE_STATS */
+
+    typeinfo_push_userdata (L, typeinfo);
+    return 1;
+}
+
+
+/*
+ * Usage: eol.sizeof(ct [, nelem])
+ *
+ * TODO: Handle second "nelem" parameter for VLAs.
+ */
+static int
+eol_sizeof (lua_State *L)
+{
+    const EolTypeInfo *typeinfo = NULL;
+
+    EolVariable *ev;
+    if ((ev = test_eol_variable (L, 1))) {
+        typeinfo = ev->typeinfo;
+    } else if (luaL_testudata (L, 1, EOL_FUNCTION)) {
+        /* Functions do not have a size, return "nil" */
+        lua_pushnil (L);
+        return 1;
+    } else {
+        typeinfo = to_eol_typeinfo (L, 1);
+    }
+
+    CHECK_NOT_NULL (typeinfo);
+    if (eol_typeinfo_is_void (typeinfo)) {
+        lua_pushnil (L);
+    } else {
+        lua_pushinteger (L, eol_typeinfo_sizeof (typeinfo));
+    }
+    return 1;
+}
+
+
+static int
+eol_cast (lua_State *L)
+{
+    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 1);
+    EolVariable *ev = to_eol_variable (L, 2);
+    if (!ev->address)
+        luaL_argerror (L, 2, "value was freed or unmapped");
+
+    variable_push_userdata (L,
+                            SYMBOL_LIBRARY (ev),
+                            typeinfo,
+                            ev->address,
+                            SYMBOL_NAME (ev),
+                            VARIABLE_PUSH_NOCOPY);
+    mapping_add_dependent (L, 2, -1);
+    return 1;
+}
+
+
+/*
+ * Usage: var = eol.gc(var, finalizer)
+ *
+ * Attaches a C function taking a single pointer, which is called with the
+ * address of the value when the variable is collected, typically to free
+ * objects created by a library. For pointers returned by C functions that
+ * is the pointer itself. Passing "nil" removes the finalizer.
+ */
+static int
+eol_gc (lua_State *L)
+{
+    to_eol_variable (L, 1);
+    if (lua_isnoneornil (L, 2)) {
+        lua_pushnil (L);
+    } else {
+        EolFunction *ef = luaL_checkudata (L, 2, EOL_FUNCTION);
+        if (ef->n_param != 1 || !eol_typeinfo_is_pointer (ef->param_types[0])) {
+            return luaL_error (L, "finalizer %s() must take a single pointer",
+                               SYMBOL_NAME (ef));
+        }
+        lua_pushvalue (L, 2);
+    }
+    variable_uservalue_set (L, 1, "finalizer");
+    lua_settop (L, 1);
+    return 1;
+}
+
+
+/*
+ * Bulk memory operations on the storage of variables. The extent of a
+ * variable is the size of its type, and for pointers (whose address is
+ * that of the pointee) the size of the pointed-to type. Pointers to void,
+ * or to other types without a size, need the number of bytes to be given
+ * explicitly; eol.cast() can also be used to operate on a block of memory
+ * known through a pointer, e.g. eol.cast(T:arrayof(n), ptr).
+ */
+static void*
+bulk_extent (lua_State *L, int index, size_t *size, bool write)
+{
+    EolVariable *ev = to_eol_variable (L, index);
+    if (write && eol_typeinfo_is_readonly (ev->typeinfo))
+        luaL_argerror (L, index, "read-only variable");
+    if (!ev->address) {
+        *size = 0;
+        return NULL;
+    }
+
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (ev->typeinfo);
+    if (eol_typeinfo_is_pointer (T)) {
+        T = eol_typeinfo_base (T);
+        if (eol_typeinfo_sizeof (T) == 0) {
+            /* All the operations take the number of bytes as argument #3. */
+            if (lua_isnoneornil (L, 3))
+                luaL_argerror (L, index, "pointer to a value without size, "
+                               "number of bytes needed");
+            *size = SIZE_MAX;
+            return ev->address;
+        }
+    }
+    *size = eol_typeinfo_sizeof (T);
+    return ev->address;
+}
+
+
+/* Number of bytes to operate on, given as optional argument. */
+static size_t
+bulk_length (lua_State *L, int index, size_t size, size_t max_size)
+{
+    if (lua_isnoneornil (L, index))
+        return size;
+
+    lua_Integer length = luaL_checkinteger (L, index);
+    if (length < 0 || (size_t) length > max_size) {
+        luaL_error (L, "cannot operate on %d bytes (max=%d)",
+                    (int) length, (int) max_size);
     }
-    TRACE ("found %s -> %s\n", name, path);
+    return length;
+}
 
-    /*
-     * If the library at the resolved path has been already loaded, return
-     * a reference to the existing one instead of opening it multiple times.
-     */
-    EolLibrary *library = NULL;
-    for (library = library_list; library; library = library->next) {
-        if (string_equal (path, library->path)) {
-            TRACE_PTR (+, EolLibrary, library, " [%s]\n", library->path);
-            library_push_userdata (L, library);
-            return 1;
-        }
+
+static inline int
+bulk_transfer (lua_State *L, bool overlap)
+{
+    size_t dst_size, src_size;
+    void *dst = bulk_extent (L, 1, &dst_size, true);
+    const void *src = bulk_extent (L, 2, &src_size, false);
+
+    const size_t length = bulk_length (L, 3, src_size,
+                                       (src_size < dst_size) ? src_size
+                                                             : dst_size);
+    if (lua_isnoneornil (L, 3) && src_size > dst_size) {
+        return luaL_error (L, "destination too small (%d < %d)",
+                           (int) dst_size, (int) src_size);
     }
 
-    void *dl = dlopen (path, dlopen_flags);
-    if (!dl) {
-        return luaL_error (L, "could not link library '%s' (%s)",
-                           path, dlerror ());
+    if (overlap) {
+        memmove (dst, src, length);
+    } else {
+        if ((uintptr_t) dst < (uintptr_t) src + length &&
+            (uintptr_t) src < (uintptr_t) dst + length)
+            return luaL_error (L, "overlapping variables, use eol.move()");
+        memcpy (dst, src, length);
     }
+    lua_pushinteger (L, length);
+    return 1;
+}
 
-    int fd = open (path, O_RDONLY, 0);
-    if (fd < 0) {
-        dlclose (dl);
-        return luaL_error (L, "could not open '%s' for reading (%s)",
-                           path, strerror (errno));
+
+/*
+ * Usage: n = eol.copy(destination, source [, nbytes])
+ */
+static int
+eol_copy (lua_State *L)
+{
+    return bulk_transfer (L, false);
+}
+
+
+/*
+ * Usage: n = eol.move(destination, source [, nbytes])
+ *
+ * Like eol.copy(), but the variables may overlap.
+ */
+static int
+eol_move (lua_State *L)
+{
+    return bulk_transfer (L, true);
+}
+
+
+/*
+ * Usage: n = eol.fill(variable, byte [, nbytes])
+ */
+static int
+eol_fill (lua_State *L)
+{
+    size_t size;
+    void *address = bulk_extent (L, 1, &size, true);
+    lua_Integer byte = luaL_checkinteger (L, 2);
+    luaL_argcheck (L, byte >= 0 && byte <= UINT8_MAX, 2, "not a byte value");
+
+    const size_t length = bulk_length (L, 3, size, size);
+    memset (address, (int) byte, length);
+    lua_pushinteger (L, length);
+    return 1;
+}
+
+
+/*
+ * Usage: result = eol.compare(a, b [, nbytes])
+ *
+ * Returns -1, 0, or 1. Without "nbytes", if the contents of the shorter
+ * variable are the same as the start of the longer, the shorter is less.
+ */
+static int
+eol_compare (lua_State *L)
+{
+    size_t a_size, b_size;
+    const void *a = bulk_extent (L, 1, &a_size, false);
+    const void *b = bulk_extent (L, 2, &b_size, false);
+
+    const size_t min_size = (a_size < b_size) ? a_size : b_size;
+    const size_t length = bulk_length (L, 3, min_size, min_size);
+
+    int result = (a == b || length == 0) ? 0 : memcmp (a, b, length);
+    if (result == 0 && lua_isnoneornil (L, 3))
+        result = (a_size > b_size) - (a_size < b_size);
+    lua_pushinteger (L, (result > 0) - (result < 0));
+    return 1;
+}
+
+
+/*
+ * Numeric kernels over arrays, or views with contiguous elements. See
+ * eol-kernels.h for the supported element types.
+ */
+static void
+kernel_array (lua_State *L, int index, EolView *view, bool write)
+{
+    view_from_value (L, index, view);
+    if (view->stride != eol_typeinfo_sizeof (view->typeinfo))
+        luaL_argerror (L, index, "elements are not contiguous");
+    if (write && view->readonly)
+        luaL_argerror (L, index, "read-only elements");
+}
+
+
+static void
+kernel_check_same (lua_State *L, const EolView *a, const EolView *b)
+{
+    if (a->typeinfo != b->typeinfo &&
+        !eol_typeinfo_equal (a->typeinfo, b->typeinfo)) {
+        typeinfo_push_stringrep (L, a->typeinfo, false);
+        typeinfo_push_stringrep (L, b->typeinfo, false);
+        luaL_error (L, "mismatched element types '%s' and '%s'",
+                    lua_tostring (L, -2), lua_tostring (L, -1));
+    }
+    if (a->n_items != b->n_items) {
+        luaL_error (L, "mismatched lengths (%d and %d)",
+                    (int) a->n_items, (int) b->n_items);
     }
+}
 
-    Dwarf_Handler d_error_handler = 0;
-    Dwarf_Ptr d_error_argument = 0;
-    Dwarf_Error d_error = DW_DLE_NE;
-    Dwarf_Debug d_debug;
-
-    if (dwarf_init (fd,
-                    DW_DLC_READ,
-                    d_error_handler,
-                    d_error_argument,
-                    &d_debug,
-                    &d_error) != DW_DLV_OK) {
-        close (fd);
-        dlclose (dl);
-        return luaL_error (L, "error reading debug information from '%s' (%s)",
-                           path, dwarf_errmsg (d_error));
+
+static int
+kernel_unsupported (lua_State *L, const EolView *view)
+{
+    typeinfo_push_stringrep (L, view->typeinfo, false);
+    return luaL_error (L, "unsupported element type '%s'",
+                       lua_tostring (L, -1));
+}
+
+
+static inline void
+kernel_push_value (lua_State *L, const EolKernelValue *value)
+{
+    if (value->is_float)
+        lua_pushnumber (L, value->d);
+    else
+        lua_pushinteger (L, value->i);
+}
+
+
+/*
+ * Usage: value = eol.reduce(array, "sum" | "min" | "max")
+ *
+ * The minimum and maximum of empty arrays are "nil".
+ */
+static int
+eol_reduce (lua_State *L)
+{
+    static const char *const ops[] = { "sum", "min", "max", NULL };
+    static const EolKernelReduce op_values[] = {
+        EOL_KERNEL_SUM, EOL_KERNEL_MIN, EOL_KERNEL_MAX,
+    };
+
+    EolView x;
+    kernel_array (L, 1, &x, false);
+    const EolKernelReduce op = op_values[luaL_checkoption (L, 2, NULL, ops)];
+
+    if (x.n_items == 0 && op != EOL_KERNEL_SUM) {
+        lua_pushnil (L);
+        return 1;
     }
 
-    Dwarf_Signed d_num_globals = 0;
-    Dwarf_Global *d_globals = NULL;
-    if (dwarf_get_globals (d_debug,
-                           &d_globals,
-                           &d_num_globals,
-                           &d_error) != DW_DLV_OK) {
-        Dwarf_Error d_finish_error = DW_DLE_NE;
-        dwarf_finish (d_debug, &d_finish_error);
-        close (fd);
-        dlclose (dl);
-        return luaL_error (L, "cannot read globals (%s)", dw_errmsg (d_error));
+    EolKernelValue result;
+    if (!eol_kernel_reduce (eol_typeinfo_type (x.typeinfo), op,
+                            x.address, x.n_items, &result))
+        return kernel_unsupported (L, &x);
+    kernel_push_value (L, &result);
+    return 1;
+}
+
+
+/*
+ * Usage: value = eol.dot(x, y)
+ */
+static int
+eol_dot (lua_State *L)
+{
+    EolView x, y;
+    kernel_array (L, 1, &x, false);
+    kernel_array (L, 2, &y, false);
+    kernel_check_same (L, &x, &y);
+
+    EolKernelValue result;
+    if (!eol_kernel_dot (eol_typeinfo_type (x.typeinfo),
+                         x.address, y.address, x.n_items, &result))
+        return kernel_unsupported (L, &x);
+    kernel_push_value (L, &result);
+    return 1;
+}
+
+
+/*
+ * Usage: eol.axpy(a, x, y)
+ *
+ * Computes y = a * x + y, element-wise. For arrays of integers, "a" must
+ * be an integer.
+ */
+static int
+eol_axpy (lua_State *L)
+{
+    EolView x, y;
+    kernel_array (L, 2, &x, false);
+    kernel_array (L, 3, &y, true);
+    kernel_check_same (L, &x, &y);
+
+    const EolType type = eol_typeinfo_type (x.typeinfo);
+    EolKernelValue a;
+    if (type == EOL_TYPE_DOUBLE || type == EOL_TYPE_FLOAT) {
+        if ((a.is_float = !lua_isinteger (L, 1)))
+            a.d = luaL_checknumber (L, 1);
+        else
+            a.i = lua_tointeger (L, 1);
+    } else {
+        /* Errors out for numbers without an integer representation. */
+        a.is_float = false;
+        a.i = luaL_checkinteger (L, 1);
     }
-    TRACE ("found %ld globals\n", (long) d_num_globals);
 
-#if EOL_TRACE > 1
-    for (Dwarf_Signed i = 0; i < d_num_globals; i++) {
-        char *name = NULL;
-        Dwarf_Error d_name_error = DW_DLE_NE;
-        if (dwarf_globname (d_globals[i], &name, &d_name_error) == DW_DLV_OK) {
-            TRACE (">  [%li] %s\n", (long) i, name);
-            dwarf_dealloc (d_debug, name, DW_DLA_STRING);
-        } else {
-            TRACE (">  [%li] ERROR: %s\n", (long) i, dw_errmsg (d_name_error));
+    if (!eol_kernel_axpy (type, a, x.address, y.address, x.n_items))
+        return kernel_unsupported (L, &x);
+    return 0;
+}
+
+
+/*
+ * Usage: n = eol.convert(destination, source)
+ *
+ * Converts the elements of the source to the type of the elements of the
+ * destination, which must have room for all of them.
+ */
+static int
+eol_convert (lua_State *L)
+{
+    EolView dst, src;
+    kernel_array (L, 1, &dst, true);
+    kernel_array (L, 2, &src, false);
+
+    if (dst.n_items < src.n_items) {
+        return luaL_error (L, "destination too small (%d < %d)",
+                           (int) dst.n_items, (int) src.n_items);
+    }
+    if (!eol_kernel_convert (eol_typeinfo_type (dst.typeinfo), dst.address,
+                             eol_typeinfo_type (src.typeinfo), src.address,
+                             src.n_items)) {
+        typeinfo_push_stringrep (L, src.typeinfo, false);
+        typeinfo_push_stringrep (L, dst.typeinfo, false);
+        return luaL_error (L, "cannot convert elements of type '%s' to '%s'",
+                           lua_tostring (L, -2), lua_tostring (L, -1));
+    }
+    lua_pushinteger (L, src.n_items);
+    return 1;
+}
+
+
+/*
+ * Sorting and binary search of arrays (or views) by the value of a member
+ * of their elements, or by the elements themselves when they are scalars.
+ * Keys are mapped to unsigned integers of the same width which preserve
+ * their order, so the same (stable, LSD) radix sort works for integers and
+ * floating point values.
+ */
+typedef enum {
+    SORT_KEY_UNSIGNED,
+    SORT_KEY_SIGNED,
+    SORT_KEY_FLOAT,
+} SortKeyKind;
+
+typedef struct {
+    uint32_t           offset;
+    uint32_t           size;
+    SortKeyKind        kind;
+    bool               descending;
+    const EolTypeInfo *typeinfo;
+} SortKey;
+
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} SortItem;
+
+
+static void
+sort_key_init (lua_State *L, int index, const EolView *view, SortKey *key)
+{
+    const EolTypeInfo *T = view->typeinfo;
+    key->offset = 0;
+
+    if (!lua_isnoneornil (L, index)) {
+        const char *name = luaL_checkstring (L, index);
+        if (!eol_typeinfo_is_struct (T) && !eol_typeinfo_is_union (T)) {
+            typeinfo_push_stringrep (L, T, false);
+            luaL_error (L, "elements of type '%s' do not have fields",
+                        lua_tostring (L, -1));
+        }
+        const EolTypeInfoMember *member =
+                eol_typeinfo_compound_const_named_member (T, name);
+        if (!member) {
+            typeinfo_push_stringrep (L, T, true);
+            luaL_error (L, "%s: no such member in type '%s'",
+                        name, lua_tostring (L, -1));
         }
+        if (eol_typeinfo_is_struct (T))
+            key->offset = member->offset;
+        T = eol_typeinfo_get_non_synthetic (member->typeinfo);
     }
-#endif /* EOL_TRACE */
 
-    Dwarf_Signed d_num_types = 0;
-    Dwarf_Type *d_types = NULL;
-    if (dwarf_get_pubtypes (d_debug,
-                            &d_types,
-                            &d_num_types,
-                            &d_error) != DW_DLV_OK) {
-        Dwarf_Error d_finish_error = DW_DLE_NE;
-        dwarf_globals_dealloc (d_debug, d_globals, d_num_globals);
-        dwarf_finish (d_debug, &d_finish_error);
-        close (fd);
-        dlclose (dl);
-        return luaL_error (L, "cannot read types (%s)", dw_errmsg (d_error));
+    switch (eol_typeinfo_type (T)) {
+#define SORT_KEY_CASE(suffix, name, ctype) case EOL_TYPE_ ## suffix:
+        INTEGER_S_TYPES (SORT_KEY_CASE)
+        case EOL_TYPE_ENUM:
+            key->kind = SORT_KEY_SIGNED;
+            break;
+        INTEGER_U_TYPES (SORT_KEY_CASE)
+        case EOL_TYPE_BOOL:
+            key->kind = SORT_KEY_UNSIGNED;
+            break;
+        FLOAT_TYPES (SORT_KEY_CASE)
+            key->kind = SORT_KEY_FLOAT;
+            break;
+#undef SORT_KEY_CASE
+        default:
+            typeinfo_push_stringrep (L, T, false);
+            luaL_error (L, "cannot sort by values of type '%s'",
+                        lua_tostring (L, -1));
     }
-    TRACE ("found %ld types\n", (long) d_num_types);
 
-#if EOL_TRACE > 1
-    for (Dwarf_Signed i = 0; i < d_num_types; i++) {
-        char *name = NULL;
-        Dwarf_Error d_name_error = DW_DLE_NE;
-        if (dwarf_pubtypename (d_types[i], &name, &d_name_error) == DW_DLV_OK) {
-            TRACE (">  [%li] %s\n", (long) i, name);
-            dwarf_dealloc (d_debug, name, DW_DLA_STRING);
-        } else {
-            TRACE (">  [%li] ERROR: %s\n", (long) i, dw_errmsg (d_name_error));
-        }
+    key->size = eol_typeinfo_sizeof (T);
+    if (key->size != 1 && key->size != 2 &&
+        key->size != 4 && key->size != 8) {
+        luaL_error (L, "cannot sort by values of size %d", (int) key->size);
     }
-#endif /* EOL_TRACE */
+    key->typeinfo = T;
+}
 
-    EolLibrary *el = calloc (1, sizeof (EolLibrary));
-    el->fd = fd;
-    el->dl = dl;
-    el->path = strdup (path);
-    el->d_debug = d_debug;
-    el->d_globals = d_globals;
-    el->d_num_globals = d_num_globals;
-    el->d_types = d_types;
-    el->d_num_types = d_num_types;
-    el->next = library_list;
-    library_list = el;
-    eol_type_cache_init (&el->type_cache);
-    library_push_userdata (L, el);
 
-    TRACE_PTR (>, EolLibrary, el, " [%s]\n", el->path);
+/* Maps the key value at "address" to its unsigned representation. */
+static inline uint64_t
+sort_key_value (const SortKey *key, const void *address)
+{
+    const uint32_t bits = key->size * 8;
+    const uint64_t sign = UINT64_C (1) << (bits - 1);
+    const uint64_t mask = (sign << 1) - 1;
+
+    uint64_t value;
+    switch (key->size) {
+        case 1: value = *ADDR_OFF (uint8_t,  address, 0); break;
+        case 2: value = *ADDR_OFF (uint16_t, address, 0); break;
+        case 4: value = *ADDR_OFF (uint32_t, address, 0); break;
+        default: value = *ADDR_OFF (uint64_t, address, 0);
+    }
 
-    return 1;
+    switch (key->kind) {
+        case SORT_KEY_SIGNED:
+            value ^= sign;
+            break;
+        case SORT_KEY_FLOAT:
+            /* Negative values are reversed; positive ones go after them. */
+            value = (value & sign) ? (~value & mask) : (value | sign);
+            break;
+        case SORT_KEY_UNSIGNED:
+            break;
+    }
+    return key->descending ? (~value & mask) : value;
 }
 
 
-static int
-eol_type (lua_State *L)
+static inline uint64_t
+sort_key_at (const SortKey *key, const EolView *view, uint32_t index)
 {
-    EolLibrary *el = to_eol_library (L, 1);
+    const size_t offset = (size_t) index * view->stride + key->offset;
+    return sort_key_value (key, ADDR_OFF (void, view->address, offset));
+}
 
-    luaL_checktype (L, 2, LUA_TSTRING);
-    const char *name = lua_tostring (L, 2);
 
-    Dwarf_Error d_error = DW_DLE_NE;
-    Dwarf_Off d_offset = library_get_tue_offset (el, name, &d_error);
-    if (d_offset == DW_DLV_BADOFFSET) {
-        if (d_error == DW_DLE_NE) {
-            /* No libdwarf error: the type was not found */
-            lua_pushnil (L);
-            return 1;
+/* Returns the sorted items, which are in "a" or "b". */
+static SortItem*
+sort_radix (SortItem *a, SortItem *b, uint32_t n_items, uint32_t key_size)
+{
+    for (uint32_t shift = 0; shift < key_size * 8; shift += 8) {
+        uint32_t count[256] = { 0 };
+        for (uint32_t i = 0; i < n_items; i++)
+            count[(a[i].key >> shift) & 0xFF]++;
+
+        /* Skip passes in which all the items have the same digit. */
+        if (count[(a[0].key >> shift) & 0xFF] == n_items)
+            continue;
+
+        uint32_t position = 0;
+        for (uint32_t d = 0; d < 256; d++) {
+            uint32_t c = count[d];
+            count[d] = position;
+            position += c;
         }
-        return luaL_error (L, "%s: could not look up DWARF TUE offset "
-                           "(library: %p; %s)", name, el, dw_errmsg (d_error));
+        for (uint32_t i = 0; i < n_items; i++)
+            b[count[(a[i].key >> shift) & 0xFF]++] = a[i];
+
+        SortItem *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    return a;
+}
+
+
+/*
+ * Usage: eol.sort(array [, field [, "desc"]])
+ *
+ * Sorts the elements in place. The sort is stable.
+ */
+static int
+eol_sort (lua_State *L)
+{
+    static const char *const orders[] = { "asc", "desc", NULL };
+
+    EolView view;
+    SortKey key;
+    view_from_value (L, 1, &view);
+    if (view.readonly)
+        return luaL_argerror (L, 1, "read-only elements");
+    sort_key_init (L, 2, &view, &key);
+    key.descending = luaL_checkoption (L, 3, "asc", orders) == 1;
+
+    if (view.n_items < 2)
+        return 0;
+
+    const size_t size = eol_typeinfo_sizeof (view.typeinfo);
+    SortItem *items = malloc (2 * sizeof (SortItem) * view.n_items);
+    void *records = malloc (size * view.n_items);
+    if (!items || !records) {
+        free (items);
+        free (records);
+        return luaL_error (L, "cannot allocate memory for sorting");
     }
 
-    const EolTypeInfo *typeinfo = library_lookup_type (el, d_offset, &d_error);
-    if (!typeinfo) {
-        return luaL_error (L, "%s: no type info (%s)",
-                           name, dw_errmsg (d_error));
+    for (uint32_t i = 0; i < view.n_items; i++) {
+        items[i].key = sort_key_at (&key, &view, i);
+        items[i].index = i;
+    }
+    SortItem *sorted = sort_radix (items, items + view.n_items,
+                                   view.n_items, key.size);
+
+    for (uint32_t i = 0; i < view.n_items; i++) {
+        memcpy (ADDR_OFF (void, records, i * size),
+                ADDR_OFF (void, view.address,
+                          (size_t) sorted[i].index * view.stride),
+                size);
+    }
+    if (view.stride == size) {
+        memcpy (view.address, records, size * view.n_items);
+    } else {
+        for (uint32_t i = 0; i < view.n_items; i++) {
+            memcpy (ADDR_OFF (void, view.address, (size_t) i * view.stride),
+                    ADDR_OFF (void, records, i * size),
+                    size);
+        }
     }
 
-#if EOL_TYPECACHE_STATS
-    TRACE ("@type-cache hits=%" PRIu64 " misses=%" PRIu64 "\n",
-           el->type_cache_hits, el->type_cache_misses);
-#endif /* EOL_TYPECACHE_STATS */
-
-    typeinfo_push_userdata (L, typeinfo);
-    return 1;
+    free (items);
+    free (records);
+    return 0;
 }
 
 
 /*
- * Usage: eol.sizeof(ct [, nelem])
+ * Usage: index = eol.bsearch(array, field, value [, "desc"])
  *
- * TODO: Handle second "nelem" parameter for VLAs.
+ * The array must be sorted by the field, in the given order. Returns the
+ * index of the first element with the value, or "nil" followed by the
+ * index where an element with the value would be inserted.
  */
 static int
-eol_sizeof (lua_State *L)
+eol_bsearch (lua_State *L)
 {
-    const EolTypeInfo *typeinfo = NULL;
+    static const char *const orders[] = { "asc", "desc", NULL };
+
+    EolView view;
+    SortKey key;
+    view_from_value (L, 1, &view);
+    sort_key_init (L, 2, &view, &key);
+    key.descending = luaL_checkoption (L, 4, "asc", orders) == 1;
+    luaL_checkany (L, 3);
+
+    uint64_t buffer = 0;
+    if (eol_typeinfo_is_enum (key.typeinfo))
+        enum_value_get (L, 3, key.size, &buffer);
+    else
+        (*cvalue_ops (key.typeinfo)->get) (L, 3, key.typeinfo, &buffer);
+    const uint64_t value = sort_key_value (&key, &buffer);
+
+    uint32_t low = 0, high = view.n_items;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (sort_key_at (&key, &view, mid) < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
 
-    EolVariable *ev;
-    if ((ev = luaL_testudata (L, 1, EOL_VARIABLE))) {
-        typeinfo = ev->typeinfo;
-    } else if (luaL_testudata (L, 1, EOL_FUNCTION)) {
-        /* Functions do not have a size, return "nil" */
-        lua_pushnil (L);
+    if (low < view.n_items && sort_key_at (&key, &view, low) == value) {
+        lua_pushinteger (L, low + 1);
         return 1;
-    } else {
-        typeinfo = to_eol_typeinfo (L, 1);
     }
+    lua_pushnil (L);
+    lua_pushinteger (L, low + 1);
+    return 2;
+}
 
-    CHECK_NOT_NULL (typeinfo);
-    if (eol_typeinfo_is_void (typeinfo)) {
-        lua_pushnil (L);
-    } else {
-        lua_pushinteger (L, eol_typeinfo_sizeof (typeinfo));
+
+/*
+ * State of the iterators returned by eol.walk(). The iterator function has
+ * the state as first upvalue, and the cursor variable as second upvalue
+ * when the nodes themselves are produced.
+ */
+typedef struct {
+    void              *node;         /* Next node, NULL at the end.     */
+    lua_Integer        count;
+    uint32_t           link_offset;
+    uint32_t           field_offset;
+    const EolTypeInfo *field_type;   /* NULL to produce the cursor.     */
+    bool               readonly;     /* The start node was read-only.   */
+} EolWalk;
+
+
+static int
+walk_next (lua_State *L)
+{
+    EolWalk *walk = lua_touserdata (L, lua_upvalueindex (1));
+    void *node = walk->node;
+    if (!node)
+        return 0;
+
+    /* Read the link first, so the loop body may free the node. */
+    walk->node = *ADDR_OFF (void*, node, walk->link_offset);
+    lua_pushinteger (L, ++walk->count);
+
+    if (walk->field_type) {
+        return 1 + cvalue_push_element (L, lua_upvalueindex (1),
+                                        walk->field_type,
+                                        ADDR_OFF (void, node,
+                                                  walk->field_offset),
+                                        walk->readonly);
     }
-    return 1;
+
+    lua_pushvalue (L, lua_upvalueindex (2));
+    EolVariable *cursor = lua_touserdata (L, -1);
+    cursor->address = node;
+    return 2;
 }
 
 
+/*
+ * Usage: for i, node in eol.walk(start, link [, field]) do ... end
+ *
+ * Follows the "link" member of each node, which must be a pointer to the
+ * same struct type, until it is NULL. The start can be a struct, a pointer
+ * to a struct, or "nil" (for an empty list). Each step produces the number
+ * of the node, and either the node or the value of its "field" member.
+ * The same variable is reused for all the nodes, so it must not be kept
+ * around after the step it is produced in.
+ */
 static int
-eol_cast (lua_State *L)
+eol_walk (lua_State *L)
 {
-    const EolTypeInfo *typeinfo = to_eol_typeinfo (L, 1);
-    EolVariable *ev = to_eol_variable (L, 2);
+    const char *link_name = luaL_checkstring (L, 2);
+    const char *field_name = luaL_optstring (L, 3, NULL);
 
-    variable_push_userdata (L,
-                            ev->library,
-                            typeinfo,
-                            ev->address,
-                            ev->name,
-                            VARIABLE_PUSH_NOCOPY);
+    EolWalk *walk = lua_newuserdata (L, sizeof (EolWalk));
+    memset (walk, 0x00, sizeof (EolWalk));
+    if (lua_isnil (L, 1)) {
+        lua_pushcclosure (L, walk_next, 1);
+        return 1;
+    }
+
+    EolVariable *ev = to_eol_variable (L, 1);
+    const EolTypeInfo *T = eol_typeinfo_get_non_synthetic (ev->typeinfo);
+    if (eol_typeinfo_is_pointer (T))
+        T = eol_typeinfo_get_non_synthetic (eol_typeinfo_base (T));
+    if (!eol_typeinfo_is_struct (T))
+        return luaL_argerror (L, 1, "struct or pointer to struct expected");
+
+    const EolTypeInfoMember *link =
+            eol_typeinfo_compound_const_named_member (T, link_name);
+    if (!link) {
+        typeinfo_push_stringrep (L, T, true);
+        return luaL_error (L, "%s: no such member in type '%s'",
+                           link_name, lua_tostring (L, -1));
+    }
+    const EolTypeInfo *link_type = eol_typeinfo_get_non_synthetic (link->typeinfo);
+    if (!eol_typeinfo_is_pointer (link_type) ||
+        !eol_typeinfo_equal (eol_typeinfo_get_non_synthetic (eol_typeinfo_base (link_type)), T)) {
+        typeinfo_push_stringrep (L, T, false);
+        return luaL_error (L, "%s: member is not a pointer to '%s'",
+                           link_name, lua_tostring (L, -1));
+    }
+
+    walk->node        = ev->address;
+    walk->link_offset = link->offset;
+    walk->readonly    = eol_typeinfo_is_readonly (ev->typeinfo);
+
+    if (field_name) {
+        const EolTypeInfoMember *field =
+                eol_typeinfo_compound_const_named_member (T, field_name);
+        if (!field) {
+            typeinfo_push_stringrep (L, T, true);
+            return luaL_error (L, "%s: no such member in type '%s'",
+                               field_name, lua_tostring (L, -1));
+        }
+        walk->field_offset = field->offset;
+        walk->field_type   = eol_typeinfo_get_non_synthetic (field->typeinfo);
+        lua_pushcclosure (L, walk_next, 1);
+    } else {
+        /* Keep the read-only qualifier, as for elements of variables. */
+        if (walk->readonly)
+            T = eol_type_cache_derived (EOL_TYPE_CONST, T, 0);
+        variable_push_userdata (L, NULL, T, ev->address, NULL,
+                                VARIABLE_PUSH_NOCOPY);
+        lua_pushcclosure (L, walk_next, 2);
+    }
     return 1;
 }
 
@@ -1712,15 +5134,30 @@ eol_typeof (lua_State *L)
     if (luaL_testudata (L, 1, EOL_TYPEINFO)) {
         lua_settop (L, 1);
     } else {
-        EolVariable *ev = luaL_testudata (L, 1, EOL_VARIABLE);
+        EolVariable *ev = test_eol_variable (L, 1);
         if (ev) {
             typeinfo_push_userdata (L, ev->typeinfo);
         } else {
             const char *name = luaL_checkstring (L, 1);
-            for (EolLibrary *el = library_list; el; el = el->next) {
+            for (EolLibrary *library = library_list; library;
+                 library = library->next) {
+                if (library->btf) {
+                    const EolTypeInfo *typeinfo;
+                    if (!library_btf_find_type (library, name, &typeinfo))
+                        continue;
+                    if (!typeinfo) {
+                        return luaL_error (L, "%s: no type info "
+                                           "(library: %p; BTF)",
+                                           name, library);
+                    }
+                    typeinfo_push_userdata (L, typeinfo);
+                    return 1;
+                }
+
+                EolLibrary *el;
                 Dwarf_Error d_error = DW_DLE_NE;
                 Dwarf_Off d_offset =
-                        library_get_tue_offset (el, name, &d_error);
+                        library_get_tue_offset (library, name, &el, &d_error);
                 if (d_offset == DW_DLV_BADOFFSET) {
                     if (d_error != DW_DLE_NE) {
                         return luaL_error (L, "%s: could not lookup DWARF TUE "
@@ -1761,7 +5198,7 @@ eol_offsetof (lua_State *L)
     const EolTypeInfo *typeinfo = NULL;
 
     EolVariable *ev;
-    if ((ev = luaL_testudata (L, 1, EOL_VARIABLE))) {
+    if ((ev = test_eol_variable (L, 1))) {
         typeinfo = ev->typeinfo;
     } else {
         typeinfo = to_eol_typeinfo (L, 1);
@@ -1777,11 +5214,11 @@ eol_offsetof (lua_State *L)
     if (lua_isinteger (L, 2)) {
         uint32_t n_members = eol_typeinfo_compound_n_members (typeinfo);
         lua_Integer index = luaL_checkinteger (L, 2);
-        if (index < 0) index += n_members;
+        if (index < 0) index += n_members + 1;
         if (index <= 0 || index > n_members) {
-            return luaL_error (L, "index %d out of bounds "
-                               "(effective=%d, length=%d)",
-                               luaL_checkinteger (L, 2), index, n_members);
+            return luaL_error (L, "index %I out of bounds "
+                               "(effective=%I, length=%d)",
+                               luaL_checkinteger (L, 2), index, (int) n_members);
         }
         member = eol_typeinfo_compound_const_member (typeinfo, index - 1);
     } else {
@@ -1806,7 +5243,7 @@ eol_alignof (lua_State *L)
     const EolTypeInfo *typeinfo = NULL;
 
     EolVariable *ev;
-    if ((ev = luaL_testudata (L, 1, EOL_VARIABLE))) {
+    if ((ev = test_eol_variable (L, 1))) {
         typeinfo = ev->typeinfo;
     } else {
         typeinfo = to_eol_typeinfo (L, 1);
@@ -1863,15 +5300,57 @@ eol_abi (lua_State *L)
 }
 
 
+/*
+ * Usage: previous = eol.wrapcache([enable])
+ */
+static int
+eol_wrapcache (lua_State *L)
+{
+    lua_rawgetp (L, LUA_REGISTRYINDEX, EOL_WRAPPER_CACHE);
+    const bool enabled = lua_istable (L, -1);
+    lua_pop (L, 1);
+
+    if (!lua_isnoneornil (L, 1)) {
+        luaL_checktype (L, 1, LUA_TBOOLEAN);
+        const bool enable = lua_toboolean (L, 1);
+        if (enable != enabled)
+            wrapper_cache_setup (L, enable);
+    }
+    lua_pushboolean (L, enabled);
+    return 1;
+}
+
+
 static const luaL_Reg eollib[] = {
-    { "load",     eol_load     },
-    { "type",     eol_type     },
-    { "sizeof",   eol_sizeof   },
-    { "typeof",   eol_typeof   },
-    { "offsetof", eol_offsetof },
-    { "alignof",  eol_alignof  },
-    { "cast",     eol_cast     },
-    { "abi",      eol_abi      },
+    { "load",      eol_load      },
+    { "type",      eol_type      },
+    { "sizeof",    eol_sizeof    },
+    { "typeof",    eol_typeof    },
+    { "offsetof",  eol_offsetof  },
+    { "alignof",   eol_alignof   },
+    { "cast",      eol_cast      },
+    { "abi",       eol_abi       },
+    { "wrapcache", eol_wrapcache },
+    { "path",      eol_path      },
+    { "pack",      eol_pack      },
+    { "unpack",    eol_unpack    },
+    { "mmap",      eol_mmap      },
+    { "shm",       eol_shm       },
+    { "shmunlink", eol_shmunlink },
+    { "alloc",     eol_alloc     },
+    { "arena",     eol_arena     },
+    { "gc",        eol_gc        },
+    { "copy",      eol_copy      },
+    { "move",      eol_move      },
+    { "fill",      eol_fill      },
+    { "compare",   eol_compare   },
+    { "reduce",    eol_reduce    },
+    { "dot",       eol_dot       },
+    { "axpy",      eol_axpy      },
+    { "convert",   eol_convert   },
+    { "sort",      eol_sort      },
+    { "bsearch",   eol_bsearch   },
+    { "walk",      eol_walk      },
     { NULL, NULL },
 };
 
@@ -1887,6 +5366,7 @@ luaopen_eol (lua_State *L)
 
     luaL_newlib (L, eollib);
     create_meta (L);
+    wrapper_cache_setup (L, true);
     return 1;
 }
 
@@ -1894,8 +5374,11 @@ luaopen_eol (lua_State *L)
 static Dwarf_Die
 lookup_die (EolLibrary  *el,
             const char  *name,
+            EolLibrary **owner,
             Dwarf_Error *d_error)
 {
+    *owner = el;
+
     /*
      * TODO: This performs a linear search. Try to find an alternative way,
      * e.g. using the (optional) DWARF information that correlates entry point
@@ -1938,6 +5421,11 @@ lookup_die (EolLibrary  *el,
         }
     }
 
+    /* The DIE may be in a split DWARF file. */
+    Dwarf_Off d_offset = library_split_lookup (el, name, false, owner, d_error);
+    if (d_offset != DW_DLV_BADOFFSET)
+        return library_fetch_die (*owner, d_offset, d_error);
+
     return NULL;
 }
 
@@ -1984,7 +5472,12 @@ library_lookup_type (EolLibrary  *library,
 #endif /* EOL_TYPECACHE_STATS */
         typeinfo = library_build_typeinfo (library, d_offset, d_error);
         CHECK_NOT_NULL (typeinfo);
-        eol_type_cache_add (&library->type_cache, d_offset, typeinfo);
+        /*
+         * Structs and unions add themselves to the cache before resolving
+         * their members, which may point back to them.
+         */
+        if (!eol_type_cache_lookup (&library->type_cache, d_offset))
+            eol_type_cache_add (&library->type_cache, d_offset, typeinfo);
     }
 #if EOL_TYPECACHE_STATS
     else library->type_cache_hits++;
@@ -1993,6 +5486,35 @@ library_lookup_type (EolLibrary  *library,
 }
 
 
+static const EolTypeInfo*
+base_type_typeinfo (uint64_t encoding,
+                    uint64_t byte_size)
+{
+#define TYPEINFO_ITEM(_, name, ctype) \
+        case sizeof (ctype):          \
+            return eol_typeinfo_ ## name;
+
+    switch (encoding) {
+        case DW_ATE_boolean:
+            return eol_typeinfo_bool;
+        case DW_ATE_float:
+            switch (byte_size) { FLOAT_TYPES (TYPEINFO_ITEM) }
+            break;
+        case DW_ATE_signed:
+        case DW_ATE_signed_char:
+            switch (byte_size) { INTEGER_S_TYPES (TYPEINFO_ITEM) }
+            break;
+        case DW_ATE_unsigned:
+        case DW_ATE_unsigned_char:
+            switch (byte_size) { INTEGER_U_TYPES (TYPEINFO_ITEM) }
+            break;
+    }
+#undef TYPEINFO_ITEM
+
+    return NULL;
+}
+
+
 static const EolTypeInfo*
 library_build_base_type_typeinfo (EolLibrary  *library,
                                   Dwarf_Die    d_type_die,
@@ -2016,29 +5538,10 @@ library_build_base_type_typeinfo (EolLibrary  *library,
                                d_error))
             return NULL;
 
-#define TYPEINFO_ITEM(_, name, ctype) \
-        case sizeof (ctype):          \
-            return eol_typeinfo_ ## name;
-
-    switch (d_encoding) {
-        case DW_ATE_boolean:
-            return eol_typeinfo_bool;
-        case DW_ATE_float:
-            switch (d_byte_size) { FLOAT_TYPES (TYPEINFO_ITEM) }
-            break;
-        case DW_ATE_signed:
-        case DW_ATE_signed_char:
-            switch (d_byte_size) { INTEGER_S_TYPES (TYPEINFO_ITEM) }
-            break;
-        case DW_ATE_unsigned:
-        case DW_ATE_unsigned_char:
-            switch (d_byte_size) { INTEGER_U_TYPES (TYPEINFO_ITEM) }
-            break;
-    }
-#undef TYPEINFO_ITEM
-
-    CHECK_UNREACHABLE ();
-    return NULL;
+    const EolTypeInfo *typeinfo = base_type_typeinfo (d_encoding, d_byte_size);
+    if (!typeinfo)
+        CHECK_UNREACHABLE ();
+    return typeinfo;
 }
 
 
@@ -2216,6 +5719,7 @@ typedef EolTypeInfo* (*NewCompoundCb) (const char* name,
 
 static EolTypeInfo*
 compound_type_members (EolLibrary   *library,
+                       Dwarf_Off     compound_offset,
                        Dwarf_Die     d_member_die,
                        Dwarf_Error  *d_error,
                        NewCompoundCb compound_new,
@@ -2228,8 +5732,16 @@ compound_type_members (EolLibrary   *library,
     CHECK_NOT_NULL (compound_new);
 
     if (!d_member_die) {
-        /* No more entries: create type information. */
-        return (*compound_new) (compound_name, compound_size, index);
+        /*
+         * No more entries: create type information, and cache it before
+         * the types of the members are resolved while unwinding, so that
+         * members which point back to it find it in the cache.
+         */
+        EolTypeInfo *typeinfo = (*compound_new) (compound_name,
+                                                 compound_size,
+                                                 index);
+        eol_type_cache_add (&library->type_cache, compound_offset, typeinfo);
+        return typeinfo;
     }
 
     DW_TRACE_DIE ("\n", library->d_debug, d_member_die);
@@ -2243,7 +5755,6 @@ compound_type_members (EolLibrary   *library,
 
     dw_lstring_t member_name       = { library->d_debug };
     Dwarf_Unsigned d_member_offset = DW_DLV_BADOFFSET;
-    const EolTypeInfo *typeinfo    = NULL;
 
     if (d_tag == DW_TAG_member) {
         if (!dw_die_get_uint_attr (library->d_debug,
@@ -2257,16 +5768,6 @@ compound_type_members (EolLibrary   *library,
             return NULL;
         }
 
-        if (!(typeinfo = library_fetch_die_type_ref_cached (library,
-                                                            d_member_die,
-                                                            DW_AT_type,
-                                                            d_error))) {
-            DW_TRACE_DIE_ERROR ("%s: cannot get type information\n",
-                                library->d_debug, d_member_die, *d_error,
-                                compound_name ? compound_name : "@");
-            return NULL;
-        }
-
         *d_error = DW_DLE_NE;
         member_name.string = dw_die_name (d_member_die, d_error);
         if (!member_name.string && *d_error != DW_DLE_NE) {
@@ -2295,14 +5796,32 @@ compound_type_members (EolLibrary   *library,
         CHECK (next_member.die == NULL);
     }
 
+    const bool is_member = (d_tag == DW_TAG_member);
     EolTypeInfo *result = compound_type_members (library,
+                                                 compound_offset,
                                                  next_member.die,
                                                  d_error,
                                                  compound_new,
                                                  compound_name,
                                                  compound_size,
-                                                 typeinfo ? index + 1 : index);
-    if (result && typeinfo) {
+                                                 is_member ? index + 1 : index);
+    if (result && is_member) {
+        const EolTypeInfo *typeinfo =
+                library_fetch_die_type_ref_cached (library,
+                                                   d_member_die,
+                                                   DW_AT_type,
+                                                   d_error);
+        if (!typeinfo) {
+            DW_TRACE_DIE_ERROR ("%s: cannot get type information\n",
+                                library->d_debug, d_member_die, *d_error,
+                                compound_name ? compound_name : "@");
+            /*
+             * Other types may point to the cached compound already: keep
+             * it, with the member left as an opaque value.
+             */
+            typeinfo = eol_typeinfo_void;
+        }
+
         EolTypeInfoMember *member = eol_typeinfo_compound_member (result, index);
         member->name     = member_name.string ? strdup (member_name.string) : NULL;
         member->offset   = (uint32_t) d_member_offset;
@@ -2351,6 +5870,7 @@ library_build_union_type_typeinfo (EolLibrary  *library,
         return NULL;
 
     return compound_type_members (library,
+                                  dw_die_offset (d_type_die, d_error),
                                   child.die,
                                   d_error,
                                   eol_typeinfo_new_union,
@@ -2530,43 +6050,298 @@ library_build_structure_type_typeinfo (EolLibrary  *library,
     CHECK_NOT_NULL (d_error);
     CHECK (*d_error == DW_DLE_NE);
 
-    dw_lstring_t name = {
-        library->d_debug,
-        dw_die_name (d_type_die, d_error),
-    };
-    if (!name.string && *d_error != DW_DLE_NE) {
-        TRACE ("cannot get TUE DW_AT_name (%s)\n", dw_errmsg (*d_error));
-        return NULL;
-    }
+    dw_lstring_t name = {
+        library->d_debug,
+        dw_die_name (d_type_die, d_error),
+    };
+    if (!name.string && *d_error != DW_DLE_NE) {
+        TRACE ("cannot get TUE DW_AT_name (%s)\n", dw_errmsg (*d_error));
+        return NULL;
+    }
+
+    Dwarf_Unsigned d_byte_size;
+    if (!dw_die_get_uint_attr (library->d_debug,
+                               d_type_die,
+                               DW_AT_byte_size,
+                               &d_byte_size,
+                               d_error)) {
+        return eol_typeinfo_new_struct (name.string, 0, 0);
+    }
+
+    dw_ldie_t child = { library->d_debug };
+    int status = dwarf_child (d_type_die, &child.die, d_error);
+    if (status == DW_DLV_ERROR) {
+        DW_TRACE_DIE_ERROR ("cannot obtain child\n",
+                            library->d_debug, d_type_die, *d_error);
+        return NULL;
+    }
+
+    if (status == DW_DLV_NO_ENTRY) {
+        CHECK (child.die == NULL);
+    }
+
+    return compound_type_members (library,
+                                  dw_die_offset (d_type_die, d_error),
+                                  child.die,
+                                  d_error,
+                                  eol_typeinfo_new_struct,
+                                  name.string,
+                                  d_byte_size,
+                                  0);
+}
+
+
+/*
+ * Builders using the in-tree DWARF reader (see eol-dwarf.h), which avoid
+ * allocating libdwarf objects for each DIE, attribute, and string. They
+ * return NULL for anything they do not handle, and in that case the type
+ * information is built by the functions above using libdwarf.
+ */
+static const EolTypeInfo*
+dwarf_fetch_die_type_ref_cached (EolLibrary        *library,
+                                 const EolDwarfDie *die,
+                                 Dwarf_Error       *d_error)
+{
+    uint64_t offset;
+    if (eol_dwarf_die_ref (library->dwarf, die, DW_AT_type,
+                           &offset) != EOL_DWARF_OK)
+        return NULL;
+    return library_lookup_type (library, offset, d_error);
+}
+
+
+static bool
+dwarf_array_n_items (EolDwarf          *dwarf,
+                     const EolDwarfDie *die,
+                     uint64_t          *n_items)
+{
+    EolDwarfDie child, next;
+    EolDwarfStatus status = eol_dwarf_die_child (dwarf, die, &child);
+    while (status == EOL_DWARF_OK) {
+        if (child.tag == DW_TAG_subrange_type) {
+            if (eol_dwarf_die_uint (dwarf, &child, DW_AT_count,
+                                    n_items) == EOL_DWARF_OK)
+                return true;
+            if (eol_dwarf_die_uint (dwarf, &child, DW_AT_upper_bound,
+                                    n_items) == EOL_DWARF_OK) {
+                ++*n_items;
+                return true;
+            }
+        }
+        status = eol_dwarf_die_sibling (dwarf, &child, &next);
+        child = next;
+    }
+    return false;
+}
+
+
+static EolTypeInfo*
+dwarf_build_compound_typeinfo (EolLibrary        *library,
+                               Dwarf_Off          d_offset,
+                               const EolDwarfDie *die,
+                               Dwarf_Error       *d_error)
+{
+    EolDwarf *dwarf = library->dwarf;
+
+    const char *name = NULL;
+    if (eol_dwarf_die_name (dwarf, die, &name) == EOL_DWARF_ERROR)
+        return NULL;
+
+    NewCompoundCb compound_new;
+    Dwarf_Half member_tag;
+    switch (die->tag) {
+        case DW_TAG_structure_type:
+            compound_new = eol_typeinfo_new_struct;
+            member_tag = DW_TAG_member;
+            break;
+        case DW_TAG_union_type:
+            compound_new = eol_typeinfo_new_union;
+            member_tag = DW_TAG_member;
+            break;
+        case DW_TAG_enumeration_type:
+            compound_new = eol_typeinfo_new_enum;
+            member_tag = DW_TAG_enumerator;
+            break;
+        default:
+            CHECK_UNREACHABLE ();
+            return NULL;
+    }
+
+    uint64_t byte_size;
+    switch (eol_dwarf_die_uint (dwarf, die, DW_AT_byte_size, &byte_size)) {
+        case EOL_DWARF_OK:
+            break;
+        case EOL_DWARF_NO_ENTRY:
+            /* Declaration of an opaque structure. */
+            if (die->tag == DW_TAG_structure_type)
+                return eol_typeinfo_new_struct (name, 0, 0);
+            /* fall-through */
+        default:
+            return NULL;
+    }
+
+    /* First pass: count members. */
+    EolDwarfDie child, next;
+    uint32_t n_members = 0;
+    EolDwarfStatus status = eol_dwarf_die_child (dwarf, die, &child);
+    while (status == EOL_DWARF_OK) {
+        if (child.tag == member_tag)
+            n_members++;
+        status = eol_dwarf_die_sibling (dwarf, &child, &next);
+        child = next;
+    }
+    if (status == EOL_DWARF_ERROR)
+        return NULL;
+
+    /* Second pass: fill-in members. */
+    EolTypeInfo *typeinfo = (*compound_new) (name, byte_size, n_members);
+    uint32_t index = 0;
+    status = eol_dwarf_die_child (dwarf, die, &child);
+    while (status == EOL_DWARF_OK && index < n_members) {
+        if (child.tag == member_tag) {
+            const char *member_name = NULL;
+            if (eol_dwarf_die_name (dwarf, &child,
+                                    &member_name) == EOL_DWARF_ERROR)
+                goto error;
+
+            EolTypeInfoMember *member =
+                    eol_typeinfo_compound_member (typeinfo, index++);
+
+            if (member_tag == DW_TAG_enumerator) {
+                int64_t value;
+                if (!member_name ||
+                    eol_dwarf_die_sint (dwarf, &child, DW_AT_const_value,
+                                        &value) != EOL_DWARF_OK)
+                    goto error;
+                member->value = value;
+            } else {
+                uint64_t offset = 0;
+                switch (eol_dwarf_die_member_location (dwarf, &child, &offset)) {
+                    case EOL_DWARF_OK:
+                        break;
+                    case EOL_DWARF_NO_ENTRY:
+                        /* Members of unions may omit their location. */
+                        if (die->tag == DW_TAG_union_type)
+                            break;
+                        /* fall-through */
+                    default:
+                        goto error;
+                }
+                member->offset = (uint32_t) offset;
+            }
+            member->name = member_name ? strdup (member_name) : NULL;
+        }
+        status = eol_dwarf_die_sibling (dwarf, &child, &next);
+        child = next;
+    }
+    if (status == EOL_DWARF_ERROR)
+        goto error;
+
+    if (member_tag == DW_TAG_enumerator)
+        return typeinfo;
+
+    /*
+     * Third pass: resolve the types of the members. The type is cached
+     * beforehand, so members which point back to it (e.g. the links of a
+     * list) find it instead of building it again and again.
+     */
+    eol_type_cache_add (&library->type_cache, d_offset, typeinfo);
+    index = 0;
+    status = eol_dwarf_die_child (dwarf, die, &child);
+    while (status == EOL_DWARF_OK && index < n_members) {
+        if (child.tag == member_tag) {
+            EolTypeInfoMember *member =
+                    eol_typeinfo_compound_member (typeinfo, index++);
+            /*
+             * Other types may point to the cached type already: members
+             * of unsupported types are left as opaque values instead.
+             */
+            if (!(member->typeinfo =
+                  dwarf_fetch_die_type_ref_cached (library, &child,
+                                                   d_error)))
+                member->typeinfo = eol_typeinfo_void;
+        }
+        status = eol_dwarf_die_sibling (dwarf, &child, &next);
+        child = next;
+    }
+    return typeinfo;
+
+error:
+    eol_typeinfo_free (typeinfo);
+    return NULL;
+}
+
+
+static const EolTypeInfo*
+library_build_typeinfo_fast (EolLibrary  *library,
+                             Dwarf_Off    d_offset,
+                             Dwarf_Error *d_error)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (d_error);
+
+    EolDwarf *dwarf = library->dwarf;
+    EolDwarfDie die;
+    if (!dwarf || eol_dwarf_die (dwarf, d_offset, &die) != EOL_DWARF_OK)
+        return NULL;
+
+    const EolTypeInfo *base;
+    const char *name;
+    uint64_t value, offset;
+
+    switch (die.tag) {
+        case DW_TAG_base_type:
+            if (eol_dwarf_die_uint (dwarf, &die, DW_AT_encoding,
+                                    &value) != EOL_DWARF_OK ||
+                eol_dwarf_die_uint (dwarf, &die, DW_AT_byte_size,
+                                    &offset) != EOL_DWARF_OK)
+                return NULL;
+            return base_type_typeinfo (value, offset);
+
+        case DW_TAG_typedef:
+            if (eol_dwarf_die_name (dwarf, &die, &name) != EOL_DWARF_OK ||
+                !(base = dwarf_fetch_die_type_ref_cached (library, &die,
+                                                          d_error)))
+                return NULL;
+            return eol_typeinfo_new_typedef (base, name);
+
+        case DW_TAG_const_type:
+            if (!(base = dwarf_fetch_die_type_ref_cached (library, &die,
+                                                          d_error)))
+                return NULL;
+            return eol_typeinfo_new_const (base);
+
+        case DW_TAG_pointer_type:
+            switch (eol_dwarf_die_ref (dwarf, &die, DW_AT_type, &offset)) {
+                case EOL_DWARF_NO_ENTRY:
+                    return eol_typeinfo_pointer;
+                case EOL_DWARF_OK:
+                    base = library_lookup_type (library, offset, d_error);
+                    return base ? eol_typeinfo_new_pointer (base) : NULL;
+                default:
+                    return NULL;
+            }
+
+        case DW_TAG_array_type:
+            if (!dwarf_array_n_items (dwarf, &die, &value) ||
+                !(base = dwarf_fetch_die_type_ref_cached (library, &die,
+                                                          d_error)))
+                return NULL;
+            return eol_typeinfo_new_array (base, value);
 
-    Dwarf_Unsigned d_byte_size;
-    if (!dw_die_get_uint_attr (library->d_debug,
-                               d_type_die,
-                               DW_AT_byte_size,
-                               &d_byte_size,
-                               d_error)) {
-        return eol_typeinfo_new_struct (name.string, 0, 0);
-    }
+        case DW_TAG_structure_type:
+        case DW_TAG_union_type:
+        case DW_TAG_enumeration_type:
+            return dwarf_build_compound_typeinfo (library, d_offset,
+                                                  &die, d_error);
 
-    dw_ldie_t child = { library->d_debug };
-    int status = dwarf_child (d_type_die, &child.die, d_error);
-    if (status == DW_DLV_ERROR) {
-        DW_TRACE_DIE_ERROR ("cannot obtain child\n",
-                            library->d_debug, d_type_die, *d_error);
-        return NULL;
-    }
+        case DW_TAG_subroutine_type:
+            TRACE (TODO YELLOW "DW_TAG_subroutine_type" NORMAL "\n");
+            return eol_typeinfo_void;
 
-    if (status == DW_DLV_NO_ENTRY) {
-        CHECK (child.die == NULL);
+        default:
+            return NULL;
     }
-
-    return compound_type_members (library,
-                                  child.die,
-                                  d_error,
-                                  eol_typeinfo_new_struct,
-                                  name.string,
-                                  d_byte_size,
-                                  0);
 }
 
 
@@ -2579,10 +6354,15 @@ library_build_typeinfo (EolLibrary  *library,
     CHECK_SIZE_NE (DW_DLV_BADOFFSET, d_offset);
     CHECK_NOT_NULL (d_error);
 
+    const EolTypeInfo *result = library_build_typeinfo_fast (library,
+                                                             d_offset,
+                                                             d_error);
+    if (result)
+        return result;
+
     Dwarf_Die d_type_die = library_fetch_die (library, d_offset, d_error);
     if (!d_type_die) return NULL;
 
-    const EolTypeInfo *result = NULL;
     Dwarf_Half d_tag;
     if (dwarf_tag (d_type_die, &d_tag, d_error) == DW_DLV_OK) {
         switch (d_tag) {
@@ -2616,15 +6396,220 @@ library_build_typeinfo (EolLibrary  *library,
 }
 
 
+/*
+ * Builders using BTF type information. BTF has no representation for some
+ * of the things supported by DWARF (e.g. function types), and a few which
+ * Eöl does not support (e.g. "volatile" and "restrict" qualifiers), which
+ * are skipped over.
+ */
+static EolTypeInfo*
+btf_build_compound_typeinfo (EolLibrary       *library,
+                             uint32_t          id,
+                             const EolBtfType *type)
+{
+    NewCompoundCb compound_new;
+    switch (type->kind) {
+        case EOL_BTF_KIND_STRUCT:
+            compound_new = eol_typeinfo_new_struct;
+            break;
+        case EOL_BTF_KIND_UNION:
+            compound_new = eol_typeinfo_new_union;
+            break;
+        case EOL_BTF_KIND_ENUM:
+        case EOL_BTF_KIND_ENUM64:
+            compound_new = eol_typeinfo_new_enum;
+            break;
+        default:
+            CHECK_UNREACHABLE ();
+            return NULL;
+    }
+
+    EolTypeInfo *typeinfo = (*compound_new) (type->name,
+                                             type->size,
+                                             type->vlen);
+    EolBtfMember m;
+    for (uint32_t i = 0; i < type->vlen; i++) {
+        if (!eol_btf_member (library->btf, id, i, &m))
+            goto error;
+
+        EolTypeInfoMember *member = eol_typeinfo_compound_member (typeinfo, i);
+        if (compound_new == eol_typeinfo_new_enum) {
+            if (!m.name)
+                goto error;
+            member->value = m.value;
+        } else {
+            /* Bit fields are not supported. */
+            if (m.bit_size || m.bit_offset % 8)
+                goto error;
+            member->offset = m.bit_offset / 8;
+        }
+        member->name = m.name ? strdup (m.name) : NULL;
+    }
+
+    if (compound_new == eol_typeinfo_new_enum)
+        return typeinfo;
+
+    /*
+     * Cache the type before resolving the types of the members, which may
+     * point back to it (e.g. the links of a list).
+     */
+    eol_type_cache_add (&library->type_cache, id, typeinfo);
+    for (uint32_t i = 0; i < type->vlen; i++) {
+        EolTypeInfoMember *member = eol_typeinfo_compound_member (typeinfo, i);
+        if (!eol_btf_member (library->btf, id, i, &m) ||
+            !(member->typeinfo = library_btf_lookup_type (library, m.type))) {
+            TRACE ("%s: cannot build type of member %" PRIu32 "\n",
+                   type->name ? type->name : "@", i);
+            /*
+             * Other types may point to the cached type already: keep it,
+             * with the member left as an opaque value.
+             */
+            member->typeinfo = eol_typeinfo_void;
+        }
+    }
+    return typeinfo;
+
+error:
+    TRACE ("%s: cannot build BTF type %" PRIu32 "\n",
+           type->name ? type->name : "@", id);
+    eol_typeinfo_free (typeinfo);
+    return NULL;
+}
+
+
+static const EolTypeInfo*
+library_btf_build_typeinfo (EolLibrary *library,
+                            uint32_t    id)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (library->btf);
+
+    EolBtfType type;
+    if (!eol_btf_type (library->btf, id, &type))
+        return NULL;
+
+    const EolTypeInfo *base;
+    switch (type.kind) {
+        case EOL_BTF_KIND_INT:
+            if (type.encoding & EOL_BTF_INT_BOOL)
+                return base_type_typeinfo (DW_ATE_boolean, type.size);
+            return base_type_typeinfo ((type.encoding & EOL_BTF_INT_SIGNED)
+                                       ? DW_ATE_signed : DW_ATE_unsigned,
+                                       type.size);
+
+        case EOL_BTF_KIND_FLOAT:
+            return base_type_typeinfo (DW_ATE_float, type.size);
+
+        case EOL_BTF_KIND_PTR:
+            if (type.type == 0)
+                return eol_typeinfo_pointer;
+            base = library_btf_lookup_type (library, type.type);
+            return base ? eol_typeinfo_new_pointer (base) : NULL;
+
+        case EOL_BTF_KIND_ARRAY:
+            base = library_btf_lookup_type (library, type.type);
+            return base ? eol_typeinfo_new_array (base, type.n_items) : NULL;
+
+        case EOL_BTF_KIND_TYPEDEF:
+            base = library_btf_lookup_type (library, type.type);
+            return (base && type.name)
+                ? eol_typeinfo_new_typedef (base, type.name) : NULL;
+
+        case EOL_BTF_KIND_CONST:
+            base = library_btf_lookup_type (library, type.type);
+            return base ? eol_typeinfo_new_const (base) : NULL;
+
+        case EOL_BTF_KIND_VOLATILE:
+        case EOL_BTF_KIND_RESTRICT:
+        case EOL_BTF_KIND_TYPE_TAG:
+            return library_btf_lookup_type (library, type.type);
+
+        case EOL_BTF_KIND_FWD:
+            /* Declaration of an opaque type. */
+            return type.kind_flag ? eol_typeinfo_new_union (type.name, 0, 0)
+                                  : eol_typeinfo_new_struct (type.name, 0, 0);
+
+        case EOL_BTF_KIND_STRUCT:
+        case EOL_BTF_KIND_UNION:
+        case EOL_BTF_KIND_ENUM:
+        case EOL_BTF_KIND_ENUM64:
+            return btf_build_compound_typeinfo (library, id, &type);
+
+        case EOL_BTF_KIND_FUNC_PROTO:
+            /* Same as DW_TAG_subroutine_type, see library_build_typeinfo() */
+            return eol_typeinfo_void;
+
+        default:
+            TRACE ("unsupported BTF kind %u (type %" PRIu32 ")\n",
+                   (unsigned) type.kind, id);
+            return NULL;
+    }
+}
+
+
+static const EolTypeInfo*
+library_btf_lookup_type (EolLibrary *library,
+                         uint32_t    id)
+{
+    CHECK_NOT_NULL (library);
+
+    /* The type id zero is always "void". */
+    if (id == 0)
+        return eol_typeinfo_void;
+
+    const EolTypeInfo *typeinfo =
+            eol_type_cache_lookup (&library->type_cache, id);
+    if (!typeinfo) {
+#if EOL_TYPECACHE_STATS
+        library->type_cache_misses++;
+#endif /* EOL_TYPECACHE_STATS */
+        if ((typeinfo = library_btf_build_typeinfo (library, id)) &&
+            !eol_type_cache_lookup (&library->type_cache, id))
+            eol_type_cache_add (&library->type_cache, id, typeinfo);
+    }
+#if EOL_TYPECACHE_STATS
+    else library->type_cache_hits++;
+#endif /* EOL_TYPECACHE_STATS */
+    return typeinfo;
+}
+
+
+/*
+ * Returns false if there is no type with the given name. Otherwise the
+ * type information is stored in "typeinfo", which may be NULL if it could
+ * not be built.
+ */
+static bool
+library_btf_find_type (EolLibrary         *library,
+                       const char         *name,
+                       const EolTypeInfo **typeinfo)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (name);
+    CHECK_NOT_NULL (typeinfo);
+
+    uint32_t id;
+    if (!eol_btf_find (library->btf, name, EOL_BTF_LOOKUP_TYPE, &id))
+        return false;
+
+    *typeinfo = library_btf_lookup_type (library, id);
+    return true;
+}
+
+
 static Dwarf_Off
 library_get_tue_offset (EolLibrary  *library,
                         const char  *name,
+                        EolLibrary **owner,
                         Dwarf_Error *d_error)
 {
     CHECK_NOT_NULL (library);
     CHECK_NOT_NULL (name);
+    CHECK_NOT_NULL (owner);
     CHECK_NOT_NULL (d_error);
 
+    *owner = library;
+
     /*
      * TODO: This performs a linear search. Consider using a global type names
      *       cache -- likely, a hash table.
@@ -2656,6 +6641,440 @@ library_get_tue_offset (EolLibrary  *library,
         }
     }
 
+    /* The type may be in a split DWARF file. */
+    return library_split_lookup (library, name, true, owner, d_error);
+}
+
+
+/*
+ * Split DWARF support. The skeleton units are scanned the first time that
+ * a lookup fails in the library itself, and split files are opened only
+ * when a lookup needs a unit from them. The ".debug_gnu_pubnames" and
+ * ".debug_gnu_pubtypes" sections (from "-ggnu-pubnames") are used, when
+ * available, to find out which unit contains a name without opening them.
+ */
+#ifndef DW_AT_dwo_name
+#define DW_AT_dwo_name 0x76
+#endif /* !DW_AT_dwo_name */
+
+#ifndef DW_AT_GNU_dwo_name
+#define DW_AT_GNU_dwo_name 0x2130
+#endif /* !DW_AT_GNU_dwo_name */
+
+#ifndef DW_AT_GNU_dwo_id
+#define DW_AT_GNU_dwo_id 0x2131
+#endif /* !DW_AT_GNU_dwo_id */
+
+
+/*
+ * Iterates over the units of a library (or split file). Note that this
+ * must always be done until dwarf_next_cu_header_c() reports the end, so
+ * the next iteration starts again from the first unit.
+ */
+#define SPLIT_UNIT_ITERATE_BEGIN(library, d_cu_die, d_offset, d_dwo_id)        \
+    do {                                                                       \
+        Dwarf_Error d_iter_error = DW_DLE_NE;                                  \
+        Dwarf_Unsigned d_next_offset = 0;                                      \
+        for (Dwarf_Off d_offset = 0;; d_offset = d_next_offset) {              \
+            Dwarf_Unsigned d_header_length, d_type_offset;                     \
+            Dwarf_Half d_version, d_address_size, d_length_size, d_ext_size;   \
+            Dwarf_Off d_abbrev_offset;                                         \
+            Dwarf_Sig8 d_signature;                                            \
+            memset (&d_signature, 0x00, sizeof (Dwarf_Sig8));                  \
+            if (dwarf_next_cu_header_c ((library)->d_debug, true,              \
+                                        &d_header_length, &d_version,          \
+                                        &d_abbrev_offset, &d_address_size,     \
+                                        &d_length_size, &d_ext_size,           \
+                                        &d_signature, &d_type_offset,          \
+                                        &d_next_offset,                        \
+                                        &d_iter_error) != DW_DLV_OK)           \
+                break;                                                         \
+            dw_ldie_t d_cu_die = { (library)->d_debug };                       \
+            if (dwarf_siblingof ((library)->d_debug, NULL,                     \
+                                 &d_cu_die.die, &d_iter_error) != DW_DLV_OK)   \
+                continue;                                                      \
+            uint64_t d_dwo_id;                                                 \
+            memcpy (&d_dwo_id, &d_signature, sizeof (uint64_t));               \
+            if (d_dwo_id == 0) {                                               \
+                Dwarf_Unsigned d_value;                                        \
+                if (dw_die_get_uint_attr ((library)->d_debug, d_cu_die.die,    \
+                                          DW_AT_GNU_dwo_id, &d_value,          \
+                                          &d_iter_error))                      \
+                    d_dwo_id = d_value;                                        \
+            }
+
+#define SPLIT_UNIT_ITERATE_END \
+        }                      \
+    } while (0)
+
+
+static void
+library_find_split_units (EolLibrary *library)
+{
+    CHECK_NOT_NULL (library);
+
+    library->split_scanned = true;
+    size_t n_alloc = 0;
+
+    SPLIT_UNIT_ITERATE_BEGIN (library, cu, d_offset, dwo_id)
+    {
+        Dwarf_Error d_error = DW_DLE_NE;
+        dw_lstring_t dwo_name = {
+            library->d_debug,
+            dw_die_get_string_attr (library->d_debug, cu.die,
+                                    DW_AT_dwo_name, &d_error)
+        };
+        if (!dwo_name.string) {
+            dwo_name.string = dw_die_get_string_attr (library->d_debug,
+                                                      cu.die,
+                                                      DW_AT_GNU_dwo_name,
+                                                      &d_error);
+        }
+        if (!dwo_name.string)
+            continue;
+
+        dw_lstring_t comp_dir = {
+            library->d_debug,
+            dw_die_get_string_attr (library->d_debug, cu.die,
+                                    DW_AT_comp_dir, &d_error)
+        };
+
+        if (library->n_split_units == n_alloc) {
+            n_alloc = n_alloc ? n_alloc * 2 : 8;
+            library->split_units = realloc (library->split_units,
+                                            n_alloc * sizeof (EolSplitUnit));
+        }
+
+        EolSplitUnit *unit = &library->split_units[library->n_split_units++];
+        memset (unit, 0x00, sizeof (EolSplitUnit));
+        unit->skeleton_offset = d_offset;
+        unit->dwo_id = dwo_id;
+        unit->dwo_name = strdup (dwo_name.string);
+        unit->comp_dir = comp_dir.string ? strdup (comp_dir.string) : NULL;
+        unit->cu_offset = DW_DLV_BADOFFSET;
+        unit->cu_die_offset = DW_DLV_BADOFFSET;
+
+        TRACE ("%s: split unit %#lx -> %s\n", library->path,
+               (unsigned long) d_offset, unit->dwo_name);
+    }
+    SPLIT_UNIT_ITERATE_END;
+}
+
+
+/*
+ * Split files are searched for in the same way as GDB does: a package
+ * named like the library with a ".dwp" suffix takes precedence, and then
+ * the ".dwo" file is searched for relative to the compilation directory,
+ * and in the directory where the library is.
+ */
+static bool
+library_split_unit_path (EolLibrary         *library,
+                         const EolSplitUnit *unit,
+                         char                path[PATH_MAX])
+{
+    if (snprintf (path, PATH_MAX, "%s.dwp", library->path) < PATH_MAX &&
+        access (path, R_OK) == 0)
+        return true;
+
+    if (unit->dwo_name[0] == '/') {
+        if (snprintf (path, PATH_MAX, "%s", unit->dwo_name) < PATH_MAX &&
+            access (path, R_OK) == 0)
+            return true;
+    } else if (unit->comp_dir) {
+        if (snprintf (path, PATH_MAX, "%s/%s",
+                      unit->comp_dir, unit->dwo_name) < PATH_MAX &&
+            access (path, R_OK) == 0)
+            return true;
+    }
+
+    const char *base_name = strrchr (unit->dwo_name, '/');
+    base_name = base_name ? base_name + 1 : unit->dwo_name;
+    const char *slash = strrchr (library->path, '/');
+    const int dir_length = slash ? (int) (slash - library->path) : 1;
+    const char *dir = slash ? library->path : ".";
+
+    return snprintf (path, PATH_MAX, "%.*s/%s",
+                     dir_length, dir, base_name) < PATH_MAX &&
+           access (path, R_OK) == 0;
+}
+
+
+static EolLibrary*
+library_open_split_unit (EolLibrary   *library,
+                         EolSplitUnit *unit,
+                         Dwarf_Error  *d_error)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (unit);
+    CHECK_NOT_NULL (d_error);
+
+    if (unit->file)
+        return unit->file;
+
+    char path[PATH_MAX];
+    if (!library_split_unit_path (library, unit, path)) {
+        TRACE ("%s: could not find split file for %s\n",
+               library->path, unit->dwo_name);
+        return NULL;
+    }
+
+    EolLibrary *file;
+    for (file = library->split_files; file; file = file->next)
+        if (string_equal (path, file->path))
+            break;
+
+    if (!file) {
+        EolElf *elf = eol_elf_open (path);
+        if (!elf) {
+            TRACE ("%s: cannot open (%s)\n", path, strerror (errno));
+            return NULL;
+        }
+
+        Dwarf_Debug d_debug;
+        Dwarf_Obj_Access_Interface *d_access;
+        if (dw_elf_init (elf, &d_access, &d_debug, d_error) != DW_DLV_OK) {
+            TRACE ("%s: cannot read (%s)\n", path, dw_errmsg (*d_error));
+            eol_elf_close (elf);
+            return NULL;
+        }
+
+        file = calloc (1, sizeof (EolLibrary));
+        file->elf = elf;
+        file->dwarf = eol_dwarf_new (elf);
+        file->path = strdup (path);
+        file->parent = library;
+        file->d_debug = d_debug;
+        file->d_access = d_access;
+        file->split_scanned = true;
+        eol_type_cache_init (&file->type_cache);
+
+        file->next = library->split_files;
+        library->split_files = library_ref (file);
+        TRACE_PTR (>, EolLibrary, file, " [%s]\n", file->path);
+    }
+
+    /*
+     * Find the unit inside the file. A package contains many units, which
+     * are matched using the DWO identifier; a ".dwo" has a single unit.
+     */
+    unsigned n_units = 0;
+    Dwarf_Off cu_offset = DW_DLV_BADOFFSET;
+    Dwarf_Off cu_die_offset = DW_DLV_BADOFFSET;
+    SPLIT_UNIT_ITERATE_BEGIN (file, cu, d_offset, dwo_id)
+    {
+        if (n_units++ == 0 || (unit->dwo_id && dwo_id == unit->dwo_id)) {
+            cu_offset = d_offset;
+            cu_die_offset = dw_die_offset_ (cu.die);
+        }
+    }
+    SPLIT_UNIT_ITERATE_END;
+
+    if (cu_offset == DW_DLV_BADOFFSET) {
+        TRACE ("%s: unit for %s not found\n", file->path, unit->dwo_name);
+        return NULL;
+    }
+
+    unit->file = file;
+    unit->cu_offset = cu_offset;
+    unit->cu_die_offset = cu_die_offset;
+    return file;
+}
+
+
+static inline uint64_t
+read_offset (const uint8_t *p, unsigned size)
+{
+    if (size == sizeof (uint32_t)) {
+        uint32_t value;
+        memcpy (&value, p, sizeof (uint32_t));
+        return value;
+    } else {
+        uint64_t value;
+        memcpy (&value, p, sizeof (uint64_t));
+        return value;
+    }
+}
+
+
+/*
+ * Looks up a name in a ".debug_gnu_pubnames" or ".debug_gnu_pubtypes"
+ * section. Returns the offset of the DIE relative to its unit, and the
+ * offset of the skeleton unit.
+ */
+static Dwarf_Off
+gnu_index_lookup (const uint8_t *p,
+                  size_t         size,
+                  const char    *name,
+                  Dwarf_Off     *skeleton_offset)
+{
+    const uint8_t *end = p + size;
+
+    while (end - p >= 4) {
+        unsigned offset_size = sizeof (uint32_t);
+        uint64_t length = read_offset (p, offset_size);
+        p += offset_size;
+        if (length == 0xFFFFFFFF) {
+            if (end - p < 8) break;
+            offset_size = sizeof (uint64_t);
+            length = read_offset (p, offset_size);
+            p += offset_size;
+        }
+        if (length > (uint64_t) (end - p) || length < 2 + 2 * offset_size)
+            break;
+
+        /* Version, offset and size of the unit, then (offset, flags, name). */
+        const uint8_t *set_end = p + length;
+        const Dwarf_Off set_offset = read_offset (p + 2, offset_size);
+        p += 2 + 2 * offset_size;
+
+        while (set_end - p > offset_size) {
+            const Dwarf_Off die_offset = read_offset (p, offset_size);
+            p += offset_size + 1;
+            if (die_offset == 0)
+                break;
+
+            const uint8_t *nul = memchr (p, '\0', set_end - p);
+            if (!nul)
+                break;
+            if (string_equal ((const char*) p, name)) {
+                *skeleton_offset = set_offset;
+                return die_offset;
+            }
+            p = nul + 1;
+        }
+        p = set_end;
+    }
+
+    return DW_DLV_BADOFFSET;
+}
+
+
+static inline bool
+split_die_tag_matches (Dwarf_Half d_tag, bool want_type)
+{
+    switch (d_tag) {
+        case DW_TAG_base_type:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_structure_type:
+            return want_type;
+        case DW_TAG_variable:
+        case DW_TAG_subprogram:
+            return !want_type;
+        default:
+            return false;
+    }
+}
+
+
+/*
+ * Searches the top-level DIEs of a split unit, for when the library does
+ * not have the ".debug_gnu_pub*" sections.
+ */
+static Dwarf_Off
+split_unit_find_die (EolLibrary         *file,
+                     const EolSplitUnit *unit,
+                     const char         *name,
+                     bool                want_type,
+                     Dwarf_Error        *d_error)
+{
+    dw_ldie_t cu = { file->d_debug };
+    if (!(cu.die = library_fetch_die (file, unit->cu_die_offset, d_error)))
+        return DW_DLV_BADOFFSET;
+
+    Dwarf_Die d_die = NULL;
+    if (dwarf_child (cu.die, &d_die, d_error) != DW_DLV_OK)
+        return DW_DLV_BADOFFSET;
+
+    Dwarf_Off result = DW_DLV_BADOFFSET;
+    while (d_die) {
+        Dwarf_Half d_tag;
+        Dwarf_Bool d_declaration = false;
+        if (dwarf_tag (d_die, &d_tag, d_error) == DW_DLV_OK &&
+            split_die_tag_matches (d_tag, want_type) &&
+            dwarf_hasattr (d_die, DW_AT_declaration,
+                           &d_declaration, d_error) == DW_DLV_OK &&
+            !d_declaration) {
+            dw_lstring_t die_name = {
+                file->d_debug,
+                dw_die_name (d_die, d_error)
+            };
+            if (die_name.string && string_equal (die_name.string, name)) {
+                result = dw_die_offset_ (d_die);
+                dwarf_dealloc (file->d_debug, d_die, DW_DLA_DIE);
+                break;
+            }
+        }
+
+        Dwarf_Die d_next = NULL;
+        int status = dwarf_siblingof (file->d_debug, d_die, &d_next, d_error);
+        dwarf_dealloc (file->d_debug, d_die, DW_DLA_DIE);
+        d_die = (status == DW_DLV_OK) ? d_next : NULL;
+    }
+
+    return result;
+}
+
+
+static Dwarf_Off
+library_split_lookup (EolLibrary  *library,
+                      const char  *name,
+                      bool         want_type,
+                      EolLibrary **owner,
+                      Dwarf_Error *d_error)
+{
+    CHECK_NOT_NULL (library);
+    CHECK_NOT_NULL (name);
+    CHECK_NOT_NULL (owner);
+    CHECK_NOT_NULL (d_error);
+
+    if (library->parent)
+        return DW_DLV_BADOFFSET;
+    if (!library->split_scanned)
+        library_find_split_units (library);
+    if (!library->n_split_units)
+        return DW_DLV_BADOFFSET;
+
+    uint32_t index;
+    if (eol_elf_find_section (library->elf,
+                              want_type ? ".debug_gnu_pubtypes"
+                                        : ".debug_gnu_pubnames",
+                              &index)) {
+        size_t size;
+        const uint8_t *data = eol_elf_section_data (library->elf, index, &size);
+        Dwarf_Off skeleton_offset;
+        Dwarf_Off die_offset = data
+                ? gnu_index_lookup (data, size, name, &skeleton_offset)
+                : DW_DLV_BADOFFSET;
+        if (die_offset == DW_DLV_BADOFFSET)
+            return DW_DLV_BADOFFSET;
+
+        for (size_t i = 0; i < library->n_split_units; i++) {
+            EolSplitUnit *unit = &library->split_units[i];
+            if (unit->skeleton_offset != skeleton_offset)
+                continue;
+            if (!(*owner = library_open_split_unit (library, unit, d_error)))
+                break;
+            return unit->cu_offset + die_offset;
+        }
+        *owner = library;
+        return DW_DLV_BADOFFSET;
+    }
+
+    for (size_t i = 0; i < library->n_split_units; i++) {
+        EolSplitUnit *unit = &library->split_units[i];
+        EolLibrary *file = library_open_split_unit (library, unit, d_error);
+        if (!file)
+            continue;
+
+        Dwarf_Off d_offset = split_unit_find_die (file, unit, name,
+                                                  want_type, d_error);
+        if (d_offset != DW_DLV_BADOFFSET) {
+            *owner = file;
+            return d_offset;
+        }
+    }
     return DW_DLV_BADOFFSET;
 }
 
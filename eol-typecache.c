@@ -9,6 +9,8 @@
 #include "eol-util.h"
 #include "uthash.h"
 
+#include <string.h>
+
 
 typedef struct _EolTypeCacheEntry EolTypeCacheEntry;
 
@@ -84,3 +86,64 @@ eol_type_cache_foreach (EolTypeCache    *cache,
             break;
     }
 }
+
+
+typedef struct {
+    const EolTypeInfo *base;
+    uint64_t           n_items;
+    EolType            type;
+} EolDerivedTypeKey;
+
+typedef struct {
+    EolDerivedTypeKey  key;
+    const EolTypeInfo *typeinfo;
+    UT_hash_handle     hh;
+} EolDerivedTypeEntry;
+
+/*
+ * Like the per-library caches, entries are never released: type infos
+ * are not freed either, so the base type pointers remain valid.
+ */
+static EolDerivedTypeEntry *derived_types = NULL;
+
+
+const EolTypeInfo*
+eol_type_cache_derived (EolType            type,
+                        const EolTypeInfo *base,
+                        uint64_t           n_items)
+{
+    CHECK_NOT_NULL (base);
+
+    EolDerivedTypeKey key;
+    memset (&key, 0x00, sizeof (EolDerivedTypeKey)); /* Clear padding. */
+    key.base    = base;
+    key.n_items = n_items;
+    key.type    = type;
+
+    EolDerivedTypeEntry *entry;
+    HASH_FIND (hh, derived_types, &key, sizeof (EolDerivedTypeKey), entry);
+    if (entry)
+        return entry->typeinfo;
+
+    const EolTypeInfo *typeinfo;
+    switch (type) {
+        case EOL_TYPE_POINTER:
+            typeinfo = eol_typeinfo_new_pointer (base);
+            break;
+        case EOL_TYPE_ARRAY:
+            typeinfo = eol_typeinfo_new_array (base, n_items);
+            break;
+        case EOL_TYPE_CONST:
+            typeinfo = eol_typeinfo_new_const (base);
+            break;
+        default:
+            CHECK_UNREACHABLE ();
+            return NULL;
+    }
+
+    entry = malloc (sizeof (EolDerivedTypeEntry));
+    entry->key      = key;
+    entry->typeinfo = typeinfo;
+    HASH_ADD (hh, derived_types, key, sizeof (EolDerivedTypeKey), entry);
+    return typeinfo;
+}
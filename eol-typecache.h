@@ -32,4 +32,14 @@ extern void eol_type_cache_foreach (EolTypeCache    *cache,
                                     EolTypeCacheIter callback,
                                     void             *userdata);
 
+/*
+ * Returns the type derived from "base": a pointer to it, a const version,
+ * or an array of "n_items" elements (n_items is ignored for other types).
+ * The result is memoized, so asking for the same derived type repeatedly
+ * always returns the same EolTypeInfo.
+ */
+extern const EolTypeInfo* eol_type_cache_derived (EolType            type,
+                                                  const EolTypeInfo *base,
+                                                  uint64_t           n_items);
+
 #endif /* !EOL_TYPECACHE_H */
@@ -39,7 +39,9 @@ struct TI_compound {
 
 
 struct _EolTypeInfo {
-    EolType type;
+    EolType            type;
+    const EolTypeInfo *canonical;  /* Non-synthetic type, NULL for self. */
+    const void        *ops;        /* See eol_typeinfo_set_ops().        */
     union {
         struct TI_base     ti_base;
         struct TI_pointer  ti_pointer;
@@ -200,6 +202,7 @@ eol_typeinfo_new_const (const EolTypeInfo *base)
 
     EolTypeInfo *typeinfo = eol_typeinfo_new (EOL_TYPE_CONST, 0);
     typeinfo->ti_const.typeinfo = base;
+    typeinfo->canonical = eol_typeinfo_get_non_synthetic (base);
 
     TTRACE (>, typeinfo);
     return typeinfo;
@@ -229,6 +232,7 @@ eol_typeinfo_new_typedef (const EolTypeInfo *base,
     EolTypeInfo *typeinfo = eol_typeinfo_new (EOL_TYPE_TYPEDEF, 0);
     typeinfo->ti_typedef.name     = strdup (name);
     typeinfo->ti_typedef.typeinfo = base;
+    typeinfo->canonical = eol_typeinfo_get_non_synthetic (base);
 
     TTRACE (>, typeinfo);
     return typeinfo;
@@ -496,9 +500,30 @@ const EolTypeInfo*
 eol_typeinfo_get_non_synthetic (const EolTypeInfo *typeinfo)
 {
     CHECK_NOT_NULL (typeinfo);
-    while (typeinfo && eol_type_is_synthetic (typeinfo->type))
-        typeinfo = eol_typeinfo_base (typeinfo);
-    return typeinfo;
+    return typeinfo->canonical ? typeinfo->canonical : typeinfo;
+}
+
+
+const void*
+eol_typeinfo_get_ops (const EolTypeInfo *typeinfo)
+{
+    CHECK_NOT_NULL (typeinfo);
+    return typeinfo->ops;
+}
+
+
+void
+eol_typeinfo_set_ops (const EolTypeInfo *typeinfo,
+                      const void        *ops)
+{
+    CHECK_NOT_NULL (typeinfo);
+    CHECK_NOT_NULL (ops);
+
+    /*
+     * Even the constant typeinfos are writable objects: pointers to them
+     * are const only to avoid accidental modifications.
+     */
+    ((EolTypeInfo*) typeinfo)->ops = ops;
 }
 
 
@@ -76,7 +76,7 @@ extern const char* eol_type_name (EolType type);
 #define DECLARE_EOL_TYPE_IS(suffix, check)                    \
     static inline bool eol_type_is_ ## check (EolType type) { \
         switch (type) {                                       \
-            SYNTHETIC_TYPES (TYPE_CASE_TRUE)                  \
+            suffix ## _TYPES (TYPE_CASE_TRUE)                 \
             default: return false;                            \
         }                                                     \
     }
@@ -147,6 +147,15 @@ extern bool  eol_typeinfo_is_readonly (const EolTypeInfo *typeinfo);
 extern const EolTypeInfo* eol_typeinfo_get_compound (const EolTypeInfo *typeinfo);
 extern const EolTypeInfo* eol_typeinfo_get_non_synthetic (const EolTypeInfo *typeinfo);
 
+/*
+ * Opaque data which users of the type information can attach to a type,
+ * e.g. to cache the functions used to convert values of the type. It is
+ * NULL until set.
+ */
+extern const void* eol_typeinfo_get_ops (const EolTypeInfo *typeinfo);
+extern void        eol_typeinfo_set_ops (const EolTypeInfo *typeinfo,
+                                         const void        *ops);
+
 
 extern EolTypeInfoMember*
 eol_typeinfo_compound_named_member (EolTypeInfo *typeinfo,
@@ -5,6 +5,7 @@
  * Distributed under terms of the MIT license.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 /* Simple integer variable, and a pointer to it. */
@@ -78,6 +79,16 @@ Point triangle[] = {
     { 1, 3 },
 };
 
+/* Struct with a member of a type which is not supported. */
+struct Unsupported {
+    int          before;
+    long double  value;
+    int          after;
+};
+
+struct Unsupported unsupported = { 1, 2.0L, 3 };
+struct Unsupported *unsupported_ptr = &unsupported;
+
 
 enum Continent {
     AFRICA,
@@ -110,3 +121,30 @@ get_intvar (void)
 {
     return intvar;
 }
+
+
+/* Used as finalizer in the eol.gc() tests. */
+int finalized_points = 0;
+
+void
+finalize_point (struct Point *point)
+{
+    point->x = point->y = 0;
+    finalized_points++;
+}
+
+
+/* Linked list, used in the eol.walk() tests. */
+struct Node {
+    int          value;
+    struct Node *next;
+};
+
+struct Node list_nodes[3] = {
+    { .value = 1, .next = &list_nodes[1] },
+    { .value = 2, .next = &list_nodes[2] },
+    { .value = 3, .next = NULL },
+};
+
+struct Node *list_head = &list_nodes[0];
+const struct Node *const_list_head = &list_nodes[0];
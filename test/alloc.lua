@@ -0,0 +1,63 @@
+#! /usr/bin/env lua
+--
+-- alloc.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+local int = eol.typeof(libtest.intvar)
+
+local function address(var)
+	return tonumber(tostring(var):match("%(0x(%x+)%)$"), 16)
+end
+
+-- Single values, and arrays (zero-filled).
+local p = eol.alloc(Point)
+assert.Equal(Point, eol.typeof(p))
+assert.Equal(eol.sizeof(Point), eol.sizeof(p))
+assert.Equal(0, p.x)
+p.y = 3
+assert.Equal(3, p.y)
+
+local a = eol.alloc(int, 100, { align = 64 })
+assert.Equal(100, #a)
+assert.Equal(400, eol.sizeof(a))
+assert.Equal(0, a[100])
+assert.Equal(0, address(a) % 64)
+a[1] = 42
+assert.Equal(42, a:get(1))
+
+-- Huge pages, which may be transparent ones.
+local h = eol.alloc(int, 1024, { hugepages = true })
+assert.Equal(1024, #h)
+h[1024] = 7
+assert.Equal(7, h[1024])
+h:free()
+
+-- Freed values cannot be accessed.
+a:free()
+assert.Equal(0, #a)
+assert.Error(function () return a[1] end)
+a:free()  -- Freeing twice is harmless.
+
+-- Elements and views of freed values become empty.
+local points = eol.alloc(Point, 4)
+local second = points[2]
+local xs = points:field("x")
+second.x = 5
+assert.Equal(5, xs[2])
+points:free()
+assert.Equal(0, #second)
+assert.Error(function () return second.x end)
+assert.Error(function () second.x = 1 end)
+assert.Equal(0, #xs)
+assert.Error(function () return xs[2] end)
+
+-- Errors.
+assert.Error(function () eol.alloc(int, 0) end)
+assert.Error(function () eol.alloc(int, 1, { align = 3 }) end)
+assert.Error(function () eol.alloc(int, 1 << 31) end)
@@ -0,0 +1,45 @@
+#! /usr/bin/env lua
+--
+-- arena.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+local int = eol.typeof(libtest.intvar)
+
+local arena = eol.arena(64)
+assert.Userdata(arena, "org.perezdecastro.eol.Arena")
+
+-- Values are zero-filled, and independent from each other.
+local p = arena:new(Point)
+local q = arena:new(Point)
+assert.Equal(0, p.x)
+p.x, q.x = 1, 2
+assert.Equal(1, p.x)
+assert.Equal(2, q.x)
+
+-- Arrays, including one bigger than the chunk size.
+local a = arena:new(int, 100)
+assert.Equal(100, #a)
+assert.Equal(0, a[100])
+a[100] = 5
+assert.Equal(5, a[100])
+assert.Error(function () arena:new(int, 0) end)
+assert.Error(function () arena:new(int, 1 << 30) end)  -- 4 GiB.
+
+-- After a reset, memory is reused (and cleared).
+arena:reset()
+local r = arena:new(Point)
+assert.Equal(0, r.x)
+assert.True(rawequal(p, r))
+
+-- Values keep the arena alive.
+local v = eol.arena():new(Point)
+collectgarbage()
+collectgarbage()
+v.y = 10
+assert.Equal(10, v.y)
@@ -0,0 +1,49 @@
+#! /usr/bin/env lua
+--
+-- array-multidim.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local int32_t = eol.type(libtest, "int32_t")
+
+-- int32_t matrix[3][4]
+local matrix = int32_t:arrayof(4)(3)
+assert.Equal(3, #matrix)
+assert.Equal(48, eol.sizeof(matrix))
+
+for i = 1, 3 do
+	for j = 1, 4 do
+		matrix:set(i, j, i * 10 + j)
+	end
+end
+for i = 1, 3 do
+	for j = 1, 4 do
+		assert.Equal(i * 10 + j, matrix:get(i, j))
+		assert.Equal(i * 10 + j, matrix[i][j])
+	end
+end
+
+-- Negative indices count from the end.
+assert.Equal(34, matrix:get(-1, -1))
+assert.Equal(34, matrix[-1][-1])
+assert.Equal(11, matrix:get(-3, -4))
+assert.Error(function () return matrix:get(-4, 1) end)
+
+-- Fewer indices return a sub-array.
+local row = matrix:get(2)
+assert.Equal(4, #row)
+assert.Equal(23, row[3])
+
+-- Bounds are checked for all the dimensions.
+assert.Error(function () return matrix:get(4, 1) end)
+assert.Error(function () return matrix:get(1, 5) end)
+assert.Error(function () return matrix:get(1, 1, 1) end)
+assert.Error(function () matrix:set(1, 5, 0) end)
+
+-- Also works for one-dimensional arrays.
+local intarray = libtest.intarray
+assert.Equal(3, intarray:get(3))
@@ -0,0 +1,59 @@
+#! /usr/bin/env lua
+--
+-- array-views.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local triangle = libtest.triangle
+
+-- View of a field of each element in an array of structs.
+local xs = triangle:field("x")
+assert.Userdata(xs, "org.perezdecastro.eol.View")
+assert.Equal(3, #xs)
+assert.Equal(1, xs[1])
+assert.Equal(2, xs[2])
+assert.Equal(1, xs[3])
+assert.Error(function () return xs[4] end)
+
+-- Negative indices count from the end, for elements and slices alike.
+assert.Equal(xs[3], xs[-1])
+assert.Equal(xs[1], xs[-3])
+assert.Error(function () return xs[-4] end)
+assert.Equal(xs[-1], xs:slice(-1)[1])
+
+-- Views do not copy, so writes are visible in the array.
+xs[2] = 7
+assert.Equal(7, triangle[2].x)
+xs[2] = 2
+
+-- Slices, which can be combined with fields.
+local tail = triangle:slice(2)
+assert.Equal(2, #tail)
+assert.Equal(2, tail[1].x)
+local ys = triangle:slice(2, 3):field("y")
+assert.Equal(2, #ys)
+assert.Equal(3, ys[1])
+assert.Equal(3, ys[2])
+assert.Equal(0, #triangle:slice(2, 1))
+assert.Error(function () triangle:slice(0, 2) end)
+assert.Error(function () triangle:slice(1, 4) end)
+assert.Error(function () libtest.intarray:field("x") end)
+
+-- Copy into a contiguous array.
+local int_t = eol.type(libtest, "Point")[1].type
+local dest = int_t(3)
+assert.Equal(3, xs:copy(dest))
+assert.Equal(1, dest[1])
+assert.Equal(2, dest[2])
+assert.Equal(1, dest[3])
+assert.Error(function () xs:copy(int_t(2)) end)
+
+-- Slices of plain arrays.
+local mid = libtest.intarray:slice(2, 4)
+assert.Equal(3, #mid)
+assert.Equal(2, mid[1])
+assert.Equal(4, mid[3])
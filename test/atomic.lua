@@ -0,0 +1,70 @@
+#! /usr/bin/env lua
+--
+-- atomic.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+
+-- Scalar variables: no key.
+local v = libtest.var_i16
+assert.Equal(-16, v:atomic_load())
+v:atomic_store(-100)
+assert.Equal(-100, v.__value)
+assert.Equal(-100, v:fetch_add(10))
+assert.Equal(-90, v:atomic_load())
+local ok, current = v:compare_exchange(0, 1)
+assert.False(ok)
+assert.Equal(-90, current)
+ok, current = v:compare_exchange(-90, 1)
+assert.True(ok)
+assert.Equal(-90, current)
+assert.Equal(1, v.__value)
+
+-- Unsigned values wrap around.
+local u = libtest.var_u8
+u:atomic_store(255)
+assert.Equal(255, u:fetch_add(1))
+assert.Equal(0, u:atomic_load())
+
+-- Array elements.
+local a = libtest.intarray
+assert.Equal(3, a:atomic_load(3))
+assert.Equal(3, a:fetch_add(3, 4))
+assert.Equal(7, a[3])
+assert.Equal(5, a:atomic_load(-1))
+assert.Error(function () a:atomic_load(6) end)
+
+-- Struct members, by name or index.
+local p = eol.type(libtest, "Point")()
+p:atomic_store("x", 5)
+assert.Equal(5, p.x)
+assert.Equal(0, p:fetch_add(2, 3))
+assert.Equal(3, p:atomic_load("y"))
+assert.Error(function () p:atomic_load("z") end)
+
+-- Enums, as integers.
+local location = libtest.location
+assert.Equal(1, location:atomic_load())
+location:atomic_store(2)
+assert.Equal(2, location.__value)
+ok, current = location:compare_exchange(2, 4)
+assert.True(ok)
+assert.Equal(2, current)
+assert.Equal(4, location:fetch_add(-3))
+assert.Equal(1, location.__value)
+
+-- Pointers.
+local ptr = libtest.voidptr
+assert.Not.Nil(ptr:atomic_load())
+ptr:atomic_store(nil)
+assert.Nil(ptr:atomic_load())
+assert.Error(function () ptr:fetch_add(1) end)
+
+-- Unsupported types and read-only values.
+assert.Error(function () libtest.var_dbl:atomic_load() end)
+assert.Error(function () libtest.const_int:fetch_add(1) end)
+assert.Equal(42, libtest.const_int:atomic_load())
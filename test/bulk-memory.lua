@@ -0,0 +1,69 @@
+#! /usr/bin/env lua
+--
+-- bulk-memory.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local int = eol.typeof(libtest.intvar)
+
+local a = int(4)
+local b = int(4)
+for i = 1, 4 do a[i] = i end
+
+-- Copy.
+assert.Equal(16, eol.copy(b, a))
+assert.Equal(0, eol.compare(a, b))
+assert.Equal(4, b[4])
+assert.Equal(4, eol.copy(b, int(1)))
+assert.Equal(0, b[1])
+assert.Equal(2, b[2])
+assert.Error(function () eol.copy(int(2), a) end)
+assert.Error(function () eol.copy(a, a) end)
+assert.Error(function () eol.copy(libtest.const_int, int()) end)
+assert.Equal(8, eol.copy(int(2), a, 8))
+
+-- Compare.
+assert.Equal(1, eol.compare(a, b))
+assert.Equal(-1, eol.compare(b, a))
+assert.Equal(0, eol.compare(a, b, 0))
+assert.Equal(-1, eol.compare(int(2), int(4)))
+
+-- Pointers operate on the pointed-to value, pointers to void need a length.
+local c = int(2)
+assert.Equal(4, eol.copy(c, libtest.intptrvar.__value))
+assert.Equal(42, c[1])
+local voidptr = libtest.voidptr.__value
+assert.Error(function () eol.copy(c, voidptr) end)
+assert.Error(function () eol.compare(c, voidptr) end)
+assert.Equal(8, eol.copy(c, voidptr, 8))
+assert.Equal(3, c[1])
+assert.Equal(4, c[2])
+assert.Equal(0, eol.compare(c, voidptr, 8))
+
+-- Move, between overlapping rows of a matrix.
+local m = int:arrayof(2)(3)
+for i = 1, 3 do
+	m[i][1], m[i][2] = i, -i
+end
+local head = eol.cast(int:arrayof(4), m)
+local tail = eol.cast(int:arrayof(4), m[2])
+assert.Error(function () eol.copy(tail, head) end)
+assert.Equal(16, eol.move(tail, head))
+assert.Equal(1, m[1][1])
+assert.Equal(1, m[2][1])
+assert.Equal(-1, m[2][2])
+assert.Equal(2, m[3][1])
+assert.Equal(-2, m[3][2])
+
+-- Fill.
+assert.Equal(16, eol.fill(a, 0))
+assert.Equal(0, a[4])
+eol.fill(a, 0xFF, 4)
+assert.Equal(-1, a[1])
+assert.Equal(0, a[2])
+assert.Error(function () eol.fill(a, 256) end)
+assert.Error(function () eol.fill(a, 0, 17) end)
@@ -0,0 +1,56 @@
+#! /usr/bin/env lua
+--
+-- gc-finalizer.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+local finalize_point = libtest.finalize_point
+
+local function collect()
+	collectgarbage()
+	collectgarbage()
+end
+
+-- Finalizers are called when variables are collected.
+local p = Point()
+assert.True(rawequal(p, eol.gc(p, finalize_point)))
+p = nil
+collect()
+assert.Equal(1, libtest.finalized_points.__value)
+
+-- Finalizers can be removed.
+p = eol.gc(eol.gc(Point(), finalize_point), nil)
+p = nil
+collect()
+assert.Equal(1, libtest.finalized_points.__value)
+
+-- Also for values allocated outside of the Lua heap.
+p = eol.gc(eol.alloc(Point), finalize_point)
+p.x = 5
+p = nil
+collect()
+assert.Equal(2, libtest.finalized_points.__value)
+
+-- Values created by arenas keep both the arena and the finalizer, even
+-- when the same wrapper is returned again after resetting the arena.
+local arena = eol.arena()
+p = eol.gc(arena:new(Point), finalize_point)
+arena:reset()
+assert.True(rawequal(p, arena:new(Point)))
+arena = nil
+collect()
+p.x = 5
+assert.Equal(5, p.x)
+p = nil
+collect()
+assert.Equal(3, libtest.finalized_points.__value)
+
+-- Only functions taking a single pointer can be finalizers.
+assert.Error(function () eol.gc(Point(), libtest.add) end)
+assert.Error(function () eol.gc(Point(), libtest.get_intvar) end)
+assert.Error(function () eol.gc(Point(), print) end)
@@ -0,0 +1,85 @@
+#! /usr/bin/env lua
+--
+-- kernels.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local float = eol.typeof(libtest.var_flt)
+local double = eol.typeof(libtest.var_dbl)
+local int = eol.typeof(libtest.intvar)
+
+-- Long enough to use both the vector loops, and the scalar tails.
+local N = 37
+local x, y = float(N), float(N)
+for i = 1, N do
+	x[i] = i
+	y[i] = 2
+end
+
+assert.Equal(N * (N + 1) / 2, eol.reduce(x, "sum"))
+assert.Equal(1, eol.reduce(x, "min"))
+assert.Equal(N, eol.reduce(x, "max"))
+assert.Equal(N * (N + 1), eol.dot(x, y))
+local empty = x:slice(1, 0)
+assert.Nil(eol.reduce(empty, "min"))
+assert.Equal(0, eol.reduce(empty, "sum"))
+assert.Error(function () eol.reduce(x, "avg") end)
+
+-- y = 0.5 * x + y
+eol.axpy(0.5, x, y)
+assert.Equal(2.5, y[1])
+assert.Equal(N / 2 + 2, y[N])
+
+-- Conversions between element types.
+local d = double(N)
+assert.Equal(N, eol.convert(d, x))
+assert.Equal(N, d[N])
+local n = int(N)
+eol.convert(n, y)
+assert.Equal(2, n[1])
+assert.Error(function () eol.convert(int(2), x) end)
+
+-- Integer elements.
+local m = eol.pack(int, { 3, -1, 7 })
+assert.Equal(9, eol.reduce(m, "sum"))
+assert.Equal(-1, eol.reduce(m, "min"))
+assert.Equal(7, eol.reduce(m, "max"))
+assert.Equal(59, eol.dot(m, m))
+assert.Equal(3, n[3])
+eol.axpy(-2, m, n:slice(1, 3))
+assert.Equal(-4, n[1])
+assert.Equal(5, n[2])
+assert.Equal(-11, n[3])
+assert.Error(function () eol.axpy(0.5, m, n:slice(1, 3)) end)
+eol.axpy(2.0, m, n:slice(1, 3))
+assert.Equal(2, n[1])
+
+-- Floating point values saturate when converted to integers, NaN to zero.
+local u8 = eol.type(libtest, "uint8_t")
+local big = eol.pack(double, { 0/0, 1e100, -1e100, -1.5, 300.5 })
+local ints, bytes = int(5), u8(5)
+eol.convert(ints, big)
+eol.convert(bytes, big)
+assert.Equal(0, ints[1])
+assert.Equal(0x7FFFFFFF, ints[2])
+assert.Equal(-0x80000000, ints[3])
+assert.Equal(-1, ints[4])
+assert.Equal(300, ints[5])
+assert.Equal(0, bytes[1])
+assert.Equal(255, bytes[2])
+assert.Equal(0, bytes[3])
+assert.Equal(0, bytes[4])
+assert.Equal(255, bytes[5])
+
+-- Views must be contiguous, and types and lengths must match.
+local Point = eol.type(libtest, "Point")
+local points = eol.pack(Point, { { x = 1, y = 2 }, { x = 3, y = 4 } })
+assert.Error(function () eol.reduce(points:field("x"), "sum") end)
+assert.Error(function () eol.reduce(points, "sum") end)
+assert.Error(function () eol.dot(x, d) end)
+assert.Error(function () eol.dot(x, float(N - 1)) end)
+assert.Error(function () eol.axpy(1, x, libtest.const_int) end)
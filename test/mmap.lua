@@ -0,0 +1,82 @@
+#! /usr/bin/env lua
+--
+-- mmap.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+
+-- Three points, plus some trailing bytes which do not make a whole one.
+local path = os.tmpname()
+local f = io.open(path, "wb")
+f:write(string.pack("=i4i4i4i4i4i4", 1, 2, 3, 4, 5, 6), "xyz")
+f:close()
+
+-- Read-only mapping.
+local points = eol.mmap(path, Point, "r", "sequential")
+assert.Not.Nil(points)
+assert.Equal(3, #points)
+assert.Equal(1, points[1].x)
+assert.Equal(4, points[2].y)
+assert.Equal(5, points[3].x)
+assert.Equal(5, points:field("x")[3])
+assert.Error(function () points[1] = { x = 0, y = 0 } end)
+assert.Error(function () points[1].x = 0 end)
+assert.Error(function () points[1]:atomic_store("x", 0) end)
+points:advise("willneed")
+points:close()
+assert.Equal(0, #points)
+assert.Error(function () return points[1] end)
+assert.Error(function () points:sync() end)
+
+-- Writable mapping, changes are written back to the file.
+points = eol.mmap(path, Point, "w")
+points[2].x = 42
+points:sync()
+points:close()
+f = io.open(path, "rb")
+local _, _, x = string.unpack("=i4i4i4", f:read("a"))
+f:close()
+assert.Equal(42, x)
+
+-- Private copy-on-write mapping, changes are not written back.
+points = eol.mmap(path, Point, "c")
+points[2].x = 7
+assert.Equal(7, points[2].x)
+points:close()
+
+-- Elements and views can not be used after closing the mapping.
+points = eol.mmap(path, Point, "w")
+local second, xs = points[2], points:field("x"):slice(2)
+local path_x = eol.path(Point, "x")
+assert.Equal(42, second.x)
+assert.Equal(42, xs[1])
+points:close()
+assert.Equal(0, #second)
+assert.Error(function () return second.x end)
+assert.Error(function () second.x = 1 end)
+assert.Error(function () return second.__value end)
+assert.Error(function () return path_x(second) end)
+assert.Equal(0, #xs)
+assert.Error(function () return xs[1] end)
+assert.False(rawequal(second, eol.mmap(path, Point)[2]))
+assert.Equal(42, eol.mmap(path, Point)[2].x)
+
+-- Errors.
+assert.Error(function () eol.mmap(path .. ".missing", Point) end)
+assert.Error(function () eol.mmap(path, Point, "x") end)
+assert.Error(function () eol.mmap(path, Point, "r", "whatever") end)
+os.remove(path)
+
+-- Files bigger than the maximum size of arrays (4 GiB) are not mapped.
+path = os.tmpname()
+f = io.open(path, "wb")
+f:seek("set", 5 * 1024 * 1024 * 1024)
+f:write("x")
+f:close()
+assert.Error(function () eol.mmap(path, Point) end)
+os.remove(path)
@@ -0,0 +1,29 @@
+#! /usr/bin/env lua
+--
+-- modload-btf.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+-- The library has only BTF type information, and it is built only when
+-- the compiler supports it (e.g. GCC 12 or newer).
+local fd = io.open("libtest-btf.so")
+if not fd then
+	return
+end
+fd:close()
+
+local eol = require("eol")
+local libtest = eol.load("libtest-btf")
+assert.Not.Nil(libtest)
+
+assert.Equal(42, libtest.intvar.__value)
+assert.Equal(800, libtest.max_pos.x)
+assert.Equal(5, libtest.add(2, 3))
+assert.Equal(5, #libtest.intarray)
+
+local Point = eol.type(libtest, "Point")
+assert.Not.Nil(Point)
+assert.Equal(8, eol.sizeof(Point))
+assert.Equal(4, eol.offsetof(Point, "y"))
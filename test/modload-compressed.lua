@@ -0,0 +1,16 @@
+#! /usr/bin/env lua
+--
+-- modload-compressed.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+-- The debug information sections of the library are zlib-compressed,
+-- using SHF_COMPRESSED sections.
+local libtest = require("eol").load("libtest-compressed")
+assert.Not.Nil(libtest)
+
+assert.Equal(42, libtest.intvar.__value)
+assert.Equal(800, libtest.max_pos.x)
+assert.Equal(5, libtest.add(2, 3))
@@ -0,0 +1,16 @@
+#! /usr/bin/env lua
+--
+-- modload-debuglink.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+-- The library is stripped, and its debug information is in a separate
+-- file which is located using the ".gnu_debuglink" section.
+local libtest = require("eol").load("libtest-debuglink")
+assert.Not.Nil(libtest)
+
+assert.Equal(42, libtest.intvar.__value)
+assert.Equal(800, libtest.max_pos.x)
+assert.Equal(5, libtest.add(2, 3))
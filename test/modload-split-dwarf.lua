@@ -0,0 +1,22 @@
+#! /usr/bin/env lua
+--
+-- modload-split-dwarf.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+-- The library was built with -gsplit-dwarf, and most of the debugging
+-- information is in a separate libtest-split.dwo file.
+local eol = require("eol")
+local libtest = eol.load("libtest-split")
+assert.Not.Nil(libtest)
+
+assert.Equal(42, libtest.intvar.__value)
+assert.Equal(800, libtest.max_pos.x)
+assert.Equal(5, libtest.add(2, 3))
+assert.Equal(libtest, libtest.intvar.__library)
+
+local Point = eol.type(libtest, "Point")
+assert.Not.Nil(Point)
+assert.Equal(eol.sizeof(libtest.origin), eol.sizeof(Point))
@@ -25,3 +25,8 @@ assert.Equal(Point[1].offset, eol.offsetof(Point, 1))
 assert.Equal(Point[1].offset, eol.offsetof(Point, "x"))
 assert.Equal(Point[2].offset, eol.offsetof(Point, 2))
 assert.Equal(Point[2].offset, eol.offsetof(Point, "y"))
+
+-- Negative indices count from the last field.
+assert.Equal(eol.offsetof(Point, 2), eol.offsetof(Point, -1))
+assert.Equal(eol.offsetof(Point, 1), eol.offsetof(Point, -2))
+assert.Error(function () eol.offsetof(Point, -3) end)
@@ -0,0 +1,56 @@
+#! /usr/bin/env lua
+--
+-- pack-unpack.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+
+-- Pack a list of records into a new array.
+local points = eol.pack(Point, {
+	{ x = 1, y = 2 },
+	{ x = 3, y = 4 },
+	{ x = 5 },
+})
+assert.Equal(3, #points)
+assert.Equal(24, eol.sizeof(points))
+assert.Equal(1, points[1].x)
+assert.Equal(4, points[2].y)
+assert.Equal(5, points[3].x)
+assert.Equal(0, points[3].y)  -- Missing fields are left untouched.
+
+-- Unpack it back into tables.
+local list = eol.unpack(points)
+assert.Equal(3, #list)
+assert.Equal(3, list[2].x)
+assert.Equal(4, list[2].y)
+assert.Equal(0, list[3].y)
+
+-- Pack into an existing array, or a slice of it.
+eol.pack(Point, { { x = 10, y = 20 } }, libtest.triangle:slice(3))
+assert.Equal(10, libtest.triangle[3].x)
+assert.Equal(20, libtest.triangle[3].y)
+assert.Error(function () eol.pack(Point, { {}, {} }, points:slice(3)) end)
+
+-- Nested structs and arrays.
+local Bezier = eol.typeof(libtest.curve)
+local curve = eol.unpack(libtest.curve)
+assert.Equal(0, curve.tangential)
+assert.Equal(4, #curve.points)
+assert.Equal(6, curve.points[3].y)
+curve.points[3].y = 60
+local curves = eol.pack(Bezier, { curve })
+assert.Equal(60, curves[1].points[3].y)
+assert.Equal(5, curves[1].points[3].x)
+
+-- Scalar elements.
+local int_t = Point[1].type
+local ints = eol.pack(int_t, { 1, 2, 3 })
+assert.Equal(3, #ints)
+assert.Equal(2, ints[2])
+local t = eol.unpack(ints)
+assert.Equal(3, t[3])
@@ -0,0 +1,68 @@
+#! /usr/bin/env lua
+--
+-- path.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local curve, screen = libtest.curve, libtest.screen
+
+-- Constant paths.
+local Bezier = eol.typeof(curve)
+local p3x = eol.path(Bezier, "points[3].x")
+assert.Userdata(p3x, "org.perezdecastro.eol.Path")
+assert.Equal(5, p3x(curve))
+assert.Equal(curve.points[3].x, p3x(curve))
+
+-- Paths can also be created from a variable.
+local tl_y = eol.path(screen, "tl.y")
+assert.Equal(20, tl_y(screen))
+
+-- Variable indices.
+local px = eol.path(Bezier, "points[?].x")
+local py = eol.path(Bezier, "points[?].y")
+for i = 1, #curve.points do
+	assert.Equal(curve.points[i].x, px(curve, i))
+	assert.Equal(curve.points[i].y, py(curve, i))
+end
+assert.Error(function () return px(curve, 5) end)
+assert.Error(function () return px(curve, 0) end)
+
+-- Writes.
+py(curve, 4, 42)
+assert.Equal(42, curve.points[4].y)
+py(curve, 4, 1)
+
+-- Paths to arrays and structs return the same wrappers.
+local points = eol.path(Bezier, "points")
+assert.True(rawequal(curve.points, points(curve)))
+
+-- Paths for arrays.
+local triangle = libtest.triangle
+local tx = eol.path(triangle, "[?].x")
+assert.Equal(1, tx(triangle, 1))
+assert.Equal(2, tx(triangle, 2))
+
+-- Invalid paths and values.
+assert.Error(function () eol.path(Bezier, "nonexistent") end)
+assert.Error(function () eol.path(Bezier, "points[5]") end)
+assert.Error(function () eol.path(Bezier, "points.x") end)
+assert.Error(function () eol.path(Bezier, "tangential.x") end)
+assert.Error(function () p3x(screen) end)
+
+-- Structs and arrays reached from read-only values are read-only as well.
+local Point = eol.type(libtest, "Point")
+local file = os.tmpname()
+local f = io.open(file, "wb")
+f:write(string.pack("=i4i4i4i4", 1, 2, 3, 4))
+f:close()
+local mapped = eol.mmap(file, Point, "r")
+local point = eol.path(mapped, "[?]")
+assert.Equal(3, point(mapped, 2).x)
+assert.Error(function () point(mapped, 2).x = 0 end)
+assert.Equal(3, mapped[2].x)
+mapped:close()
+os.remove(file)
@@ -0,0 +1,61 @@
+#! /usr/bin/env lua
+--
+-- shm.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+
+local name = string.format("/eol-test-%d-%d", os.time(), math.random(1e6))
+
+-- Opening a missing object fails, unless it is created.
+assert.Error(function () eol.shm(name, Point) end)
+local p = eol.shm(name, Point, { create = true, exclusive = true })
+assert.Not.Nil(p)
+assert.Equal(Point, eol.typeof(p))
+assert.Equal(eol.sizeof(Point), eol.sizeof(p))
+assert.Equal(0, p.x)
+assert.Equal(0, p.y)
+assert.Error(function () eol.shm(name, Point, { create = true, exclusive = true }) end)
+
+-- Changes are visible through other mappings of the same object.
+local q = eol.shm(name, Point)
+p.x = 10
+q.y = 20
+assert.Equal(20, p.y)
+assert.Equal(10, q.x)
+
+-- Read-only mappings.
+local r = eol.shm(name, Point, { readonly = true })
+assert.Equal(10, r.x)
+assert.Error(function () r.x = 1 end)
+p.x = 11
+assert.Equal(11, r.x)
+p.x = 10
+assert.Error(function () eol.shm(name, Point, { create = true, readonly = true }) end)
+
+-- The object is too small for an array of two points.
+assert.Error(function () eol.shm(name, Point, { n = 2 }) end)
+
+-- Closed mappings cannot be accessed.
+q:close()
+assert.Error(function () return q.x end)
+assert.Equal(10, p.x)
+
+eol.shmunlink(name)
+assert.Error(function () eol.shmunlink(name) end)
+
+-- Arrays.
+local a = eol.shm(name, Point, { create = true, n = 3 })
+assert.Equal(3, #a)
+a[3].x = 5
+assert.Equal(5, eol.shm(name, Point, { n = 3 })[3].x)
+eol.shmunlink(name)
+
+-- Arrays bigger than 4 GiB are rejected before creating the object.
+assert.Error(function () eol.shm(name, Point, { create = true, n = 1 << 30 }) end)
+assert.Error(function () eol.shmunlink(name) end)
@@ -0,0 +1,73 @@
+#! /usr/bin/env lua
+--
+-- sort.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local Point = eol.type(libtest, "Point")
+local double = eol.typeof(libtest.var_dbl)
+
+local points = eol.pack(Point, {
+	{ x =  3, y = 1 },
+	{ x = -5, y = 2 },
+	{ x =  3, y = 3 },
+	{ x =  0, y = 4 },
+	{ x = 70000, y = 5 },
+})
+
+-- Sorting is stable.
+eol.sort(points, "x")
+local list = eol.unpack(points)
+assert.Equal(-5, list[1].x)
+assert.Equal(0, list[2].x)
+assert.Equal(1, list[3].y)
+assert.Equal(3, list[4].y)
+assert.Equal(70000, list[5].x)
+
+-- Binary search.
+assert.Equal(3, eol.bsearch(points, "x", 3))
+assert.Equal(1, eol.bsearch(points, "x", -5))
+local index, position = eol.bsearch(points, "x", 1)
+assert.Nil(index)
+assert.Equal(3, position)
+assert.Equal(6, select(2, eol.bsearch(points, "x", 100000)))
+
+-- Descending order.
+eol.sort(points, "y", "desc")
+assert.Equal(5, points[1].y)
+assert.Equal(1, points[5].y)
+assert.Equal(2, eol.bsearch(points, "y", 4, "desc"))
+
+-- Arrays of scalars, including negative floating point values.
+local values = eol.pack(double, { 2.5, -1, 0, -7.25, 1e10, -1e-3 })
+eol.sort(values)
+assert.Equal(-7.25, values[1])
+assert.Equal(-1, values[2])
+assert.Equal(-1e-3, values[3])
+assert.Equal(1e10, values[6])
+assert.Equal(4, eol.bsearch(values, nil, 0))
+
+-- Enums, compared as integers.
+local Continent = eol.type(libtest, "Continent")
+local int32_t = eol.type(libtest, "int32_t")
+local continents = eol.cast(Continent:arrayof(4),
+                            eol.pack(int32_t, { 5, 1, 3, 0 }))
+eol.sort(continents)
+assert.Equal(0, continents[1])
+assert.Equal(5, continents[4])
+assert.Equal(3, eol.bsearch(continents, nil, 3))
+
+-- Views.
+local xs = points:field("x")
+eol.sort(points:slice(2, 4), "x")
+assert.Equal(-5, xs[2])
+assert.Equal(3, xs[4])
+
+-- Errors.
+assert.Error(function () eol.sort(points, "z") end)
+assert.Error(function () eol.sort(points) end)
+assert.Error(function () eol.sort(points, "x", "sideways") end)
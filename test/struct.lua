@@ -21,3 +21,15 @@ assert.Equal("y", y_member.name)
 assert.Equal(0, x_member.offset)
 assert.Equal(x_member.type, y_member.type)
 assert.True(x_member.offset < y_member.offset)
+
+-- Members of unsupported types are left as opaque values, and the type
+-- is shared with pointers to it which were looked up first.
+local libtest = require("eol").load("libtest")
+local unsupported_ptr = libtest.unsupported_ptr
+local unsupported = libtest.unsupported
+assert.True(rawequal(unsupported.__type, unsupported_ptr.__type.type))
+assert.Equal(1, unsupported.before)
+assert.Equal(3, unsupported.after)
+assert.Nil(unsupported.value)
+assert.Error(function () unsupported.value = 0 end)
+assert.Equal("void", unsupported.__type[2].type.name)
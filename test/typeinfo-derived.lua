@@ -0,0 +1,27 @@
+#! /usr/bin/env lua
+--
+-- typeinfo-derived.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require "eol"
+local libtest = eol.load "libtest"
+local int32_t = eol.type(libtest, "int32_t")
+
+-- Derived types are created once, and then reused.
+local int32ptr_t = int32_t:pointerto()
+assert.Equal("pointer", int32ptr_t.kind)
+assert.True(rawequal(int32ptr_t, int32_t:pointerto()))
+
+local int32x4_t = int32_t:arrayof(4)
+assert.Equal(16, int32x4_t.sizeof)
+assert.True(rawequal(int32x4_t, int32_t:arrayof(4)))
+assert.False(rawequal(int32x4_t, int32_t:arrayof(8)))
+
+-- Instantiating arrays of a type uses the same array type.
+local a, b = int32_t(4), int32_t(4)
+assert.Equal(4, #a)
+assert.True(rawequal(eol.typeof(a), eol.typeof(b)))
+assert.True(rawequal(int32x4_t, eol.typeof(a)))
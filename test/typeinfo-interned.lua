@@ -0,0 +1,20 @@
+#! /usr/bin/env lua
+--
+-- typeinfo-interned.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+
+-- The same type is always represented by the same object.
+local Point = eol.type(libtest, "Point")
+assert.True(rawequal(Point, eol.type(libtest, "Point")))
+assert.True(rawequal(libtest.intvar.__type, libtest.intvar.__type))
+assert.True(rawequal(eol.typeof(libtest.intvar), libtest.intvar.__type))
+
+-- Works as a table key.
+local names = { [Point] = "Point" }
+assert.Equal("Point", names[eol.type(libtest, "Point")])
@@ -0,0 +1,37 @@
+#! /usr/bin/env lua
+--
+-- variable-kinds.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+
+-- Each kind of variable has its own metatable, with the same name.
+local intvar, intarray = libtest.intvar, libtest.intarray
+local screen, triangle = libtest.screen, libtest.triangle
+assert.Userdata(intvar, "org.perezdecastro.eol.Variable")
+assert.Userdata(intarray, "org.perezdecastro.eol.Variable")
+assert.Userdata(screen, "org.perezdecastro.eol.Variable")
+assert.Not.Equal(getmetatable(intvar), getmetatable(intarray))
+assert.Not.Equal(getmetatable(intarray), getmetatable(screen))
+assert.Equal(getmetatable(screen), getmetatable(triangle[1]))
+
+-- Scalars can only be accessed through their special fields.
+assert.Equal(42, intvar.__value)
+assert.Error(function () return intvar.foo end)
+assert.Error(function () intvar[1] = 0 end)
+
+-- Arrays and structs also have special fields.
+assert.Equal("intarray", intarray.__name)
+assert.Equal(1, intarray[1])
+assert.Equal("screen", screen.__name)
+assert.Equal(10, screen.tl.x)
+assert.Equal(10, screen[1].x)
+
+-- Functions which accept variables accept any kind.
+assert.Equal(4, eol.sizeof(intvar))
+assert.Equal(20, eol.sizeof(intarray))
+assert.Equal(16, eol.sizeof(screen))
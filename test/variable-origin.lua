@@ -0,0 +1,20 @@
+#! /usr/bin/env lua
+--
+-- variable-origin.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local libtest = require("eol").load("libtest")
+
+-- Variables looked up by name know their name and library.
+local intvar = libtest.intvar
+assert.Equal("intvar", intvar.__name)
+assert.Equal(libtest, intvar.__library)
+assert.Equal("intvar", libtest.intvar.__name)
+
+-- Anonymous values (here, a dereferenced pointer) have neither.
+local value = libtest.intptrvar.__value
+assert.Nil(value.__name)
+assert.Nil(value.__library)
@@ -0,0 +1,60 @@
+#! /usr/bin/env lua
+--
+-- walk.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+local head = libtest.list_head.__value
+
+-- Nodes are produced in order, reusing the same variable.
+local values, cursor = {}, nil
+for i, node in eol.walk(head, "next") do
+	assert.Equal(#values + 1, i)
+	assert.Userdata(node, "org.perezdecastro.eol.Variable")
+	if cursor then
+		assert.True(rawequal(cursor, node))
+	end
+	cursor = node
+	values[i] = node.value
+end
+assert.Equal(3, #values)
+assert.Equal(1, values[1])
+assert.Equal(2, values[2])
+assert.Equal(3, values[3])
+
+-- Walking can start from a struct, and produce the value of a member.
+values = {}
+for i, value in eol.walk(libtest.list_nodes[2], "next", "value") do
+	values[i] = value
+end
+assert.Equal(2, #values)
+assert.Equal(2, values[1])
+assert.Equal(3, values[2])
+
+-- The last node has a NULL link, and nil is an empty list.
+for i, next in eol.walk(head, "next", "next") do
+	assert.Equal(i == 3, next == nil)
+end
+for _ in eol.walk(nil, "next") do
+	error("nil must produce no nodes")
+end
+
+-- Nodes walked from a read-only start are read-only.
+local count = 0
+for _, node in eol.walk(libtest.const_list_head.__value, "next") do
+	assert.True(node.__type.readonly)
+	assert.Error(function () node.value = 0 end)
+	count = count + 1
+end
+assert.Equal(3, count)
+assert.Equal(1, libtest.list_nodes[1].value)
+
+-- The link must be a pointer to the same struct type.
+assert.Error(function () eol.walk(head, "value") end)
+assert.Error(function () eol.walk(head, "nope") end)
+assert.Error(function () eol.walk(head, "next", "nope") end)
+assert.Error(function () eol.walk(libtest.intvar, "next") end)
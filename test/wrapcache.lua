@@ -0,0 +1,37 @@
+#! /usr/bin/env lua
+--
+-- wrapcache.lua
+-- Copyright (C) 2015 Adrian Perez <aperez@igalia.com>
+--
+-- Distributed under terms of the MIT license.
+--
+
+local eol = require("eol")
+local libtest = eol.load("libtest")
+
+-- The cache is enabled by default.
+assert.True(eol.wrapcache())
+
+-- Dereferencing the same pointer returns the same wrapper.
+local intptrvar = libtest.intptrvar
+assert.True(rawequal(intptrvar.__value, intptrvar.__value))
+
+-- Ditto for nested structs and array elements.
+local screen = libtest.screen
+assert.True(rawequal(screen.tl, screen.tl))
+assert.False(rawequal(screen.tl, screen.br))
+local triangle = libtest.triangle
+assert.True(rawequal(triangle[2], triangle[2]))
+
+-- Wrappers can be used as table keys.
+local seen = { [screen.tl] = true }
+assert.True(seen[screen.tl])
+assert.Nil(seen[screen.br])
+
+-- Once disabled, each access creates a new wrapper.
+assert.True(eol.wrapcache(false))
+assert.False(eol.wrapcache())
+assert.False(rawequal(screen.tl, screen.tl))
+assert.Equal(10, screen.tl.x)
+assert.False(eol.wrapcache(true))
+assert.True(rawequal(screen.tl, screen.tl))
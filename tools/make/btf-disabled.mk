@@ -0,0 +1,2 @@
+# No compiler can generate BTF: libtest-btf.so is not built, and the tests
+# which need it are skipped.
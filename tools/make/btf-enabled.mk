@@ -0,0 +1,10 @@
+# Copy of libtest.so with BTF type information, instead of DWARF.
+all: ${OUT}/libtest-btf.so
+
+${OUT}/libtest-btf.o: libtest.c
+	$P Compile $@
+	$Q mkdir -p $(dir $@)
+	$Q ${btf_cc} -fPIC -std=gnu99 -gbtf -c -o $@ $<
+
+${OUT}/libtest-btf.so: ${OUT}/libtest-btf.o
+${OUT}/libtest-btf.so: LDFLAGS += -shared